@@ -0,0 +1,133 @@
+#include "AnalysisWorker.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+
+AnalysisWorker::AnalysisWorker()
+    : juce::Thread("Pitch analysis")
+{
+}
+
+AnalysisWorker::~AnalysisWorker()
+{
+    stop();
+}
+
+void AnalysisWorker::prepare(double sampleRate, int samplesPerBlock, int maxLatencySamples, const PitchDetector::Settings& settings)
+{
+    stop();
+
+    const int blockSize = std::max(1, samplesPerBlock);
+    auto workerSettings = settings;
+    workerSettings.analysisSlices = 1;
+    detector.prepare(sampleRate, blockSize, workerSettings);
+
+    // Room for the whole latency window plus a block in flight, twice over for burst tolerance.
+    const int framesPerBlock = (blockSize + kFrameSize - 1) / kFrameSize;
+    const int latencyFrames = (std::max(0, maxLatencySamples) + kFrameSize - 1) / kFrameSize;
+    frames.resize(2 * (latencyFrames + framesPerBlock) + 4);
+    results.resize(1024);
+    detections.reserve(128);
+    droppedSamples.store(0, std::memory_order_relaxed);
+    droppedResults.store(0, std::memory_order_relaxed);
+    periodHz = sampleRate / static_cast<double>(blockSize);
+}
+
+void AnalysisWorker::start()
+{
+    if (periodHz <= 0.0 || isThreadRunning())
+        return;
+
+    if (!startRealtimeThread(juce::Thread::RealtimeOptions {}.withPeriodHz(periodHz)))
+        startThread(juce::Thread::Priority::highest);
+}
+
+void AnalysisWorker::stop()
+{
+    signalThreadShouldExit();
+    frameReady.post();
+    stopThread(1000);
+}
+
+bool AnalysisWorker::pushSamples(const float* samples, int numSamples, juce::int64 startSample,
+                                 bool applySettings, bool resetHistory, const PitchDetector::Settings& settings)
+{
+    for (int offset = 0; offset < numSamples; offset += kFrameSize)
+    {
+        const int count = std::min(kFrameSize, numSamples - offset);
+        auto* frame = frames.acquireWrite();
+        if (frame == nullptr)
+        {
+            droppedSamples.fetch_add(numSamples - offset, std::memory_order_relaxed);
+            if (offset > 0)
+                wakeWorker();
+            return false;
+        }
+
+        frame->startSample = startSample + offset;
+        frame->numSamples = count;
+        frame->applySettings = applySettings && offset == 0;
+        frame->resetHistory = resetHistory && offset == 0;
+        if (frame->applySettings)
+            frame->settings = settings;
+        std::copy(samples + offset, samples + offset + count, frame->samples.begin());
+        TraceRecorder::flowStart("analysis frame", frame->startSample);
+        frames.commitWrite();
+    }
+    if (numSamples > 0)
+        wakeWorker();
+    return true;
+}
+
+void AnalysisWorker::wakeWorker()
+{
+    if (workerIdle.exchange(false))
+        frameReady.post();
+}
+
+void AnalysisWorker::run()
+{
+    TraceRecorder::setThreadName("Analysis worker");
+    while (!threadShouldExit())
+    {
+        const auto* frame = frames.peek();
+        if (frame == nullptr)
+        {
+            // Announce idling before looking once more, so a frame committed in between is either
+            // seen here or followed by a post.
+            workerIdle.store(true);
+            if (frames.peek() == nullptr && !threadShouldExit())
+                frameReady.wait(kIdleTimeoutMs);
+            workerIdle.store(false);
+            continue;
+        }
+
+        MYK_TRACE_SCOPE("analysis frame");
+        TraceRecorder::flowEnd("analysis frame", frame->startSample);
+        if (frame->applySettings)
+        {
+            // Slicing only exists to bound audio callback cost, which does not apply here.
+            auto settings = frame->settings;
+            settings.analysisSlices = 1;
+            detector.applySettings(settings);
+        }
+        if (frame->resetHistory)
+            detector.reset();
+
+        detector.processBlock(frame->samples.data(), frame->numSamples, detections);
+        // The fixed playback latency replaces the detector's own, so results are dated by the input
+        // they describe.
+        const int detectorLatency = detector.getLatencySamples();
+        for (const auto& detection : detections)
+        {
+            Result result;
+            result.samplePosition = frame->startSample + detection.sampleOffset - detectorLatency;
+            result.detection = detection;
+            if (results.push(result))
+                TraceRecorder::flowStart("analysis result", result.samplePosition);
+            else
+                droppedResults.fetch_add(1, std::memory_order_relaxed);
+        }
+        frames.commitRead();
+    }
+}
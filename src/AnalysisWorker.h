@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "PitchDetector.h"
+#include "SpscQueue.h"
+#include "WakeSemaphore.h"
+
+// Runs a PitchDetector on a real-time worker thread. The audio thread copies its mono input into
+// fixed-size frames on one SPSC queue and drains timestamped detections from another; it never
+// waits on the worker, and wakes an idle worker with a semaphore post that takes no lock. Detections carry absolute sample positions so the caller can play them
+// back after a fixed latency. The thread only runs between start() and stop(), so it costs nothing
+// while asynchronous analysis is off; the queues stay allocated from prepare() throughout.
+class AnalysisWorker : private juce::Thread
+{
+public:
+    static constexpr int kFrameSize = 256;
+
+    struct InputFrame
+    {
+        juce::int64 startSample = 0;
+        int numSamples = 0;
+        // Apply settings to the worker's detector before analysing this frame, and optionally
+        // drop its window history first.
+        bool applySettings = false;
+        bool resetHistory = false;
+        PitchDetector::Settings settings;
+        std::array<float, kFrameSize> samples {};
+    };
+
+    struct Result
+    {
+        juce::int64 samplePosition = 0;
+        PitchDetector::Detection detection;
+    };
+
+    AnalysisWorker();
+    ~AnalysisWorker() override;
+
+    // Not real-time safe: stops the thread, prepares the worker's detector and sizes the queues to
+    // cover maxLatencySamples of input.
+    void prepare(double sampleRate, int samplesPerBlock, int maxLatencySamples, const PitchDetector::Settings& settings);
+    // Message thread. Starts or stops the worker thread; the audio thread may keep pushing either
+    // way, and frames queued while it is stopped wait for the next start().
+    void start();
+    void stop();
+    bool isRunning() const { return isThreadRunning(); }
+
+    // Audio thread. Copies numSamples into frames; a full queue drops the samples and counts them.
+    // The first frame carries the applySettings / resetHistory requests along with settings.
+    // Returns false if any samples were dropped.
+    bool pushSamples(const float* samples, int numSamples, juce::int64 startSample,
+                     bool applySettings, bool resetHistory, const PitchDetector::Settings& settings);
+
+    // Audio thread. Oldest undelivered result, or nullptr; call popResult() once it is consumed, or
+    // dropResult() if it came too late to be played.
+    const Result* peekResult() const { return results.peek(); }
+    void popResult() { results.commitRead(); }
+    void dropResult()
+    {
+        results.commitRead();
+        droppedResults.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    juce::int64 getDroppedSamples() const { return droppedSamples.load(std::memory_order_relaxed); }
+    // Detections the worker found while the result queue was full, or that reached the audio
+    // thread after their playback slot.
+    juce::int64 getDroppedResults() const { return droppedResults.load(std::memory_order_relaxed); }
+
+private:
+    // How long an idle worker sleeps before checking threadShouldExit() without a post.
+    static constexpr int kIdleTimeoutMs = 100;
+
+    void run() override;
+    void wakeWorker();
+
+    SpscQueue<InputFrame> frames;
+    SpscQueue<Result> results;
+    PitchDetector detector;
+    std::vector<PitchDetector::Detection> detections;
+    std::atomic<juce::int64> droppedSamples { 0 };
+    std::atomic<juce::int64> droppedResults { 0 };
+    // Set by the worker before it waits on frameReady. The audio thread only posts when it clears
+    // the flag, so a busy worker costs the audio thread one atomic exchange per block.
+    std::atomic<bool> workerIdle { false };
+    WakeSemaphore frameReady;
+    double periodHz = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisWorker)
+};
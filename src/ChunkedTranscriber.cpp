@@ -0,0 +1,211 @@
+#include "ChunkedTranscriber.h"
+
+#include <algorithm>
+
+namespace
+{
+    struct Checkpoint
+    {
+        juce::int64 position = 0;
+        // Events the chunk had produced by this position.
+        size_t numEvents = 0;
+        OfflineTranscriber::State state;
+    };
+
+    struct Chunk
+    {
+        juce::int64 warmUpStart = 0;
+        juce::int64 start = 0;
+        juce::int64 end = 0;
+        bool ok = false;
+        OfflineTranscriber::State startState;
+        OfflineTranscriber::State endState;
+        std::vector<Checkpoint> checkpoints;
+        std::vector<OfflineTranscriber::Event> events;
+    };
+
+    juce::int64 roundUp(juce::int64 value, juce::int64 multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    // Each section gets its own reader, so workers share nothing but the file's pages.
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapSection(const juce::File& file, juce::int64 start, juce::int64 end)
+    {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(juce::WavAudioFormat().createMemoryMappedReader(file));
+        if (reader == nullptr || !reader->mapSectionOfFile({ start, end }))
+            return nullptr;
+        return reader;
+    }
+
+    // Analyses up to the next block boundary of the sequential pass, stopping short of end.
+    bool processNextBlock(OfflineTranscriber& transcriber, juce::AudioFormatReader& reader, juce::int64 end,
+                          juce::AudioBuffer<float>& buffer, std::vector<OfflineTranscriber::Event>& events)
+    {
+        const juce::int64 position = transcriber.getSamplePosition();
+        const juce::int64 blockSize = buffer.getNumSamples();
+        const int count = static_cast<int>(std::min(blockSize - position % blockSize, end - position));
+        if (!reader.read(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), position, count))
+            return false;
+        transcriber.processBlock(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), count, events);
+        return true;
+    }
+
+    void analyseChunk(const juce::File& file, double sampleRate, const OfflineTranscriber::Settings& settings,
+                      juce::int64 checkpointSamples, Chunk& chunk)
+    {
+        auto reader = mapSection(file, chunk.warmUpStart, chunk.end);
+        if (reader == nullptr)
+            return;
+
+        OfflineTranscriber transcriber;
+        transcriber.prepare(sampleRate, settings, chunk.warmUpStart);
+        juce::AudioBuffer<float> buffer(static_cast<int>(reader->numChannels), settings.blockSize);
+
+        std::vector<OfflineTranscriber::Event> warmUpEvents;
+        while (transcriber.getSamplePosition() < chunk.start)
+        {
+            warmUpEvents.clear();
+            if (!processNextBlock(transcriber, *reader, chunk.start, buffer, warmUpEvents))
+                return;
+        }
+        transcriber.saveState(chunk.startState);
+
+        while (transcriber.getSamplePosition() < chunk.end)
+        {
+            if (!processNextBlock(transcriber, *reader, chunk.end, buffer, chunk.events))
+                return;
+
+            const juce::int64 position = transcriber.getSamplePosition();
+            if (position < chunk.end && (position - chunk.start) % checkpointSamples == 0)
+            {
+                chunk.checkpoints.push_back({ position, chunk.events.size(), {} });
+                transcriber.saveState(chunk.checkpoints.back().state);
+            }
+        }
+        transcriber.saveState(chunk.endState);
+        chunk.ok = true;
+    }
+
+    // Continues the sequential pass into chunk from state, until it agrees with one of the chunk's
+    // checkpoints; the chunk's own events from there on are then the sequential ones.
+    bool resync(const juce::File& file, double sampleRate, const OfflineTranscriber::Settings& settings,
+                const OfflineTranscriber::State& state, const Chunk& chunk,
+                std::vector<OfflineTranscriber::Event>& events, OfflineTranscriber::State& endState,
+                ChunkedTranscriber::Stats& stats)
+    {
+        auto reader = mapSection(file, chunk.start, chunk.end);
+        if (reader == nullptr)
+            return false;
+
+        OfflineTranscriber transcriber;
+        transcriber.prepare(sampleRate, settings, chunk.start);
+        transcriber.restoreState(state);
+        juce::AudioBuffer<float> buffer(static_cast<int>(reader->numChannels), settings.blockSize);
+
+        stats.resyncedChunks++;
+        OfflineTranscriber::State current;
+        size_t next = 0;
+        while (transcriber.getSamplePosition() < chunk.end)
+        {
+            if (!processNextBlock(transcriber, *reader, chunk.end, buffer, events))
+                return false;
+
+            const juce::int64 position = transcriber.getSamplePosition();
+            if (next == chunk.checkpoints.size() || chunk.checkpoints[next].position != position)
+                continue;
+
+            const auto& checkpoint = chunk.checkpoints[next++];
+            transcriber.saveState(current);
+            if (transcriber.isEquivalent(current, checkpoint.state))
+            {
+                events.insert(events.end(), chunk.events.begin() + static_cast<std::ptrdiff_t>(checkpoint.numEvents), chunk.events.end());
+                endState = chunk.endState;
+                stats.resyncSamples += position - chunk.start;
+                return true;
+            }
+        }
+
+        transcriber.saveState(endState);
+        stats.resyncSamples += chunk.end - chunk.start;
+        return true;
+    }
+}
+
+bool ChunkedTranscriber::transcribe(const juce::File& file, const Settings& settings, WorkStealingPool& pool,
+                                    OfflineTranscriber::Result& result, Stats& stats)
+{
+    result.events.clear();
+    stats = {};
+
+    std::unique_ptr<juce::AudioFormatReader> header(juce::WavAudioFormat().createMemoryMappedReader(file));
+    if (header == nullptr || header->sampleRate <= 0.0 || header->numChannels == 0)
+        return false;
+
+    const double sampleRate = header->sampleRate;
+    const juce::int64 length = header->lengthInSamples;
+    result.sampleRate = sampleRate;
+    result.numSamples = length;
+
+    auto analysis = settings.analysis;
+    analysis.blockSize = std::max(1, analysis.blockSize);
+
+    // Chunks start on block boundaries, so they are compared where the sequential pass stands
+    // between two blocks. Warm-ups start on a whole hop cycle, so their hops fall where the
+    // sequential pass has them; a short first block brings them onto the block grid.
+    OfflineTranscriber reference;
+    reference.prepare(sampleRate, analysis);
+    const auto& detector = reference.getDetector();
+    const juce::int64 hopCycle = detector.getHopCycleSamples();
+    auto toSamples = [sampleRate](double seconds) { return static_cast<juce::int64>(seconds * sampleRate); };
+
+    stats.chunkSamples = roundUp(std::max<juce::int64>(1, toSamples(settings.chunkSeconds)), analysis.blockSize);
+    stats.overlapSamples = std::max<juce::int64>(toSamples(settings.overlapSeconds), detector.getWarmUpSamples());
+    const juce::int64 checkpointSamples = roundUp(std::max<juce::int64>(1, toSamples(settings.checkpointSeconds)), analysis.blockSize);
+
+    std::vector<Chunk> chunks;
+    for (juce::int64 start = 0; start < length; start += stats.chunkSamples)
+    {
+        Chunk chunk;
+        chunk.warmUpStart = std::max<juce::int64>(0, start - stats.overlapSamples) / hopCycle * hopCycle;
+        chunk.start = start;
+        chunk.end = std::min(length, start + stats.chunkSamples);
+        stats.warmUpSamples += chunk.start - chunk.warmUpStart;
+        chunks.push_back(std::move(chunk));
+    }
+    stats.chunks = static_cast<int>(chunks.size());
+    if (chunks.empty())
+        return true;
+
+    for (auto& chunk : chunks)
+    {
+        pool.submit([&file, sampleRate, &analysis, checkpointSamples, &chunk](int)
+        {
+            analyseChunk(file, sampleRate, analysis, checkpointSamples, chunk);
+        });
+    }
+    pool.waitForAll();
+
+    if (std::any_of(chunks.begin(), chunks.end(), [](const Chunk& chunk) { return !chunk.ok; }))
+        return false;
+
+    // The first chunk has no warm-up, so it is the sequential pass by construction.
+    result.events = std::move(chunks.front().events);
+    OfflineTranscriber::State state = chunks.front().endState;
+    OfflineTranscriber::State nextState;
+    for (size_t i = 1; i < chunks.size(); ++i)
+    {
+        const auto& chunk = chunks[i];
+        if (reference.isEquivalent(state, chunk.startState))
+        {
+            result.events.insert(result.events.end(), chunk.events.begin(), chunk.events.end());
+            nextState = chunk.endState;
+        }
+        else if (!resync(file, sampleRate, analysis, state, chunk, result.events, nextState, stats))
+        {
+            return false;
+        }
+        std::swap(state, nextState);
+    }
+    return true;
+}
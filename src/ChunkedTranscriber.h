@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "OfflineTranscriber.h"
+#include "WorkStealingPool.h"
+
+// Transcribes a single long WAV recording by analysing chunks of it in parallel, with exactly the
+// events one OfflineTranscriber pass over the whole file gives.
+//
+// Each worker memory-maps its chunk plus a warm-up section before it and analyses both, so its
+// detector and segmenter settle into the state the sequential pass has at the chunk edge. The
+// chunks are then joined in order: a chunk whose start state matches the previous chunk's end
+// state is taken as it is. Otherwise (typically a chunk starting in a rest, where the median still
+// holds notes from before the warm-up) the chunk is re-analysed from that end state until it
+// reaches one of its own checkpoints with a matching state, and the rest of it is kept.
+class ChunkedTranscriber
+{
+public:
+    struct Settings
+    {
+        OfflineTranscriber::Settings analysis = OfflineTranscriber::getDefaultSettings();
+        double chunkSeconds = 60.0;
+        // Raised to the detector's window and median history when shorter.
+        double overlapSeconds = 2.0;
+        // How often each chunk saves its state for joining after a mismatch.
+        double checkpointSeconds = 1.0;
+    };
+
+    struct Stats
+    {
+        int chunks = 0;
+        // Chunks whose start state did not match and were partly or wholly analysed again.
+        int resyncedChunks = 0;
+        // Rounded up to whole blocks.
+        juce::int64 chunkSamples = 0;
+        // Shortest warm-up; each one is extended back to start on a whole hop cycle.
+        juce::int64 overlapSamples = 0;
+        // Audio analysed more than once: the warm-ups, and the re-analysis after mismatches.
+        juce::int64 warmUpSamples = 0;
+        juce::int64 resyncSamples = 0;
+    };
+
+    // Fails if the file is not a WAV file that can be mapped, or a section cannot be read.
+    static bool transcribe(const juce::File& file, const Settings& settings, WorkStealingPool& pool,
+                           OfflineTranscriber::Result& result, Stats& stats);
+};
@@ -0,0 +1,883 @@
+#include "CorrelationKernels.h"
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define MYK_KERNELS_X86 1
+ #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+ #define MYK_KERNELS_NEON 1
+ #include <arm_neon.h>
+#endif
+
+#if MYK_KERNELS_X86 && (defined(__GNUC__) || defined(__clang__))
+ #define MYK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+ #define MYK_TARGET_AVX2
+#endif
+
+namespace
+{
+    using CorrelationKernels::DcBlocker;
+    using CorrelationKernels::Levels;
+
+    constexpr int kLagsPerPass = 4;
+
+    void lagSumsScalar(const float* x, int length, int firstLag, int numLags, float* out)
+    {
+        for (int k = 0; k < numLags; ++k)
+        {
+            const float* shifted = x + firstLag + k;
+            float ampSum = 0.0f;
+            for (int j = 0; j < length; ++j)
+                ampSum += shifted[j] * x[j];
+            out[k] = ampSum;
+        }
+    }
+
+    // Lanes per pass of the narrow (SSE2, NEON, scalar) and wide (AVX2) lane kernels. Each lane
+    // sum is one dependency chain, so a pass runs several lags to keep the adder busy.
+    constexpr int kNarrowLanes = 4;
+    constexpr int kWideLanes = 8;
+    constexpr int kLaneLagsPerPass = 8;
+
+    void laneLagSumsScalar(const float* x, int length, const int* lags, int numLags, float* out)
+    {
+        for (int k = 0; k < numLags; ++k)
+        {
+            const float* shifted = x + lags[k] * kNarrowLanes;
+            for (int lane = 0; lane < kNarrowLanes; ++lane)
+            {
+                float ampSum = 0.0f;
+                for (int j = 0; j < length; ++j)
+                    ampSum += shifted[j * kNarrowLanes + lane] * x[j * kNarrowLanes + lane];
+                out[k * kNarrowLanes + lane] = ampSum;
+            }
+        }
+    }
+
+    void decimateScalar(const float* x, const float* taps, int numTaps, int numOutputs, int stride, float* out)
+    {
+        for (int k = 0; k < numOutputs; ++k)
+        {
+            const float* source = x + k * stride;
+            float sum = 0.0f;
+            for (int j = 0; j < numTaps; ++j)
+                sum += source[j] * taps[j];
+            out[k] = sum;
+        }
+    }
+
+    // Samples [start, numSamples) one at a time, continuing the levels and the DC blocker's state.
+    // The vector kernels finish their tails here.
+    void conditionSamples(const float* const* channels, int numChannels, int start, int numSamples, float scale,
+                          DcBlocker* dcBlocker, float* out, Levels& levels)
+    {
+        for (int n = start; n < numSamples; ++n)
+        {
+            float mixed = channels[0][n];
+            for (int c = 1; c < numChannels; ++c)
+                mixed += channels[c][n];
+            mixed *= scale;
+
+            if (dcBlocker != nullptr)
+            {
+                const float blocked = mixed - dcBlocker->lastInput + dcBlocker->pole * dcBlocker->lastOutput;
+                dcBlocker->lastInput = mixed;
+                dcBlocker->lastOutput = blocked;
+                mixed = blocked;
+            }
+
+            if (out != nullptr)
+                out[n] = mixed;
+            levels.sumSquares += mixed * mixed;
+            levels.peak = std::max(levels.peak, std::fabs(mixed));
+        }
+    }
+
+    Levels conditionScalar(const float* const* channels, int numChannels, int numSamples, float scale, DcBlocker* dcBlocker, float* out)
+    {
+        Levels levels;
+        conditionSamples(channels, numChannels, 0, numSamples, scale, dcBlocker, out, levels);
+        return levels;
+    }
+
+#if MYK_KERNELS_X86
+    float horizontalSum(__m128 v)
+    {
+        const __m128 high = _mm_movehl_ps(v, v);
+        const __m128 pair = _mm_add_ps(v, high);
+        const __m128 odd = _mm_shuffle_ps(pair, pair, 0x55);
+        return _mm_cvtss_f32(_mm_add_ss(pair, odd));
+    }
+
+    void lagSumsSse2(const float* x, int length, int firstLag, int numLags, float* out)
+    {
+        const int vectorLength = length & ~3;
+        int k = 0;
+
+        for (; k + kLagsPerPass <= numLags; k += kLagsPerPass)
+        {
+            const float* s = x + firstLag + k;
+            __m128 acc0 = _mm_setzero_ps();
+            __m128 acc1 = _mm_setzero_ps();
+            __m128 acc2 = _mm_setzero_ps();
+            __m128 acc3 = _mm_setzero_ps();
+
+            for (int j = 0; j < vectorLength; j += 4)
+            {
+                const __m128 w = _mm_loadu_ps(x + j);
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(s + j), w));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(s + j + 1), w));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(s + j + 2), w));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(s + j + 3), w));
+            }
+
+            float sums[kLagsPerPass] = { horizontalSum(acc0), horizontalSum(acc1),
+                                         horizontalSum(acc2), horizontalSum(acc3) };
+            for (int j = vectorLength; j < length; ++j)
+                for (int lane = 0; lane < kLagsPerPass; ++lane)
+                    sums[lane] += s[j + lane] * x[j];
+
+            std::copy(sums, sums + kLagsPerPass, out + k);
+        }
+
+        for (; k < numLags; ++k)
+        {
+            const float* s = x + firstLag + k;
+            __m128 acc = _mm_setzero_ps();
+            for (int j = 0; j < vectorLength; j += 4)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(s + j), _mm_loadu_ps(x + j)));
+
+            float ampSum = horizontalSum(acc);
+            for (int j = vectorLength; j < length; ++j)
+                ampSum += s[j] * x[j];
+            out[k] = ampSum;
+        }
+    }
+
+    // One accumulator per lag holds that lag for every lane, and each window position is loaded once
+    // for all the lags of a pass.
+    void laneLagSumsSse2(const float* x, int length, const int* lags, int numLags, float* out)
+    {
+        int k = 0;
+
+        // A list of at least one pass ends with a pass over its last lags, repeating a few.
+        for (; numLags >= kLaneLagsPerPass && k < numLags; k += kLaneLagsPerPass)
+        {
+            k = std::min(k, numLags - kLaneLagsPerPass);
+            const float* s0 = x + lags[k + 0] * kNarrowLanes;
+            const float* s1 = x + lags[k + 1] * kNarrowLanes;
+            const float* s2 = x + lags[k + 2] * kNarrowLanes;
+            const float* s3 = x + lags[k + 3] * kNarrowLanes;
+            const float* s4 = x + lags[k + 4] * kNarrowLanes;
+            const float* s5 = x + lags[k + 5] * kNarrowLanes;
+            const float* s6 = x + lags[k + 6] * kNarrowLanes;
+            const float* s7 = x + lags[k + 7] * kNarrowLanes;
+            __m128 acc0 = _mm_setzero_ps();
+            __m128 acc1 = _mm_setzero_ps();
+            __m128 acc2 = _mm_setzero_ps();
+            __m128 acc3 = _mm_setzero_ps();
+            __m128 acc4 = _mm_setzero_ps();
+            __m128 acc5 = _mm_setzero_ps();
+            __m128 acc6 = _mm_setzero_ps();
+            __m128 acc7 = _mm_setzero_ps();
+
+            for (int j = 0; j < length; ++j)
+            {
+                const int offset = j * kNarrowLanes;
+                const __m128 w = _mm_loadu_ps(x + offset);
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(s0 + offset), w));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(s1 + offset), w));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(s2 + offset), w));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(s3 + offset), w));
+                acc4 = _mm_add_ps(acc4, _mm_mul_ps(_mm_loadu_ps(s4 + offset), w));
+                acc5 = _mm_add_ps(acc5, _mm_mul_ps(_mm_loadu_ps(s5 + offset), w));
+                acc6 = _mm_add_ps(acc6, _mm_mul_ps(_mm_loadu_ps(s6 + offset), w));
+                acc7 = _mm_add_ps(acc7, _mm_mul_ps(_mm_loadu_ps(s7 + offset), w));
+            }
+
+            _mm_storeu_ps(out + (k + 0) * kNarrowLanes, acc0);
+            _mm_storeu_ps(out + (k + 1) * kNarrowLanes, acc1);
+            _mm_storeu_ps(out + (k + 2) * kNarrowLanes, acc2);
+            _mm_storeu_ps(out + (k + 3) * kNarrowLanes, acc3);
+            _mm_storeu_ps(out + (k + 4) * kNarrowLanes, acc4);
+            _mm_storeu_ps(out + (k + 5) * kNarrowLanes, acc5);
+            _mm_storeu_ps(out + (k + 6) * kNarrowLanes, acc6);
+            _mm_storeu_ps(out + (k + 7) * kNarrowLanes, acc7);
+        }
+
+        for (; k < numLags; ++k)
+        {
+            const float* s = x + lags[k] * kNarrowLanes;
+            __m128 acc = _mm_setzero_ps();
+            for (int j = 0; j < length; ++j)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(s + j * kNarrowLanes), _mm_loadu_ps(x + j * kNarrowLanes)));
+            _mm_storeu_ps(out + k * kNarrowLanes, acc);
+        }
+    }
+
+    void decimateSse2(const float* x, const float* taps, int numTaps, int numOutputs, int stride, float* out)
+    {
+        const int vectorTaps = numTaps & ~3;
+        for (int k = 0; k < numOutputs; ++k)
+        {
+            const float* source = x + k * stride;
+            __m128 acc = _mm_setzero_ps();
+            for (int j = 0; j < vectorTaps; j += 4)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(source + j), _mm_loadu_ps(taps + j)));
+
+            float sum = horizontalSum(acc);
+            for (int j = vectorTaps; j < numTaps; ++j)
+                sum += source[j] * taps[j];
+            out[k] = sum;
+        }
+    }
+
+    float horizontalMax(__m128 v)
+    {
+        const __m128 pair = _mm_max_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_max_ss(pair, _mm_shuffle_ps(pair, pair, 0x55)));
+    }
+
+    template <int Lanes>
+    __m128 shiftUp(__m128 v)
+    {
+        return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4 * Lanes));
+    }
+
+    // The DC blocker four samples at a time: the recurrence unrolls into a prefix sum of the input
+    // differences weighted by powers of the pole, plus the decayed output before the group.
+    struct DcBlockerSse2
+    {
+        explicit DcBlockerSse2(const DcBlocker& state)
+            : pole(_mm_set1_ps(state.pole)),
+              pole2(_mm_set1_ps(state.pole * state.pole)),
+              decay(_mm_setr_ps(state.pole, state.pole * state.pole, state.pole * state.pole * state.pole,
+                                state.pole * state.pole * state.pole * state.pole)),
+              lastInput(_mm_set1_ps(state.lastInput)),
+              lastOutput(_mm_set1_ps(state.lastOutput))
+        {
+        }
+
+        __m128 process(__m128 x)
+        {
+            __m128 y = _mm_sub_ps(x, _mm_move_ss(shiftUp<1>(x), lastInput));
+            y = _mm_add_ps(y, _mm_mul_ps(pole, shiftUp<1>(y)));
+            y = _mm_add_ps(y, _mm_mul_ps(pole2, shiftUp<2>(y)));
+            y = _mm_add_ps(y, _mm_mul_ps(decay, lastOutput));
+            lastInput = _mm_shuffle_ps(x, x, 0xff);
+            lastOutput = _mm_shuffle_ps(y, y, 0xff);
+            return y;
+        }
+
+        void save(DcBlocker& state) const
+        {
+            state.lastInput = _mm_cvtss_f32(lastInput);
+            state.lastOutput = _mm_cvtss_f32(lastOutput);
+        }
+
+        const __m128 pole, pole2, decay;
+        __m128 lastInput, lastOutput;
+    };
+
+    Levels conditionSse2(const float* const* channels, int numChannels, int numSamples, float scale, DcBlocker* dcBlocker, float* out)
+    {
+        const __m128 scaleVector = _mm_set1_ps(scale);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 sumSquares = _mm_setzero_ps();
+        __m128 peak = _mm_setzero_ps();
+        DcBlockerSse2 blocker(dcBlocker != nullptr ? *dcBlocker : DcBlocker {});
+
+        const int vectorSamples = numSamples & ~3;
+        for (int n = 0; n < vectorSamples; n += 4)
+        {
+            __m128 mixed = _mm_loadu_ps(channels[0] + n);
+            for (int c = 1; c < numChannels; ++c)
+                mixed = _mm_add_ps(mixed, _mm_loadu_ps(channels[c] + n));
+            mixed = _mm_mul_ps(mixed, scaleVector);
+            if (dcBlocker != nullptr)
+                mixed = blocker.process(mixed);
+
+            if (out != nullptr)
+                _mm_storeu_ps(out + n, mixed);
+            sumSquares = _mm_add_ps(sumSquares, _mm_mul_ps(mixed, mixed));
+            peak = _mm_max_ps(peak, _mm_andnot_ps(signMask, mixed));
+        }
+
+        if (dcBlocker != nullptr)
+            blocker.save(*dcBlocker);
+        Levels levels { horizontalSum(sumSquares), horizontalMax(peak) };
+        conditionSamples(channels, numChannels, vectorSamples, numSamples, scale, dcBlocker, out, levels);
+        return levels;
+    }
+
+    MYK_TARGET_AVX2 float horizontalSum256(__m256 v)
+    {
+        const __m128 low = _mm256_castps256_ps128(v);
+        const __m128 high = _mm256_extractf128_ps(v, 1);
+        return horizontalSum(_mm_add_ps(low, high));
+    }
+
+    MYK_TARGET_AVX2 void lagSumsAvx2(const float* x, int length, int firstLag, int numLags, float* out)
+    {
+        const int vectorLength = length & ~7;
+        int k = 0;
+
+        for (; k + kLagsPerPass <= numLags; k += kLagsPerPass)
+        {
+            const float* s = x + firstLag + k;
+            __m256 acc0 = _mm256_setzero_ps();
+            __m256 acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps();
+            __m256 acc3 = _mm256_setzero_ps();
+
+            for (int j = 0; j < vectorLength; j += 8)
+            {
+                const __m256 w = _mm256_loadu_ps(x + j);
+                acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(s + j), w));
+                acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(s + j + 1), w));
+                acc2 = _mm256_add_ps(acc2, _mm256_mul_ps(_mm256_loadu_ps(s + j + 2), w));
+                acc3 = _mm256_add_ps(acc3, _mm256_mul_ps(_mm256_loadu_ps(s + j + 3), w));
+            }
+
+            float sums[kLagsPerPass] = { horizontalSum256(acc0), horizontalSum256(acc1),
+                                         horizontalSum256(acc2), horizontalSum256(acc3) };
+            for (int j = vectorLength; j < length; ++j)
+                for (int lane = 0; lane < kLagsPerPass; ++lane)
+                    sums[lane] += s[j + lane] * x[j];
+
+            std::copy(sums, sums + kLagsPerPass, out + k);
+        }
+
+        for (; k < numLags; ++k)
+        {
+            const float* s = x + firstLag + k;
+            __m256 acc = _mm256_setzero_ps();
+            for (int j = 0; j < vectorLength; j += 8)
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(s + j), _mm256_loadu_ps(x + j)));
+
+            float ampSum = horizontalSum256(acc);
+            for (int j = vectorLength; j < length; ++j)
+                ampSum += s[j] * x[j];
+            out[k] = ampSum;
+        }
+    }
+
+    MYK_TARGET_AVX2 void laneLagSumsAvx2(const float* x, int length, const int* lags, int numLags, float* out)
+    {
+        int k = 0;
+
+        for (; numLags >= kLaneLagsPerPass && k < numLags; k += kLaneLagsPerPass)
+        {
+            k = std::min(k, numLags - kLaneLagsPerPass);
+            const float* s0 = x + lags[k + 0] * kWideLanes;
+            const float* s1 = x + lags[k + 1] * kWideLanes;
+            const float* s2 = x + lags[k + 2] * kWideLanes;
+            const float* s3 = x + lags[k + 3] * kWideLanes;
+            const float* s4 = x + lags[k + 4] * kWideLanes;
+            const float* s5 = x + lags[k + 5] * kWideLanes;
+            const float* s6 = x + lags[k + 6] * kWideLanes;
+            const float* s7 = x + lags[k + 7] * kWideLanes;
+            __m256 acc0 = _mm256_setzero_ps();
+            __m256 acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps();
+            __m256 acc3 = _mm256_setzero_ps();
+            __m256 acc4 = _mm256_setzero_ps();
+            __m256 acc5 = _mm256_setzero_ps();
+            __m256 acc6 = _mm256_setzero_ps();
+            __m256 acc7 = _mm256_setzero_ps();
+
+            for (int j = 0; j < length; ++j)
+            {
+                const int offset = j * kWideLanes;
+                const __m256 w = _mm256_loadu_ps(x + offset);
+                acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(s0 + offset), w));
+                acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(s1 + offset), w));
+                acc2 = _mm256_add_ps(acc2, _mm256_mul_ps(_mm256_loadu_ps(s2 + offset), w));
+                acc3 = _mm256_add_ps(acc3, _mm256_mul_ps(_mm256_loadu_ps(s3 + offset), w));
+                acc4 = _mm256_add_ps(acc4, _mm256_mul_ps(_mm256_loadu_ps(s4 + offset), w));
+                acc5 = _mm256_add_ps(acc5, _mm256_mul_ps(_mm256_loadu_ps(s5 + offset), w));
+                acc6 = _mm256_add_ps(acc6, _mm256_mul_ps(_mm256_loadu_ps(s6 + offset), w));
+                acc7 = _mm256_add_ps(acc7, _mm256_mul_ps(_mm256_loadu_ps(s7 + offset), w));
+            }
+
+            _mm256_storeu_ps(out + (k + 0) * kWideLanes, acc0);
+            _mm256_storeu_ps(out + (k + 1) * kWideLanes, acc1);
+            _mm256_storeu_ps(out + (k + 2) * kWideLanes, acc2);
+            _mm256_storeu_ps(out + (k + 3) * kWideLanes, acc3);
+            _mm256_storeu_ps(out + (k + 4) * kWideLanes, acc4);
+            _mm256_storeu_ps(out + (k + 5) * kWideLanes, acc5);
+            _mm256_storeu_ps(out + (k + 6) * kWideLanes, acc6);
+            _mm256_storeu_ps(out + (k + 7) * kWideLanes, acc7);
+        }
+
+        for (; k < numLags; ++k)
+        {
+            const float* s = x + lags[k] * kWideLanes;
+            __m256 acc = _mm256_setzero_ps();
+            for (int j = 0; j < length; ++j)
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(s + j * kWideLanes), _mm256_loadu_ps(x + j * kWideLanes)));
+            _mm256_storeu_ps(out + k * kWideLanes, acc);
+        }
+    }
+
+    MYK_TARGET_AVX2 void decimateAvx2(const float* x, const float* taps, int numTaps, int numOutputs, int stride, float* out)
+    {
+        const int vectorTaps = numTaps & ~7;
+        for (int k = 0; k < numOutputs; ++k)
+        {
+            const float* source = x + k * stride;
+            __m256 acc = _mm256_setzero_ps();
+            for (int j = 0; j < vectorTaps; j += 8)
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(source + j), _mm256_loadu_ps(taps + j)));
+
+            float sum = horizontalSum256(acc);
+            for (int j = vectorTaps; j < numTaps; ++j)
+                sum += source[j] * taps[j];
+            out[k] = sum;
+        }
+    }
+
+    // The DC blocker has no cross-lane shift in 256 bits, so it runs each half through the SSE2 scan.
+    MYK_TARGET_AVX2 Levels conditionAvx2(const float* const* channels, int numChannels, int numSamples, float scale, DcBlocker* dcBlocker, float* out)
+    {
+        const __m256 scaleVector = _mm256_set1_ps(scale);
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        __m256 sumSquares = _mm256_setzero_ps();
+        __m256 peak = _mm256_setzero_ps();
+        DcBlockerSse2 blocker(dcBlocker != nullptr ? *dcBlocker : DcBlocker {});
+
+        const int vectorSamples = numSamples & ~7;
+        for (int n = 0; n < vectorSamples; n += 8)
+        {
+            __m256 mixed = _mm256_loadu_ps(channels[0] + n);
+            for (int c = 1; c < numChannels; ++c)
+                mixed = _mm256_add_ps(mixed, _mm256_loadu_ps(channels[c] + n));
+            mixed = _mm256_mul_ps(mixed, scaleVector);
+            if (dcBlocker != nullptr)
+            {
+                const __m128 low = blocker.process(_mm256_castps256_ps128(mixed));
+                const __m128 high = blocker.process(_mm256_extractf128_ps(mixed, 1));
+                mixed = _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+            }
+
+            if (out != nullptr)
+                _mm256_storeu_ps(out + n, mixed);
+            sumSquares = _mm256_add_ps(sumSquares, _mm256_mul_ps(mixed, mixed));
+            peak = _mm256_max_ps(peak, _mm256_andnot_ps(signMask, mixed));
+        }
+
+        if (dcBlocker != nullptr)
+            blocker.save(*dcBlocker);
+        Levels levels { horizontalSum256(sumSquares),
+                        horizontalMax(_mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1))) };
+        conditionSamples(channels, numChannels, vectorSamples, numSamples, scale, dcBlocker, out, levels);
+        return levels;
+    }
+#endif
+
+#if MYK_KERNELS_NEON
+    float horizontalSum(float32x4_t v)
+    {
+        const float32x2_t pair = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+        return vget_lane_f32(vpadd_f32(pair, pair), 0);
+    }
+
+    void lagSumsNeon(const float* x, int length, int firstLag, int numLags, float* out)
+    {
+        const int vectorLength = length & ~3;
+        int k = 0;
+
+        for (; k + kLagsPerPass <= numLags; k += kLagsPerPass)
+        {
+            const float* s = x + firstLag + k;
+            float32x4_t acc0 = vdupq_n_f32(0.0f);
+            float32x4_t acc1 = vdupq_n_f32(0.0f);
+            float32x4_t acc2 = vdupq_n_f32(0.0f);
+            float32x4_t acc3 = vdupq_n_f32(0.0f);
+
+            for (int j = 0; j < vectorLength; j += 4)
+            {
+                const float32x4_t w = vld1q_f32(x + j);
+                acc0 = vmlaq_f32(acc0, vld1q_f32(s + j), w);
+                acc1 = vmlaq_f32(acc1, vld1q_f32(s + j + 1), w);
+                acc2 = vmlaq_f32(acc2, vld1q_f32(s + j + 2), w);
+                acc3 = vmlaq_f32(acc3, vld1q_f32(s + j + 3), w);
+            }
+
+            float sums[kLagsPerPass] = { horizontalSum(acc0), horizontalSum(acc1),
+                                         horizontalSum(acc2), horizontalSum(acc3) };
+            for (int j = vectorLength; j < length; ++j)
+                for (int lane = 0; lane < kLagsPerPass; ++lane)
+                    sums[lane] += s[j + lane] * x[j];
+
+            std::copy(sums, sums + kLagsPerPass, out + k);
+        }
+
+        for (; k < numLags; ++k)
+        {
+            const float* s = x + firstLag + k;
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (int j = 0; j < vectorLength; j += 4)
+                acc = vmlaq_f32(acc, vld1q_f32(s + j), vld1q_f32(x + j));
+
+            float ampSum = horizontalSum(acc);
+            for (int j = vectorLength; j < length; ++j)
+                ampSum += s[j] * x[j];
+            out[k] = ampSum;
+        }
+    }
+
+    // Separate multiply and add rather than vmlaq_f32, which may be fused and round differently.
+    void laneLagSumsNeon(const float* x, int length, const int* lags, int numLags, float* out)
+    {
+        int k = 0;
+
+        for (; numLags >= kLaneLagsPerPass && k < numLags; k += kLaneLagsPerPass)
+        {
+            k = std::min(k, numLags - kLaneLagsPerPass);
+            const float* s0 = x + lags[k + 0] * kNarrowLanes;
+            const float* s1 = x + lags[k + 1] * kNarrowLanes;
+            const float* s2 = x + lags[k + 2] * kNarrowLanes;
+            const float* s3 = x + lags[k + 3] * kNarrowLanes;
+            const float* s4 = x + lags[k + 4] * kNarrowLanes;
+            const float* s5 = x + lags[k + 5] * kNarrowLanes;
+            const float* s6 = x + lags[k + 6] * kNarrowLanes;
+            const float* s7 = x + lags[k + 7] * kNarrowLanes;
+            float32x4_t acc0 = vdupq_n_f32(0.0f);
+            float32x4_t acc1 = vdupq_n_f32(0.0f);
+            float32x4_t acc2 = vdupq_n_f32(0.0f);
+            float32x4_t acc3 = vdupq_n_f32(0.0f);
+            float32x4_t acc4 = vdupq_n_f32(0.0f);
+            float32x4_t acc5 = vdupq_n_f32(0.0f);
+            float32x4_t acc6 = vdupq_n_f32(0.0f);
+            float32x4_t acc7 = vdupq_n_f32(0.0f);
+
+            for (int j = 0; j < length; ++j)
+            {
+                const int offset = j * kNarrowLanes;
+                const float32x4_t w = vld1q_f32(x + offset);
+                acc0 = vaddq_f32(acc0, vmulq_f32(vld1q_f32(s0 + offset), w));
+                acc1 = vaddq_f32(acc1, vmulq_f32(vld1q_f32(s1 + offset), w));
+                acc2 = vaddq_f32(acc2, vmulq_f32(vld1q_f32(s2 + offset), w));
+                acc3 = vaddq_f32(acc3, vmulq_f32(vld1q_f32(s3 + offset), w));
+                acc4 = vaddq_f32(acc4, vmulq_f32(vld1q_f32(s4 + offset), w));
+                acc5 = vaddq_f32(acc5, vmulq_f32(vld1q_f32(s5 + offset), w));
+                acc6 = vaddq_f32(acc6, vmulq_f32(vld1q_f32(s6 + offset), w));
+                acc7 = vaddq_f32(acc7, vmulq_f32(vld1q_f32(s7 + offset), w));
+            }
+
+            vst1q_f32(out + (k + 0) * kNarrowLanes, acc0);
+            vst1q_f32(out + (k + 1) * kNarrowLanes, acc1);
+            vst1q_f32(out + (k + 2) * kNarrowLanes, acc2);
+            vst1q_f32(out + (k + 3) * kNarrowLanes, acc3);
+            vst1q_f32(out + (k + 4) * kNarrowLanes, acc4);
+            vst1q_f32(out + (k + 5) * kNarrowLanes, acc5);
+            vst1q_f32(out + (k + 6) * kNarrowLanes, acc6);
+            vst1q_f32(out + (k + 7) * kNarrowLanes, acc7);
+        }
+
+        for (; k < numLags; ++k)
+        {
+            const float* s = x + lags[k] * kNarrowLanes;
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (int j = 0; j < length; ++j)
+                acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(s + j * kNarrowLanes), vld1q_f32(x + j * kNarrowLanes)));
+            vst1q_f32(out + k * kNarrowLanes, acc);
+        }
+    }
+
+    void decimateNeon(const float* x, const float* taps, int numTaps, int numOutputs, int stride, float* out)
+    {
+        const int vectorTaps = numTaps & ~3;
+        for (int k = 0; k < numOutputs; ++k)
+        {
+            const float* source = x + k * stride;
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (int j = 0; j < vectorTaps; j += 4)
+                acc = vmlaq_f32(acc, vld1q_f32(source + j), vld1q_f32(taps + j));
+
+            float sum = horizontalSum(acc);
+            for (int j = vectorTaps; j < numTaps; ++j)
+                sum += source[j] * taps[j];
+            out[k] = sum;
+        }
+    }
+
+    float horizontalMax(float32x4_t v)
+    {
+        const float32x2_t pair = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+        return vget_lane_f32(vpmax_f32(pair, pair), 0);
+    }
+
+    // Same scan as DcBlockerSse2, with vext doing the lane shifts.
+    struct DcBlockerNeon
+    {
+        explicit DcBlockerNeon(const DcBlocker& state)
+            : pole(vdupq_n_f32(state.pole)),
+              pole2(vdupq_n_f32(state.pole * state.pole)),
+              lastInput(vdupq_n_f32(state.lastInput)),
+              lastOutput(vdupq_n_f32(state.lastOutput))
+        {
+            const float powers[4] = { state.pole, state.pole * state.pole, state.pole * state.pole * state.pole,
+                                      state.pole * state.pole * state.pole * state.pole };
+            decay = vld1q_f32(powers);
+        }
+
+        float32x4_t process(float32x4_t x)
+        {
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+            float32x4_t y = vsubq_f32(x, vextq_f32(lastInput, x, 3));
+            y = vaddq_f32(y, vmulq_f32(pole, vextq_f32(zero, y, 3)));
+            y = vaddq_f32(y, vmulq_f32(pole2, vextq_f32(zero, y, 2)));
+            y = vaddq_f32(y, vmulq_f32(decay, lastOutput));
+            lastInput = vdupq_n_f32(vgetq_lane_f32(x, 3));
+            lastOutput = vdupq_n_f32(vgetq_lane_f32(y, 3));
+            return y;
+        }
+
+        void save(DcBlocker& state) const
+        {
+            state.lastInput = vgetq_lane_f32(lastInput, 0);
+            state.lastOutput = vgetq_lane_f32(lastOutput, 0);
+        }
+
+        const float32x4_t pole, pole2;
+        float32x4_t decay, lastInput, lastOutput;
+    };
+
+    Levels conditionNeon(const float* const* channels, int numChannels, int numSamples, float scale, DcBlocker* dcBlocker, float* out)
+    {
+        float32x4_t sumSquares = vdupq_n_f32(0.0f);
+        float32x4_t peak = vdupq_n_f32(0.0f);
+        DcBlockerNeon blocker(dcBlocker != nullptr ? *dcBlocker : DcBlocker {});
+
+        const int vectorSamples = numSamples & ~3;
+        for (int n = 0; n < vectorSamples; n += 4)
+        {
+            float32x4_t mixed = vld1q_f32(channels[0] + n);
+            for (int c = 1; c < numChannels; ++c)
+                mixed = vaddq_f32(mixed, vld1q_f32(channels[c] + n));
+            mixed = vmulq_n_f32(mixed, scale);
+            if (dcBlocker != nullptr)
+                mixed = blocker.process(mixed);
+
+            if (out != nullptr)
+                vst1q_f32(out + n, mixed);
+            sumSquares = vaddq_f32(sumSquares, vmulq_f32(mixed, mixed));
+            peak = vmaxq_f32(peak, vabsq_f32(mixed));
+        }
+
+        if (dcBlocker != nullptr)
+            blocker.save(*dcBlocker);
+        Levels levels { horizontalSum(sumSquares), horizontalMax(peak) };
+        conditionSamples(channels, numChannels, vectorSamples, numSamples, scale, dcBlocker, out, levels);
+        return levels;
+    }
+#endif
+}
+
+namespace CorrelationKernels
+{
+    Isa detectIsa()
+    {
+       #if MYK_KERNELS_X86
+        if (juce::SystemStats::hasAVX2())
+            return Isa::avx2;
+        if (juce::SystemStats::hasSSE2())
+            return Isa::sse2;
+       #elif MYK_KERNELS_NEON
+        return Isa::neon;
+       #endif
+        return Isa::scalar;
+    }
+
+    LagSumsFunction getLagSums(Isa isa)
+    {
+        switch (isa)
+        {
+           #if MYK_KERNELS_X86
+            case Isa::sse2: return lagSumsSse2;
+            case Isa::avx2: return lagSumsAvx2;
+           #endif
+           #if MYK_KERNELS_NEON
+            case Isa::neon: return lagSumsNeon;
+           #endif
+            default: break;
+        }
+        return lagSumsScalar;
+    }
+
+    DecimateFunction getDecimate(Isa isa)
+    {
+        switch (isa)
+        {
+           #if MYK_KERNELS_X86
+            case Isa::sse2: return decimateSse2;
+            case Isa::avx2: return decimateAvx2;
+           #endif
+           #if MYK_KERNELS_NEON
+            case Isa::neon: return decimateNeon;
+           #endif
+            default: break;
+        }
+        return decimateScalar;
+    }
+
+    LaneLagSumsFunction getLaneLagSums(Isa isa)
+    {
+        switch (isa)
+        {
+           #if MYK_KERNELS_X86
+            case Isa::sse2: return laneLagSumsSse2;
+            case Isa::avx2: return laneLagSumsAvx2;
+           #endif
+           #if MYK_KERNELS_NEON
+            case Isa::neon: return laneLagSumsNeon;
+           #endif
+            default: break;
+        }
+        return laneLagSumsScalar;
+    }
+
+    ConditionFunction getCondition(Isa isa)
+    {
+        switch (isa)
+        {
+           #if MYK_KERNELS_X86
+            case Isa::sse2: return conditionSse2;
+            case Isa::avx2: return conditionAvx2;
+           #endif
+           #if MYK_KERNELS_NEON
+            case Isa::neon: return conditionNeon;
+           #endif
+            default: break;
+        }
+        return conditionScalar;
+    }
+
+    int getLaneCount(Isa isa)
+    {
+       #if MYK_KERNELS_X86
+        if (isa == Isa::avx2)
+            return kWideLanes;
+       #endif
+        juce::ignoreUnused(isa);
+        return kNarrowLanes;
+    }
+
+    const char* getIsaName(Isa isa)
+    {
+        switch (isa)
+        {
+            case Isa::sse2: return "sse2";
+            case Isa::avx2: return "avx2";
+            case Isa::neon: return "neon";
+            case Isa::scalar: break;
+        }
+        return "scalar";
+    }
+
+    float measureMaxError(Isa isa)
+    {
+        // Odd length and lag count so the vector tails and the single-lag path are exercised too.
+        constexpr int length = 509;
+        constexpr int numLags = 67;
+        std::array<float, length + numLags> x {};
+        std::array<float, numLags> reference {};
+        std::array<float, numLags> candidate {};
+
+        juce::uint32 seed = 0x12345678u;
+        for (auto& sample : x)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            sample = static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f;
+        }
+
+        lagSumsScalar(x.data(), length, 0, numLags, reference.data());
+        getLagSums(isa)(x.data(), length, 0, numLags, candidate.data());
+
+        const float scale = std::max(reference[0], 1.0e-12f);
+        float maxError = 0.0f;
+        for (int k = 0; k < numLags; ++k)
+            maxError = std::max(maxError, std::fabs(candidate[static_cast<size_t>(k)] - reference[static_cast<size_t>(k)]) / scale);
+
+        // Decimate the first length samples with the last 61 as taps; every output is bounded by
+        // the geometric mean of the two energies.
+        constexpr int numTaps = 61;
+        constexpr int stride = 7;
+        constexpr int numOutputs = (length - numTaps) / stride + 1;
+        const float* taps = x.data() + length;
+        std::array<float, numOutputs> filtered {};
+        std::array<float, numOutputs> filteredCandidate {};
+        decimateScalar(x.data(), taps, numTaps, numOutputs, stride, filtered.data());
+        getDecimate(isa)(x.data(), taps, numTaps, numOutputs, stride, filteredCandidate.data());
+
+        float tapEnergy = 0.0f;
+        for (int j = 0; j < numTaps; ++j)
+            tapEnergy += taps[j] * taps[j];
+        const float filterScale = std::max(std::sqrt(reference[0] * tapEnergy), 1.0e-12f);
+        for (int k = 0; k < numOutputs; ++k)
+            maxError = std::max(maxError, std::fabs(filteredCandidate[static_cast<size_t>(k)] - filtered[static_cast<size_t>(k)]) / filterScale);
+
+        // Condition three overlapping channels through the DC blocker, relative to the output's peak.
+        const std::array<const float*, 3> channels { x.data(), x.data() + 1, x.data() + numLags };
+        std::array<float, length> conditioned {};
+        std::array<float, length> conditionedCandidate {};
+        DcBlocker blocker { 0.995f, 0.25f, -0.125f };
+        DcBlocker blockerCandidate = blocker;
+        const auto levels = conditionScalar(channels.data(), 3, length, 0.5f, &blocker, conditioned.data());
+        const auto levelsCandidate = getCondition(isa)(channels.data(), 3, length, 0.5f, &blockerCandidate, conditionedCandidate.data());
+
+        const float peakScale = std::max(levels.peak, 1.0e-12f);
+        for (int n = 0; n < length; ++n)
+            maxError = std::max(maxError, std::fabs(conditionedCandidate[static_cast<size_t>(n)] - conditioned[static_cast<size_t>(n)]) / peakScale);
+        maxError = std::max(maxError, std::fabs(blockerCandidate.lastOutput - blocker.lastOutput) / peakScale);
+        maxError = std::max(maxError, std::fabs(levelsCandidate.peak - levels.peak) / peakScale);
+        maxError = std::max(maxError, std::fabs(levelsCandidate.sumSquares - levels.sumSquares) / std::max(levels.sumSquares, 1.0e-12f));
+        return maxError;
+    }
+
+    bool laneLagSumsMatchScalar(Isa isa)
+    {
+        constexpr int length = 131;
+        constexpr int numLags = 23;
+        const int lanes = getLaneCount(isa);
+        std::array<float, (length + numLags) * kWideLanes> interleaved {};
+        std::array<float, numLags * kWideLanes> laneOut {};
+        std::array<float, length + numLags> signal {};
+        std::array<float, numLags> reference {};
+
+        juce::uint32 seed = 0x9e3779b9u;
+        for (auto& sample : interleaved)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            sample = static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) - 0.5f;
+        }
+
+        std::array<int, numLags> lags {};
+        for (int k = 0; k < numLags; ++k)
+            lags[static_cast<size_t>(k)] = k;
+
+        // The whole list runs in overlapping multi-lag passes, a short one lag by lag.
+        for (const int count : { numLags, 5 })
+        {
+            getLaneLagSums(isa)(interleaved.data(), length, lags.data(), count, laneOut.data());
+
+            for (int lane = 0; lane < lanes; ++lane)
+            {
+                for (int j = 0; j < length + numLags; ++j)
+                    signal[static_cast<size_t>(j)] = interleaved[static_cast<size_t>(j * lanes + lane)];
+                lagSumsScalar(signal.data(), length, 0, count, reference.data());
+                for (int k = 0; k < count; ++k)
+                    if (laneOut[static_cast<size_t>(k * lanes + lane)] != reference[static_cast<size_t>(k)])
+                        return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// Lag-sum kernels for the autocorrelation search in PitchDetector.
+// Each kernel computes out[k] = sum_{j < length} x[firstLag + k + j] * x[j] for k in [0, numLags),
+// working on several adjacent lags per pass so every load of x[j] is reused from a register.
+//
+// Decimating FIR kernels for DecimatingFilter compute
+// out[k] = sum_{j < numTaps} x[k * stride + j] * taps[j] for k in [0, numOutputs),
+// i.e. only the outputs that survive decimation, with taps stored in reverse order.
+//
+// Lane kernels for PitchDetectorBatch run the lag sums of getLaneCount() signals at once. The
+// signals are interleaved, sample j of lane c at x[j * lanes + c], and the sum for lag lags[k] of
+// lane c goes to out[k * lanes + c]. Each lane is summed in ascending j like the scalar lag kernel,
+// so every lane matches it bit for bit. Lists of eight or more lags run eight lags per pass.
+//
+// Conditioning kernels for InputConditioner compute out[n] = scale * sum_c channels[c][n], optionally
+// followed by the one-pole DC blocker y[n] = m[n] - m[n-1] + pole * y[n-1], and return the sum of
+// squares and the peak magnitude of the output, all in one pass. out may be null when only the
+// levels are wanted. The channels are summed in order, so without the DC blocker every Isa writes
+// the same samples.
+namespace CorrelationKernels
+{
+    enum class Isa
+    {
+        scalar,
+        sse2,
+        avx2,
+        neon
+    };
+
+    using LagSumsFunction = void (*)(const float* x, int length, int firstLag, int numLags, float* out);
+    using LaneLagSumsFunction = void (*)(const float* x, int length, const int* lags, int numLags, float* out);
+    using DecimateFunction = void (*)(const float* x, const float* taps, int numTaps, int numOutputs, int stride, float* out);
+
+    struct DcBlocker
+    {
+        float pole = 0.0f;
+        float lastInput = 0.0f;
+        float lastOutput = 0.0f;
+    };
+
+    struct Levels
+    {
+        float sumSquares = 0.0f;
+        float peak = 0.0f;
+    };
+
+    using ConditionFunction = Levels (*)(const float* const* channels, int numChannels, int numSamples, float scale,
+                                         DcBlocker* dcBlocker, float* out);
+
+    // Best instruction set available on this CPU and compiled into this binary.
+    Isa detectIsa();
+    LagSumsFunction getLagSums(Isa isa);
+    DecimateFunction getDecimate(Isa isa);
+    ConditionFunction getCondition(Isa isa);
+    const char* getIsaName(Isa isa);
+
+    LaneLagSumsFunction getLaneLagSums(Isa isa);
+    // Signals per lane kernel pass: 8 for AVX2, 4 otherwise.
+    int getLaneCount(Isa isa);
+    // Whether the lane kernel reproduces the scalar lag kernel exactly in every lane.
+    bool laneLagSumsMatchScalar(Isa isa);
+
+    // Runs the given kernels against the scalar reference on a fixed noise signal and returns the
+    // largest error relative to the signal energy. The scalar kernels sum in the same order as
+    // the original loops, so it returns exactly 0 for Isa::scalar.
+    float measureMaxError(Isa isa);
+}
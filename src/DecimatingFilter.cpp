@@ -0,0 +1,93 @@
+#include "DecimatingFilter.h"
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+
+void DecimatingFilter::reserve(int maxFactor)
+{
+    const int maxTaps = 12 * std::max(1, maxFactor) + 1;
+    taps.reserve(static_cast<size_t>(maxTaps));
+    design.reserve(static_cast<size_t>(maxTaps));
+    buffer.reserve(static_cast<size_t>(maxTaps - 1 + kMaxChunk));
+}
+
+void DecimatingFilter::prepare(int newFactor, CorrelationKernels::Isa isa)
+{
+    factor = std::max(1, newFactor);
+    decimate = CorrelationKernels::getDecimate(isa);
+
+    if (factor == 1)
+    {
+        taps.clear();
+        buffer.clear();
+        phase = 0;
+        return;
+    }
+
+    // Blackman-windowed sinc. The transition band runs from about half to one and a half times
+    // the decimated Nyquist frequency, so nothing folds back below half of it, which is where
+    // the automatic factor puts maxFreq.
+    const int numTaps = 12 * factor + 1;
+    const int centre = numTaps / 2;
+    const double cutoff = 0.5 / static_cast<double>(factor);
+    const double pi = juce::MathConstants<double>::pi;
+
+    taps.assign(static_cast<size_t>(numTaps), 0.0f);
+    design.assign(static_cast<size_t>(numTaps), 0.0);
+    double sum = 0.0;
+    for (int n = 0; n < numTaps; ++n)
+    {
+        const int offset = n - centre;
+        const double sinc = offset == 0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * offset) / (pi * offset);
+        const double phaseAngle = 2.0 * pi * n / static_cast<double>(numTaps - 1);
+        const double blackman = 0.42 - 0.5 * std::cos(phaseAngle) + 0.08 * std::cos(2.0 * phaseAngle);
+        design[static_cast<size_t>(n)] = sinc * blackman;
+        sum += design[static_cast<size_t>(n)];
+    }
+
+    // Unity gain at DC, stored reversed.
+    for (int n = 0; n < numTaps; ++n)
+        taps[static_cast<size_t>(numTaps - 1 - n)] = static_cast<float>(design[static_cast<size_t>(n)] / sum);
+
+    buffer.assign(static_cast<size_t>(numTaps - 1 + kMaxChunk), 0.0f);
+    phase = 0;
+}
+
+void DecimatingFilter::reset()
+{
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    phase = 0;
+}
+
+void DecimatingFilter::saveState(std::vector<float>& history, int& statePhase) const
+{
+    const size_t historyLength = taps.empty() ? 0 : taps.size() - 1;
+    history.assign(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(historyLength));
+    statePhase = phase;
+}
+
+void DecimatingFilter::restoreState(const std::vector<float>& history, int statePhase)
+{
+    jassert(history.size() == (taps.empty() ? 0 : taps.size() - 1));
+    std::copy(history.begin(), history.end(), buffer.begin());
+    phase = statePhase;
+}
+
+int DecimatingFilter::process(const float* input, int numSamples, float* output)
+{
+    jassert(numSamples <= kMaxChunk);
+
+    const int numTaps = static_cast<int>(taps.size());
+    const int historyLength = numTaps - 1;
+    std::copy(input, input + numSamples, buffer.data() + historyLength);
+
+    // Output for input sample i is the dot product of the reversed taps with buffer[i, i + numTaps).
+    const int kept = phase < numSamples ? (numSamples - 1 - phase) / factor + 1 : 0;
+    if (kept > 0)
+        decimate(buffer.data() + phase, taps.data(), numTaps, kept, factor, output);
+
+    phase += kept * factor - numSamples;
+    std::copy(buffer.data() + numSamples, buffer.data() + numSamples + historyLength, buffer.data());
+    return kept;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "CorrelationKernels.h"
+
+// Low-pass FIR decimator in front of the pitch analysis buffer. Only the outputs that survive
+// decimation are computed (the polyphase saving), and the kept input indices follow the same
+// phase as the plain every-Nth-sample path so hop offsets do not move when it is switched on.
+class DecimatingFilter
+{
+public:
+    // Largest number of input samples process() accepts per call.
+    static constexpr int kMaxChunk = 1024;
+
+    // Allocates for factors up to maxFactor, so later prepare() calls do not allocate.
+    void reserve(int maxFactor);
+    // Designs a windowed-sinc low-pass with its cutoff at the decimated Nyquist frequency.
+    // A factor of 1 leaves the filter inactive.
+    void prepare(int factor, CorrelationKernels::Isa isa);
+    void reset();
+
+    bool isActive() const { return factor > 1; }
+    int getFactor() const { return factor; }
+    // Group delay of the linear-phase filter, in input samples.
+    int getLatency() const { return (static_cast<int>(taps.size()) - 1) / 2; }
+    // Offset within the next input chunk of the first sample that produces an output.
+    int getNextKeptOffset() const { return phase; }
+
+    // The input history and phase the next process() call depends on, for PitchDetector snapshots.
+    void saveState(std::vector<float>& history, int& statePhase) const;
+    void restoreState(const std::vector<float>& history, int statePhase);
+
+    // Filters up to kMaxChunk input samples and writes one output per kept input sample.
+    // Returns the number of outputs written, at most numSamples / factor + 1.
+    int process(const float* input, int numSamples, float* output);
+
+private:
+    // Reversed so each output is a forward dot product over the input history.
+    std::vector<float> taps;
+    // numTaps - 1 samples of history followed by the current chunk.
+    std::vector<float> buffer;
+    std::vector<double> design;
+    CorrelationKernels::DecimateFunction decimate = nullptr;
+    int factor = 1;
+    int phase = 0;
+};
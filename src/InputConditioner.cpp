@@ -0,0 +1,49 @@
+#include "InputConditioner.h"
+
+#include <algorithm>
+#include <cmath>
+
+void InputConditioner::prepare(double sampleRate, int samplesPerBlock)
+{
+    condition = CorrelationKernels::getCondition(CorrelationKernels::detectIsa());
+    dcBlocker.pole = static_cast<float>(std::exp(-2.0 * juce::MathConstants<double>::pi * kDcBlockHz / sampleRate));
+    buffer.assign(static_cast<size_t>(std::max(1, samplesPerBlock)), 0.0f);
+    reset();
+}
+
+void InputConditioner::reset()
+{
+    dcBlocker.lastInput = 0.0f;
+    dcBlocker.lastOutput = 0.0f;
+    dcBlockActive = false;
+    rms = 0.0f;
+    peak = 0.0f;
+}
+
+const float* InputConditioner::process(const float* const* channels, int numChannels, int numSamples, float gain, bool dcBlock)
+{
+    if (numChannels <= 0 || numSamples <= 0)
+    {
+        rms = 0.0f;
+        peak = 0.0f;
+        return buffer.data();
+    }
+
+    // The blocker starts from silence whenever it is switched on, rather than from a stale block.
+    if (dcBlock && !dcBlockActive)
+    {
+        dcBlocker.lastInput = 0.0f;
+        dcBlocker.lastOutput = 0.0f;
+    }
+    dcBlockActive = dcBlock;
+
+    const float scale = gain / static_cast<float>(numChannels);
+    const bool passThrough = numChannels == 1 && scale == 1.0f && !dcBlock;
+    jassert(passThrough || numSamples <= static_cast<int>(buffer.size()));
+
+    float* out = passThrough ? nullptr : buffer.data();
+    const auto levels = condition(channels, numChannels, numSamples, scale, dcBlock ? &dcBlocker : nullptr, out);
+    rms = std::sqrt(levels.sumSquares / static_cast<float>(numSamples));
+    peak = levels.peak;
+    return passThrough ? channels[0] : out;
+}
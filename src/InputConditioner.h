@@ -0,0 +1,40 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+#include "CorrelationKernels.h"
+
+// The front end of the analysis: downmixes the host's input channels with gain, optionally blocks
+// DC and sub-audio rumble, and measures the block's RMS and peak, all in one vectorised pass over
+// the input. A single channel that needs none of that is passed through untouched, so the
+// detector reads the host's buffer directly and only the level pass touches it.
+class InputConditioner
+{
+public:
+    // Corner of the DC blocker, below the lowest string of a five-string bass.
+    static constexpr double kDcBlockHz = 20.0;
+
+    // Not real-time safe: allocates the mono buffer for blocks of up to samplesPerBlock samples.
+    void prepare(double sampleRate, int samplesPerBlock);
+    // Audio thread.
+    void reset();
+
+    // Audio thread. Mixes numChannels channels scaled by gain / numChannels and returns the
+    // conditioned block, valid until the next call: channels[0] itself when it is a single
+    // channel at unity gain with the DC blocker off, the internal buffer otherwise. numSamples
+    // must not exceed prepare()'s samplesPerBlock; callers split longer blocks.
+    const float* process(const float* const* channels, int numChannels, int numSamples, float gain, bool dcBlock);
+
+    // Levels of the last block returned by process().
+    float getRms() const { return rms; }
+    float getPeak() const { return peak; }
+
+private:
+    CorrelationKernels::ConditionFunction condition = CorrelationKernels::getCondition(CorrelationKernels::Isa::scalar);
+    CorrelationKernels::DcBlocker dcBlocker;
+    std::vector<float> buffer;
+    bool dcBlockActive = false;
+    float rms = 0.0f;
+    float peak = 0.0f;
+};
@@ -0,0 +1,343 @@
+#include "MultiChannelTracker.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    // Busy-wait hint for the audio thread, which must not yield to the scheduler.
+    inline void spinPause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (defined(__GNUC__) || defined(__clang__))
+        __asm__ __volatile__("yield");
+       #endif
+    }
+}
+
+class MultiChannelTracker::Worker : public juce::Thread
+{
+public:
+    Worker(MultiChannelTracker& trackerToServe, double callbackMs)
+        : juce::Thread("Voice tracker"),
+          tracker(trackerToServe),
+          idleSpinMs(2.0 * callbackMs),
+          idleWaitMs(juce::jmax(1, static_cast<int>(callbackMs)))
+    {
+    }
+
+    void run() override
+    {
+        TraceRecorder::setThreadName("Voice tracker");
+        auto seen = tracker.publishedBlocks.load(std::memory_order_acquire);
+        double lastWorkMs = juce::Time::getMillisecondCounterHiRes();
+        while (!threadShouldExit())
+        {
+            const auto current = tracker.publishedBlocks.load(std::memory_order_acquire);
+            if (current != seen)
+            {
+                seen = current;
+                tracker.runQueuedVoices();
+                lastWorkMs = juce::Time::getMillisecondCounterHiRes();
+                continue;
+            }
+
+            // Stay awake between callbacks while the voices are shared out; otherwise look for a
+            // new block once per callback. The audio thread and any awake worker run the voices
+            // of blocks published meanwhile.
+            if (tracker.isParallel() && juce::Time::getMillisecondCounterHiRes() - lastWorkMs < idleSpinMs)
+            {
+                juce::Thread::yield();
+                continue;
+            }
+            tracker.wakeUp.wait(idleWaitMs);
+        }
+    }
+
+private:
+    MultiChannelTracker& tracker;
+    const double idleSpinMs;
+    const int idleWaitMs;
+};
+
+MultiChannelTracker::MultiChannelTracker() = default;
+
+MultiChannelTracker::~MultiChannelTracker()
+{
+    release();
+}
+
+void MultiChannelTracker::prepare(double sampleRate, int samplesPerBlock, int numVoices, const PitchDetector::Settings& settings)
+{
+    release();
+
+    const int blockSize = std::max(1, samplesPerBlock);
+    maxBlockSize = blockSize;
+    numVoices = juce::jlimit(0, kMaxVoices, numVoices);
+    for (int i = 0; i < numVoices; ++i)
+    {
+        auto voice = std::make_unique<Voice>();
+        voice->detector.prepare(sampleRate, blockSize, settings);
+        voice->conditioner.prepare(sampleRate, blockSize);
+        voice->detections.reserve(128);
+        voice->events.reserve(4);
+        voice->inputCopy.assign(static_cast<size_t>(blockSize), 0.0f);
+        voice->deliveredState = voice->segmenter.getState();
+        voices.push_back(std::move(voice));
+    }
+
+    const double callbackSeconds = static_cast<double>(blockSize) / sampleRate;
+    blockTicks = callbackSeconds * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    smoothedTicks = 0.0;
+    workerPeriodHz = 1.0 / callbackSeconds;
+    parallel.store(false, std::memory_order_relaxed);
+}
+
+void MultiChannelTracker::release()
+{
+    stopWorkers();
+    voices.clear();
+    parallel.store(false, std::memory_order_relaxed);
+}
+
+void MultiChannelTracker::setWorkersEnabled(bool shouldRun)
+{
+    if (shouldRun == workersEnabled)
+        return;
+
+    if (!shouldRun)
+    {
+        stopWorkers();
+        return;
+    }
+
+    workersEnabled = true;
+    // The audio thread takes voices too, so one voice needs no worker.
+    const int numWorkers = std::min({ kMaxWorkers, getNumVoices() - 1, juce::SystemStats::getNumCpus() - 1 });
+    const auto options = juce::Thread::RealtimeOptions {}.withPeriodHz(workerPeriodHz);
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto worker = std::make_unique<Worker>(*this, 1000.0 / workerPeriodHz);
+        if (!worker->startRealtimeThread(options))
+            break;
+        workers.push_back(std::move(worker));
+    }
+    runningWorkers.store(static_cast<int>(workers.size()), std::memory_order_release);
+}
+
+void MultiChannelTracker::stopWorkers()
+{
+    workersEnabled = false;
+    // A worker finishes any voice it has claimed before it exits, so no voice is left running;
+    // from here on the audio thread takes the voices itself.
+    runningWorkers.store(0, std::memory_order_release);
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+    wakeUp.signal();
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+    workers.clear();
+    wakeUp.reset();
+}
+
+void MultiChannelTracker::applySettings(const PitchDetector::Settings& settings)
+{
+    pendingSettings = settings;
+    for (auto& voice : voices)
+    {
+        if (voice->state.load(std::memory_order_acquire) == idle)
+            voice->detector.applySettings(settings);
+        else
+            voice->settingsPending = true;
+    }
+}
+
+void MultiChannelTracker::reset()
+{
+    for (auto& voice : voices)
+    {
+        if (voice->state.load(std::memory_order_acquire) == idle)
+            resetVoice(*voice);
+        else
+            voice->resetPending = true;
+        voice->eventsReady = false;
+        voice->deliveredState = NoteSegmenter::State {};
+    }
+}
+
+void MultiChannelTracker::processBlock(const float* const* channels, int numChannels, int numSamples, float gain, bool dcBlock,
+                                       juce::int64 blockStartSample, int blockSize, const NoteSegmenter::Settings& segmenterSettings)
+{
+    MYK_TRACE_SCOPE("voices");
+    const auto start = juce::Time::getHighResolutionTicks();
+    // The voices' conditioners are sized for the prepared block size.
+    jassert(numSamples <= maxBlockSize);
+    numSamples = std::min(numSamples, maxBlockSize);
+    const int count = numSamples > 0 ? std::min(numChannels, getNumVoices()) : 0;
+
+    juce::uint32 queuedVoices = 0;
+    for (int i = 0; i < getNumVoices(); ++i)
+    {
+        const float* channel = i < count ? channels[i] : nullptr;
+        if (queueVoice(*voices[static_cast<size_t>(i)], channel, numSamples, gain, dcBlock, blockStartSample, blockSize, segmenterSettings))
+            queuedVoices |= 1u << i;
+    }
+    if (queuedVoices == 0)
+        return;
+
+    const bool hasWorkers = runningWorkers.load(std::memory_order_acquire) > 0;
+    if (isParallel() && hasWorkers)
+        publishedBlocks.fetch_add(1, std::memory_order_release);
+    runQueuedVoices();
+
+    // Every voice is claimed now; wait for the ones a worker is running until the deadline.
+    const auto deadline = start + static_cast<juce::int64>(waitLimit * blockTicks);
+    juce::int64 totalTicks = 0;
+    for (int i = 0; i < getNumVoices(); ++i)
+    {
+        if ((queuedVoices & (1u << i)) == 0)
+            continue;
+
+        auto& voice = *voices[static_cast<size_t>(i)];
+        while (voice.state.load(std::memory_order_acquire) != idle && juce::Time::getHighResolutionTicks() < deadline)
+            spinPause();
+
+        if (voice.state.load(std::memory_order_acquire) != idle)
+        {
+            voice.late = true;
+            lateVoices.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        voice.eventsReady = true;
+        voice.deliveredState = voice.segmenter.getState();
+        totalTicks += voice.elapsedTicks;
+    }
+
+    // What the voices would take one after the other, smoothed over a few dozen blocks.
+    smoothedTicks += 0.05 * (static_cast<double>(totalTicks) - smoothedTicks);
+
+    const double threshold = parallelThreshold * blockTicks;
+    if (!isParallel() && smoothedTicks > threshold && hasWorkers)
+        parallel.store(true, std::memory_order_relaxed);
+    else if (isParallel() && (smoothedTicks < 0.5 * threshold || !hasWorkers))
+        parallel.store(false, std::memory_order_relaxed);
+}
+
+const std::vector<NoteSegmenter::Event>& MultiChannelTracker::getEvents(int voice) const
+{
+    const auto& tracked = *voices[static_cast<size_t>(voice)];
+    return tracked.eventsReady ? tracked.events : noEvents;
+}
+
+float MultiChannelTracker::getRms(int voice) const
+{
+    return voices[static_cast<size_t>(voice)]->conditioner.getRms();
+}
+
+float MultiChannelTracker::getPeak(int voice) const
+{
+    return voices[static_cast<size_t>(voice)]->conditioner.getPeak();
+}
+
+NoteSegmenter::State MultiChannelTracker::getSegmenterState(int voice) const
+{
+    return voices[static_cast<size_t>(voice)]->deliveredState;
+}
+
+int MultiChannelTracker::getLatencySamples() const
+{
+    // Every voice runs the same settings.
+    return voices.empty() ? 0 : voices.front()->detector.getLatencySamples();
+}
+
+bool MultiChannelTracker::queueVoice(Voice& voice, const float* channel, int numSamples, float gain, bool dcBlock,
+                                     juce::int64 blockStartSample, int blockSize, const NoteSegmenter::Settings& segmenterSettings)
+{
+    voice.eventsReady = false;
+    // Still running the block it was late with: this block's input is skipped.
+    if (voice.state.load(std::memory_order_acquire) != idle)
+        return false;
+
+    if (voice.late)
+    {
+        // Finished since: its events go out with this block instead of this block's input,
+        // unless the voice was reset in the meantime.
+        voice.late = false;
+        if (!voice.resetPending)
+        {
+            voice.eventsReady = true;
+            voice.deliveredState = voice.segmenter.getState();
+            return false;
+        }
+    }
+    if (voice.resetPending)
+        resetVoice(voice);
+    if (voice.settingsPending)
+    {
+        voice.detector.applySettings(pendingSettings);
+        voice.settingsPending = false;
+    }
+
+    if (channel == nullptr)
+    {
+        voice.events.clear();
+        voice.conditioner.reset();
+        return false;
+    }
+
+    const float* input = voice.conditioner.process(&channel, 1, numSamples, gain, dcBlock);
+    if (input == channel)
+    {
+        std::copy_n(channel, numSamples, voice.inputCopy.data());
+        input = voice.inputCopy.data();
+    }
+    voice.input = input;
+    voice.numSamples = numSamples;
+    voice.rms = voice.conditioner.getRms();
+    voice.blockStart = blockStartSample;
+    voice.blockSize = blockSize;
+    voice.segmenterSettings = segmenterSettings;
+    voice.state.store(queued, std::memory_order_release);
+    return true;
+}
+
+void MultiChannelTracker::runQueuedVoices()
+{
+    for (auto& voice : voices)
+    {
+        int expected = queued;
+        if (!voice->state.compare_exchange_strong(expected, running, std::memory_order_acquire, std::memory_order_relaxed))
+            continue;
+
+        processVoice(*voice);
+        voice->state.store(idle, std::memory_order_release);
+    }
+}
+
+void MultiChannelTracker::processVoice(Voice& voice)
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    voice.detector.processBlock(voice.input, voice.numSamples, voice.detections);
+    voice.segmenter.processBlock(voice.detections, voice.blockStart, voice.blockSize, voice.rms, voice.segmenterSettings, voice.events);
+    voice.elapsedTicks = juce::Time::getHighResolutionTicks() - start;
+}
+
+void MultiChannelTracker::resetVoice(Voice& voice)
+{
+    voice.detector.reset();
+    voice.segmenter.reset();
+    voice.conditioner.reset();
+    voice.events.clear();
+    voice.late = false;
+    voice.resetPending = false;
+    voice.deliveredState = voice.segmenter.getState();
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "InputConditioner.h"
+#include "NoteSegmenter.h"
+#include "PitchDetector.h"
+
+// Tracks each input channel as its own monophonic voice, for divided (hexaphonic) pickups and
+// multi-mic ensembles: every voice has its own PitchDetector, NoteSegmenter and level.
+//
+// While the voices cost less than parallelThreshold of a block's duration they run one after the
+// other on the audio thread. Above it, each callback shares them out between the audio thread and
+// a few real-time worker threads. The audio thread conditions every voice's input itself, queues
+// the voices and publishes the block with one atomic increment; every thread then claims queued
+// voices one at a time until none are left, so a worker that is asleep simply leaves its share to
+// the others. The audio thread takes no lock and waits for voices a worker is still running only
+// until waitLimit of the block's duration has passed. A voice that misses it is late: its events
+// arrive with the next block and it skips that block's input. The workers only exist while
+// setWorkersEnabled() has them on, and only with real-time priority; without them every voice
+// runs on the audio thread.
+class MultiChannelTracker
+{
+public:
+    static constexpr int kMaxVoices = 16;
+    static constexpr int kMaxWorkers = 3;
+
+    MultiChannelTracker();
+    ~MultiChannelTracker();
+
+    // Not real-time safe: stops the workers and allocates numVoices voices. numVoices is clamped
+    // to kMaxVoices; 0 releases everything.
+    void prepare(double sampleRate, int samplesPerBlock, int numVoices, const PitchDetector::Settings& settings);
+    void release();
+
+    // Message thread. Starts or stops the worker threads; does nothing when they already match.
+    // Workers the system will not give real-time priority are not started, since the audio thread
+    // spins while it waits for them.
+    void setWorkersEnabled(bool shouldRun);
+
+    // Audio thread. A voice that is still running late is updated once it has finished.
+    void applySettings(const PitchDetector::Settings& settings);
+    void reset();
+
+    // Audio thread. Conditions channel i with gain and the optional DC blocker and runs voice i
+    // over it, for the first min(numChannels, getNumVoices()) channels; the other voices get no
+    // events. numSamples must not exceed prepare()'s samplesPerBlock.
+    void processBlock(const float* const* channels, int numChannels, int numSamples, float gain, bool dcBlock,
+                      juce::int64 blockStartSample, int blockSize, const NoteSegmenter::Settings& segmenterSettings);
+
+    int getNumVoices() const { return static_cast<int>(voices.size()); }
+    // The note events and level a voice delivered with the last block, and the segmenter state
+    // that follows from every event it has delivered so far.
+    const std::vector<NoteSegmenter::Event>& getEvents(int voice) const;
+    float getRms(int voice) const;
+    float getPeak(int voice) const;
+    NoteSegmenter::State getSegmenterState(int voice) const;
+    int getLatencySamples() const;
+
+    // Whether the last block was shared out between threads.
+    bool isParallel() const { return parallel.load(std::memory_order_relaxed); }
+    // Voice blocks that missed the audio thread's deadline.
+    juce::int64 getLateVoices() const { return lateVoices.load(std::memory_order_relaxed); }
+
+private:
+    class Worker;
+
+    // A voice is queued by the audio thread, claimed by whichever thread moves it to running, and
+    // back to idle once its block is done.
+    enum VoiceState
+    {
+        idle,
+        queued,
+        running
+    };
+
+    struct Voice
+    {
+        PitchDetector detector;
+        NoteSegmenter segmenter;
+        InputConditioner conditioner;
+        std::vector<PitchDetector::Detection> detections;
+        std::vector<NoteSegmenter::Event> events;
+        juce::int64 elapsedTicks = 0;
+        std::atomic<int> state { idle };
+
+        // The block a queued voice runs, written by the audio thread before it is queued. The
+        // input is copied here when the conditioner passes the host's channel through, so a late
+        // voice never reads the host's buffer after processBlock() has returned.
+        std::vector<float> inputCopy;
+        const float* input = nullptr;
+        int numSamples = 0;
+        float rms = 0.0f;
+        juce::int64 blockStart = 0;
+        int blockSize = 0;
+        NoteSegmenter::Settings segmenterSettings;
+
+        // Audio thread only.
+        bool late = false;
+        bool eventsReady = false;
+        bool settingsPending = false;
+        bool resetPending = false;
+        NoteSegmenter::State deliveredState;
+    };
+
+    bool queueVoice(Voice& voice, const float* channel, int numSamples, float gain, bool dcBlock,
+                    juce::int64 blockStartSample, int blockSize, const NoteSegmenter::Settings& segmenterSettings);
+    void runQueuedVoices();
+    void processVoice(Voice& voice);
+    void resetVoice(Voice& voice);
+    void stopWorkers();
+
+    std::vector<std::unique_ptr<Voice>> voices;
+    std::vector<std::unique_ptr<Worker>> workers;
+    const std::vector<NoteSegmenter::Event> noEvents;
+    // Audio thread: the settings voices that were running late still have to apply.
+    PitchDetector::Settings pendingSettings;
+    int maxBlockSize = 0;
+
+    // Counts the blocks whose voices were shared out; workers look for queued voices when it moves.
+    std::atomic<juce::uint32> publishedBlocks { 0 };
+    std::atomic<bool> parallel { false };
+    std::atomic<juce::int64> lateVoices { 0 };
+
+    // The message thread owns workers; the audio thread only sees how many are running.
+    bool workersEnabled = false;
+    std::atomic<int> runningWorkers { 0 };
+    // Only stopWorkers() signals it; the audio thread never does, since that takes a lock.
+    juce::WaitableEvent wakeUp { true };
+    double workerPeriodHz = 0.0;
+
+    // Fraction of the block's duration the voices may take together before they are shared out;
+    // they go back to the audio thread alone below half of it.
+    static constexpr double parallelThreshold = 0.25;
+    // Fraction of the block's duration, from the start of processBlock(), the audio thread waits
+    // for voices a worker is still running.
+    static constexpr double waitLimit = 0.5;
+    double blockTicks = 0.0;
+    double smoothedTicks = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiChannelTracker)
+};
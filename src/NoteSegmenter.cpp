@@ -0,0 +1,157 @@
+#include "NoteSegmenter.h"
+
+#include <cmath>
+
+void NoteSegmenter::reset()
+{
+    currentActiveNote = -1;
+    currentActiveNoteStartSample = -1;
+    silenceForNSamples = -1;
+    noteDetected.fill(false);
+    noteOffNeeded.fill(false);
+}
+
+NoteSegmenter::State NoteSegmenter::getState() const
+{
+    return { currentActiveNote, currentActiveNoteStartSample, silenceForNSamples, noteDetected, noteOffNeeded };
+}
+
+void NoteSegmenter::setState(const State& state)
+{
+    currentActiveNote = state.currentActiveNote;
+    currentActiveNoteStartSample = state.currentActiveNoteStartSample;
+    silenceForNSamples = state.silenceForNSamples;
+    noteDetected = state.noteDetected;
+    noteOffNeeded = state.noteOffNeeded;
+}
+
+bool NoteSegmenter::isEquivalent(const State& a, const State& b, const Settings& settings)
+{
+    if (a.currentActiveNote != b.currentActiveNote || a.noteDetected != b.noteDetected || a.noteOffNeeded != b.noteOffNeeded)
+        return false;
+
+    // With no note playing, the next detection sets both counters before either is read (the
+    // detector's minFreq keeps detections well above MIDI note 0).
+    if (a.currentActiveNote == -1)
+        return true;
+
+    // Silence is only ever compared against the minimum note length, and stays longer once it is.
+    const juce::int64 limit = settings.minNoteLengthSamples;
+    const bool sameSilence = a.silenceForNSamples == b.silenceForNSamples
+        || (a.silenceForNSamples > limit && b.silenceForNSamples > limit);
+    return sameSilence && a.currentActiveNoteStartSample == b.currentActiveNoteStartSample;
+}
+
+void NoteSegmenter::processBlock(const std::vector<PitchDetector::Detection>& detections, juce::int64 blockStartSample,
+                                 int blockSize, float rms, const Settings& settings, std::vector<Event>& events)
+{
+    events.clear();
+
+    const juce::int64 minAllowedNoteLenSamples = settings.minNoteLengthSamples;
+    int noteOnToSend = -1;
+    int noteOffToSend = -1;
+    int noteOffSampleOffset = 0;
+    int noteOnSampleOffset = 0;
+    int velToPlay = -1;
+    juce::int64 timeSinceNoteStartSamples = 0;
+
+    InstrumentState playerState = InstrumentState::LongSilence;
+
+    // first detect silence
+    if (detections.size() == 0){// silence
+        silenceForNSamples += blockSize;
+
+        if (silenceForNSamples > minAllowedNoteLenSamples && // long silence
+            currentActiveNote != -1){ // was playing a note
+                playerState = InstrumentState::NoteEndedNowSilentSendNoteOff;
+                // reset it
+                noteDetected[static_cast<size_t>(currentActiveNote)] = false;
+
+                noteOffToSend = currentActiveNote;
+                noteOffSampleOffset = blockSize - 1;// give it some grace at the end
+                currentActiveNote = -1;
+            }
+    }
+    if (detections.size() > 0){// notes
+        silenceForNSamples = 0;// reset that one
+        const PitchDetector::Detection newNoteData = detections[0];// only ever one actually
+        if (currentActiveNote != -1){// we are playing
+            timeSinceNoteStartSamples = (blockStartSample + newNoteData.sampleOffset) - currentActiveNoteStartSample;
+        }
+        else{
+            timeSinceNoteStartSamples = 0;
+        }
+        int newNoteMidiNum = static_cast<int>(std::lround(69.0 + 12.0 * std::log2(newNoteData.freq / 440.0)));
+        // Keeps the note tables in range for detections outside the MIDI range.
+        newNoteMidiNum = juce::jlimit(0, 126, newNoteMidiNum);
+        if (currentActiveNote == -1 &&// was not playing
+            newNoteMidiNum > 0){// is playing now
+                playerState = InstrumentState::NoteAfterSilence;
+                // start the timer
+                currentActiveNoteStartSample = blockStartSample + newNoteData.sampleOffset;
+        }
+        if (currentActiveNote != -1 &&// was playing
+            newNoteMidiNum != currentActiveNote){// note changed
+                noteDetected[static_cast<size_t>(currentActiveNote)] = false; // reset this so i can request it next time i get this note
+                playerState = InstrumentState::NoteAfterOtherNote;
+                // reset note start time for new note
+                currentActiveNoteStartSample = blockStartSample + newNoteData.sampleOffset;
+                // prepare to send a note off for the old note
+                noteOffToSend = currentActiveNote;
+                noteOffSampleOffset = newNoteData.sampleOffset;
+        }
+
+        if (currentActiveNote != -1 &&// was playing
+            newNoteMidiNum == currentActiveNote){// still playing same note
+                playerState = InstrumentState::NoteHeldNotLongEnoughYet;// assume its too short
+
+                // is the held note held long enough to
+                // allow a note on message?
+                if (timeSinceNoteStartSamples > minAllowedNoteLenSamples){
+                    if (noteDetected[static_cast<size_t>(currentActiveNote)]){// already requested a note on
+                        playerState = InstrumentState::NoteHeldNoteOnSent;
+                    }
+                    else{// its long enough and we've not requested a note on yet
+                        playerState = InstrumentState::NoteLongEnoughSendNoteOn;
+                        noteDetected[static_cast<size_t>(currentActiveNote)] = true;
+                        noteOnToSend = currentActiveNote;
+                        noteOnSampleOffset = newNoteData.sampleOffset;
+                        velToPlay = juce::jlimit(settings.minVelocity, 127, static_cast<int>(rms  * 127.0f));
+                    }
+                }
+        }
+        currentActiveNote = newNoteMidiNum;
+    }
+
+    switch (playerState)
+    {
+        case InstrumentState::NoteAfterOtherNote:{
+            if (!noteOffNeeded[static_cast<size_t>(noteOffToSend)]){// note is not on
+                break;
+            }
+            // only if we actually sent an on for this note
+            events.push_back({ noteOffToSend, false, 0, noteOffSampleOffset });
+            noteOffNeeded[static_cast<size_t>(noteOffToSend)] = false;
+            break;
+        }
+        case InstrumentState::NoteLongEnoughSendNoteOn:{
+            events.push_back({ noteOnToSend, true, velToPlay, noteOnSampleOffset });
+            noteOffNeeded[static_cast<size_t>(noteOnToSend)] = true;
+            break;
+        }
+        case InstrumentState::NoteEndedNowSilentSendNoteOff:{
+            if (!noteOffNeeded[static_cast<size_t>(noteOffToSend)]){// not on - don't need note off
+                break;
+            }
+            events.push_back({ noteOffToSend, false, 0, noteOffSampleOffset });
+            noteOffNeeded[static_cast<size_t>(noteOffToSend)] = false;
+            break;
+        }
+        case InstrumentState::LongSilence:
+        case InstrumentState::ShortSilence:
+        case InstrumentState::NoteAfterSilence:
+        case InstrumentState::NoteHeldNotLongEnoughYet:
+        case InstrumentState::NoteHeldNoteOnSent:
+            break;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+#include "PitchDetector.h"
+
+// * Long / real silence ( silence > minNoteLen) detected
+// * Short silence / but note still playing (silence < minNoteLen) detected
+// * Started a note after silence
+// * Started a note after another note
+// * Ended a note
+// * Note played for long enough to trigger note on
+enum class InstrumentState{
+  LongSilence,
+  ShortSilence,
+  NoteAfterSilence,
+  NoteAfterOtherNote,
+  NoteHeldNotLongEnoughYet,
+  NoteLongEnoughSendNoteOn,
+  NoteHeldNoteOnSent,
+  NoteEndedNowSilentSendNoteOff,
+};
+
+// Turns each block's pitch detections into MIDI note-on/off decisions. A note is only sent once
+// it has been held for minNoteLengthSamples, and ends after that long without detections.
+// Shared by the plugin processor and the offline tools so both segment notes identically.
+class NoteSegmenter
+{
+public:
+    struct Settings
+    {
+        juce::int64 minNoteLengthSamples = 0;
+        int minVelocity = 0;
+    };
+
+    struct Event
+    {
+        int note = 0;
+        bool noteOn = false;
+        // 1..127 for note-ons, 0 for note-offs.
+        int velocity = 0;
+        int sampleOffset = 0;
+    };
+
+    // The note being tracked and the notes sent so far, for moving a stream between segmenters.
+    struct State
+    {
+        int currentActiveNote = -1;
+        juce::int64 currentActiveNoteStartSample = -1;
+        juce::int64 silenceForNSamples = -1;
+        std::array<bool, 127> noteDetected {};
+        std::array<bool, 127> noteOffNeeded {};
+    };
+
+    void reset();
+    State getState() const;
+    void setState(const State& state);
+    // True when both states send the same events for any further input under these settings,
+    // even where their counters differ.
+    static bool isEquivalent(const State& a, const State& b, const Settings& settings);
+
+    // Appends at most one event per block to `events`, which is cleared first. Only the first
+    // detection of the block is used. blockSize is the host's nominal block size, which sets how
+    // much silence a block without detections counts for.
+    void processBlock(const std::vector<PitchDetector::Detection>& detections, juce::int64 blockStartSample,
+                      int blockSize, float rms, const Settings& settings, std::vector<Event>& events);
+
+    int getActiveNote() const { return currentActiveNote; }
+
+private:
+    int currentActiveNote = -1;
+    juce::int64 currentActiveNoteStartSample = -1;
+    juce::int64 silenceForNSamples = -1;
+
+    std::array<bool, 127> noteDetected {};
+    std::array<bool, 127> noteOffNeeded {};
+};
@@ -0,0 +1,140 @@
+#include "OfflineTranscriber.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+OfflineTranscriber::Settings OfflineTranscriber::getDefaultSettings()
+{
+    Settings defaults;
+    defaults.detector.execFreq = 100.0f;
+    defaults.detector.medianSize = 7;
+    defaults.detector.clarity = true;
+    return defaults;
+}
+
+void OfflineTranscriber::prepare(double sampleRate, const Settings& newSettings, juce::int64 startSample)
+{
+    settings = newSettings;
+    settings.blockSize = std::max(1, settings.blockSize);
+    detector.prepare(sampleRate, settings.blockSize, settings.detector);
+    segmenter.reset();
+    segmenterSettings.minNoteLengthSamples = static_cast<juce::int64>(settings.minNoteSeconds * sampleRate);
+    segmenterSettings.minVelocity = settings.minVelocity;
+    conditioner.prepare(sampleRate, settings.blockSize);
+    detections.clear();
+    detections.reserve(128);
+    samplePosition = startSample;
+}
+
+void OfflineTranscriber::processBlock(const float* const* channels, int numChannels, int numSamples, std::vector<Event>& events)
+{
+    jassert(numSamples <= settings.blockSize);
+    numSamples = std::min(numSamples, settings.blockSize);
+    if (numSamples <= 0 || numChannels <= 0)
+        return;
+
+    // Same conditioning and level as TestPluginAudioProcessor::processBlock with the DC blocker off,
+    // its default.
+    const float* input = conditioner.process(channels, numChannels, numSamples, settings.gain, false);
+    detector.processBlock(input, numSamples, detections);
+    segmenter.processBlock(detections, samplePosition, settings.blockSize, conditioner.getRms(), segmenterSettings, blockEvents);
+    // Dated by the input they describe, as the host would after compensating the reported latency.
+    const int latency = detector.getLatencySamples();
+    for (const auto& event : blockEvents)
+        events.push_back({ std::max<juce::int64>(0, samplePosition + event.sampleOffset - latency), event.note, event.velocity, event.noteOn });
+
+    samplePosition += numSamples;
+}
+
+void OfflineTranscriber::saveState(State& state) const
+{
+    detector.saveState(state.detector);
+    state.segmenter = segmenter.getState();
+    state.samplePosition = samplePosition;
+}
+
+void OfflineTranscriber::restoreState(const State& state)
+{
+    detector.restoreState(state.detector);
+    segmenter.setState(state.segmenter);
+    samplePosition = state.samplePosition;
+}
+
+bool OfflineTranscriber::isEquivalent(const State& a, const State& b) const
+{
+    return a.samplePosition == b.samplePosition
+        && a.detector == b.detector
+        && NoteSegmenter::isEquivalent(a.segmenter, b.segmenter, segmenterSettings);
+}
+
+bool OfflineTranscriber::transcribe(juce::AudioFormatReader& reader, const Settings& analysisSettings, Result& result)
+{
+    result.sampleRate = reader.sampleRate;
+    result.numSamples = reader.lengthInSamples;
+    result.events.clear();
+    if (reader.sampleRate <= 0.0 || reader.numChannels == 0)
+        return false;
+
+    OfflineTranscriber transcriber;
+    transcriber.prepare(reader.sampleRate, analysisSettings);
+
+    const int blockSize = transcriber.settings.blockSize;
+    juce::AudioBuffer<float> buffer(static_cast<int>(reader.numChannels), blockSize);
+    for (juce::int64 start = 0; start < reader.lengthInSamples; start += blockSize)
+    {
+        const int count = static_cast<int>(std::min<juce::int64>(blockSize, reader.lengthInSamples - start));
+        if (!reader.read(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, count))
+            return false;
+        transcriber.processBlock(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), count, result.events);
+    }
+    return true;
+}
+
+juce::MidiFile OfflineTranscriber::createMidiFile(const Result& result)
+{
+    constexpr int ticksPerQuarterNote = 960;
+    constexpr double ticksPerSecond = ticksPerQuarterNote * 2.0;
+
+    const double ticksPerSample = result.sampleRate > 0.0 ? ticksPerSecond / result.sampleRate : 0.0;
+    auto toTicks = [&](juce::int64 sample) { return std::round(static_cast<double>(sample) * ticksPerSample); };
+
+    juce::MidiMessageSequence track;
+    track.addEvent(juce::MidiMessage::tempoMetaEvent(500000), 0.0);
+
+    std::array<bool, 128> sounding {};
+    for (const auto& event : result.events)
+    {
+        if (event.noteOn)
+            track.addEvent(juce::MidiMessage::noteOn(1, event.note, static_cast<juce::uint8>(event.velocity)), toTicks(event.samplePosition));
+        else
+            track.addEvent(juce::MidiMessage::noteOff(1, event.note), toTicks(event.samplePosition));
+        sounding[static_cast<size_t>(event.note)] = event.noteOn;
+    }
+
+    const double endTicks = toTicks(result.numSamples);
+    for (int note = 0; note < 128; ++note)
+        if (sounding[static_cast<size_t>(note)])
+            track.addEvent(juce::MidiMessage::noteOff(1, note), endTicks);
+    track.addEvent(juce::MidiMessage::endOfTrack(), endTicks);
+    track.updateMatchedPairs();
+
+    juce::MidiFile midiFile;
+    midiFile.setTicksPerQuarterNote(ticksPerQuarterNote);
+    midiFile.addTrack(track);
+    return midiFile;
+}
+
+bool OfflineTranscriber::writeMidiFile(const Result& result, const juce::File& file)
+{
+    if (!file.getParentDirectory().createDirectory())
+        return false;
+
+    juce::FileOutputStream stream(file);
+    if (!stream.openedOk())
+        return false;
+
+    stream.setPosition(0);
+    stream.truncate();
+    return createMidiFile(result).writeTo(stream, 1);
+}
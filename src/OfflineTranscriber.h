@@ -0,0 +1,87 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+#include "InputConditioner.h"
+#include "NoteSegmenter.h"
+#include "PitchDetector.h"
+
+// Runs the plugin's analysis chain (InputConditioner, PitchDetector, NoteSegmenter) over
+// recorded audio as fast as the CPU allows and collects the notes processBlock would have sent.
+// One instance per thread; it allocates in prepare() and while collecting events.
+class OfflineTranscriber
+{
+public:
+    struct Settings
+    {
+        PitchDetector::Settings detector;
+        int blockSize = 256;
+        float gain = 1.0f;
+        // The plugin's "Min note len" parameter, in seconds.
+        float minNoteSeconds = 0.05f;
+        int minVelocity = 0;
+    };
+
+    struct Event
+    {
+        juce::int64 samplePosition = 0;
+        int note = 0;
+        // 1..127 for note-ons, 0 for note-offs.
+        int velocity = 0;
+        bool noteOn = false;
+    };
+
+    struct Result
+    {
+        double sampleRate = 0.0;
+        juce::int64 numSamples = 0;
+        std::vector<Event> events;
+    };
+
+    // Everything processBlock() carries from one block to the next.
+    struct State
+    {
+        PitchDetector::State detector;
+        NoteSegmenter::State segmenter;
+        juce::int64 samplePosition = 0;
+    };
+
+    // The plugin's parameter defaults, except for a 10 ms hop and a 50 ms minimum note length:
+    // the plugin's own defaults clamp execFreq up to minFreq and retrigger notes on every hop.
+    static Settings getDefaultSettings();
+
+    // startSample is the stream position of the first block, for starting part way into a recording.
+    void prepare(double sampleRate, const Settings& newSettings, juce::int64 startSample = 0);
+
+    // Downmixes and analyses up to blockSize samples starting at the stream's current position,
+    // appending any note events with absolute sample positions.
+    void processBlock(const float* const* channels, int numChannels, int numSamples, std::vector<Event>& events);
+
+    juce::int64 getSamplePosition() const { return samplePosition; }
+    const PitchDetector& getDetector() const { return detector; }
+
+    // Moves a stream between transcribers prepared with the same sample rate and settings.
+    void saveState(State& state) const;
+    void restoreState(const State& state);
+    // True when both states give the same events for the same further input.
+    bool isEquivalent(const State& a, const State& b) const;
+
+    // Reads the whole file from reader in blocks and analyses it.
+    static bool transcribe(juce::AudioFormatReader& reader, const Settings& analysisSettings, Result& result);
+
+    // Type 1 file at 960 ticks per quarter note and 120 bpm, with the notes on channel 1. Notes
+    // still sounding at the end are closed there.
+    static juce::MidiFile createMidiFile(const Result& result);
+    static bool writeMidiFile(const Result& result, const juce::File& file);
+
+private:
+    Settings settings;
+    PitchDetector detector;
+    NoteSegmenter segmenter;
+    NoteSegmenter::Settings segmenterSettings;
+    InputConditioner conditioner;
+    std::vector<PitchDetector::Detection> detections;
+    std::vector<NoteSegmenter::Event> blockEvents;
+    juce::int64 samplePosition = 0;
+};
@@ -1,5 +1,6 @@
 #include "OpenGLPianoRollComponent.h"
 #include "BasicPitchConstants.h"
+#include "TraceRecorder.h"
 #include <algorithm>
 #include <cmath>
 
@@ -35,7 +36,10 @@ void OpenGLPianoRollComponent::noteOn(int note, float velocity, double timeSecon
     if (note < 0 || note >= static_cast<int>(activeNotes.size()))
         return;
 
+    // The outer scope includes waiting for the lock, the inner one only holding it.
+    MYK_TRACE_SCOPE("piano roll noteOn");
     juce::SpinLock::ScopedLockType lock(dataLock);
+    MYK_TRACE_SCOPE("dataLock held");
 
     const double wallNow = juce::Time::getMillisecondCounterHiRes() * 0.001;
     if (!hasWallToNoteOffset || timeSeconds + 0.1 < currentTimeSeconds)
@@ -66,7 +70,9 @@ void OpenGLPianoRollComponent::noteOff(int note, double timeSeconds)
     if (note < 0 || note >= static_cast<int>(activeNotes.size()))
         return;
 
+    MYK_TRACE_SCOPE("piano roll noteOff");
     juce::SpinLock::ScopedLockType lock(dataLock);
+    MYK_TRACE_SCOPE("dataLock held");
 
     const double wallNow = juce::Time::getMillisecondCounterHiRes() * 0.001;
     if (!hasWallToNoteOffset || timeSeconds + 0.1 < currentTimeSeconds)
@@ -182,7 +188,9 @@ bool OpenGLPianoRollComponent::keyPressed(const juce::KeyPress& key)
 void OpenGLPianoRollComponent::timerCallback()
 {
     {
+        MYK_TRACE_SCOPE("piano roll timer");
         juce::SpinLock::ScopedLockType lock(dataLock);
+        MYK_TRACE_SCOPE("dataLock held");
         if (isFrozen)
             return;
 
@@ -269,6 +277,8 @@ void OpenGLPianoRollComponent::newOpenGLContextCreated()
 
 void OpenGLPianoRollComponent::renderOpenGL()
 {
+    TraceRecorder::setThreadName("OpenGL");
+    MYK_TRACE_SCOPE("GL frame");
     if (shader == nullptr)
         return;
 
@@ -290,13 +300,19 @@ void OpenGLPianoRollComponent::renderOpenGL()
     if (staticGeometryDirty.load())
     {
         juce::SpinLock::ScopedLockType lock(dataLock);
+        MYK_TRACE_SCOPE("dataLock held");
         rebuildStaticGeometry();
         staticGeometryDirty.store(false);
     }
 
     juce::SpinLock::ScopedTryLockType lock(dataLock);
     if (!lock.isLocked())
+    {
+        // The message thread holds the note data, so this frame is skipped.
+        TraceRecorder::instant("dataLock busy");
         return;
+    }
+    MYK_TRACE_SCOPE("dataLock held");
 
     const juce::Rectangle<float> area(0.0f, 0.0f, width, height);
     const double currentTime = isFrozen ? freezeTimeSeconds
@@ -1,8 +1,9 @@
 #include "PitchDetector.h"
+#include "TraceRecorder.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
-#include <JuceHeader.h>
 
 int PitchDetector::log2ceil(int x)
 {
@@ -57,102 +58,762 @@ void PitchDetector::initMedian(float* values, int* ages, int size, float value)
     }
 }
 
-void PitchDetector::prepare(double sr, int /*samplesPerBlock*/, const Settings& settings)
+int PitchDetector::binStep(int lag) const
+{
+    const int octave = log2ceil(lag);
+    return octave <= maxLog2Bins ? 1 : 1 << (octave - maxLog2Bins);
+}
+
+void PitchDetector::prepare(double sr, int samplesPerBlock, const Settings& settings)
 {
     sampleRate = static_cast<float>(sr);
-    downSample = std::max(1, settings.downSample);
+    blockSize = std::max(1, samplesPerBlock);
+
+    // Reserve for the widest settings at this rate: no decimation and the lowest supported
+    // minFreq give the longest periods and window. applySettings() then only resizes within
+    // these capacities, so it never allocates.
+    const int maxPeriodCapacity = static_cast<int>(sampleRate / kMinSupportedFreq);
+    ringCapacity = std::max(2 * maxPeriodCapacity, 1);
+    const auto ringCapacitySize = static_cast<size_t>(ringCapacity);
+    ring.assign(ringCapacitySize * 2, 0.0f);
+    lagValues.reserve(ringCapacitySize + 1);
+    lagValid.reserve((ringCapacitySize + 64) / 64);
+    lagSchedule.reserve(static_cast<size_t>(maxPeriodCapacity) + 1);
+    lagRuns.reserve(static_cast<size_t>(maxPeriodCapacity) + 2);
+    runningLagSums.reserve(ringCapacitySize + 1);
+    lagScratch.reserve(ringCapacitySize + 1);
+    coarseWindow.reserve(ringCapacitySize / 2);
+    coarseLagValues.reserve(static_cast<size_t>(maxPeriodCapacity) / 2 + 1);
+    hopSnapshot.reserve(ringCapacitySize);
+    medianValues.reserve(static_cast<size_t>(kMaxMedianSize));
+    medianAges.reserve(static_cast<size_t>(kMaxMedianSize));
+    decimator.reserve(kMaxDownSample);
+    decimated.reserve(static_cast<size_t>(DecimatingFilter::kMaxChunk / 2 + 1));
+
+    // One transform per order, so switching FFT correlation on or changing the window size only
+    // picks a different one.
+    const int maxFftOrder = log2ceil(ringCapacity);
+    ffts.clear();
+    ffts.resize(static_cast<size_t>(maxFftOrder) + 1);
+    for (int order = 1; order <= maxFftOrder; ++order)
+        ffts[static_cast<size_t>(order)] = std::make_unique<juce::dsp::FFT>(order);
+    fftWindow.reserve(static_cast<size_t>(2) << maxFftOrder);
+    fftSegment.reserve(static_cast<size_t>(2) << maxFftOrder);
+    yin.reserve(ringCapacity);
+
+    // The vector kernels only reorder the additions, so they must stay close to the scalar
+    // reference. Checked here, as applySettings() runs on the audio thread; kernels that fail
+    // the check are not used, in release builds too.
+    vectorIsa = CorrelationKernels::detectIsa();
+    const bool vectorKernelsMatch = CorrelationKernels::measureMaxError(vectorIsa) < 1.0e-5f;
+    jassert(vectorKernelsMatch);
+    if (!vectorKernelsMatch)
+        vectorIsa = CorrelationKernels::Isa::scalar;
+
+    historyValid = false;
+    applySettings(settings);
+    freq = initFreq;
+    reset();
+}
+
+void PitchDetector::applySettings(const Settings& settings)
+{
+    const int previousDownSample = downSample;
+    const int previousDecimatorFactor = decimator.getFactor();
+    const int previousMedianSize = medianSize;
+
+    // The automatic factor keeps the analysis rate between four and eight times maxFreq, so the
+    // lag search costs the same at any host rate.
+    if (settings.autoDownSample)
+        downSample = std::clamp(static_cast<int>(sampleRate / (4.0f * std::max(1.0f, settings.maxFreq))), 1, kMaxDownSample);
+    else
+        downSample = std::clamp(settings.downSample, 1, kMaxDownSample);
     analysisRate = sampleRate / static_cast<float>(downSample);
 
-    minFreq = settings.minFreq;
-    maxFreq = settings.maxFreq;
-    freq = settings.initFreq;
+    minFreq = std::max(settings.minFreq, kMinSupportedFreq);
+    maxFreq = std::max(settings.maxFreq, minFreq);
+    initFreq = settings.initFreq;
     ampThreshold = settings.ampThreshold;
     peakThreshold = settings.peakThreshold;
     getClarity = settings.clarity;
+    useYin = settings.engine == Settings::Engine::yin;
+    useFft = settings.fftCorrelation && !useYin;
+    useIncremental = settings.incremental && !useFft && !useYin;
+    useTracking = settings.tracking && !useYin;
+    trackingSemitones = std::max(0.0f, settings.trackingSemitones);
+    trackingClarity = settings.trackingClarity;
+    coarseFactor = 1;
+    while (!useYin && coarseFactor * 2 <= std::min(settings.coarseFactor, kMaxCoarseFactor))
+        coarseFactor *= 2;
+    incrementalRefreshHops = std::max(1, settings.incrementalRefreshHops);
+
+    const auto isa = settings.scalarKernel ? CorrelationKernels::Isa::scalar : vectorIsa;
+    lagSums = CorrelationKernels::getLagSums(isa);
+
+    const int decimatorFactor = settings.antiAliasDownSample ? downSample : 1;
+    if (!historyValid || decimatorFactor != decimator.getFactor() || isa != kernelIsa)
+        decimator.prepare(decimatorFactor, isa);
+    kernelIsa = isa;
+    decimated.assign(decimator.isActive() ? static_cast<size_t>(DecimatingFilter::kMaxChunk / downSample + 1) : 0, 0.0f);
 
     const float execFreq = std::clamp(settings.execFreq, minFreq, maxFreq);
     maxLog2Bins = log2ceil(std::max(1, settings.maxBinsPerOctave));
 
     medianSize = std::clamp(settings.medianSize, 1, kMaxMedianSize);
-    medianValues.assign(static_cast<size_t>(medianSize), freq);
-    medianAges.assign(static_cast<size_t>(medianSize), 0);
-    initMedian(medianValues.data(), medianAges.data(), medianSize, freq);
+    medianValues.resize(static_cast<size_t>(medianSize), freq);
+    medianAges.resize(static_cast<size_t>(medianSize), 0);
 
-    minPeriod = static_cast<int>(analysisRate / std::max(1.0f, maxFreq));
-    maxPeriod = static_cast<int>(analysisRate / std::max(1.0f, minFreq));
+    minPeriod = static_cast<int>(analysisRate / maxFreq);
+    maxPeriod = static_cast<int>(analysisRate / minFreq);
 
     execPeriod = static_cast<int>(analysisRate / std::max(1.0f, execFreq));
     execPeriod = std::max(execPeriod, 1);
 
-    size = std::max(maxPeriod << 1, execPeriod);
-    buffer.assign(static_cast<size_t>(size), 0.0f);
+    size = std::max(useYin ? YinEngine::getWindowSize(maxPeriod) : maxPeriod << 1, execPeriod);
+    jassert(size <= ringCapacity);
 
-    index = 0;
-    downSampleCounter = 0;
-    hasFreq = 0.0f;
+    // Largest lag whose dot product stays inside the window.
+    maxLag = size - maxPeriod;
+    lagValues.assign(static_cast<size_t>(maxLag + 1), 0.0f);
+    lagValid.assign(static_cast<size_t>((maxLag + 64) / 64), 0);
+
+    // Every lag the peak search can visit; the bin step only depends on the lag itself.
+    lagSchedule.clear();
+    lagRuns.clear();
+    lagRuns.push_back({ 0, 1 });
+    for (int lag = 1; lag <= maxPeriod; lag += binStep(lag))
+    {
+        lagSchedule.push_back(lag);
+        auto& run = lagRuns.back();
+        if (run.first + run.count == lag)
+            run.count++;
+        else
+            lagRuns.push_back({ lag, 1 });
+    }
+
+    runningLagSums.assign(useIncremental ? static_cast<size_t>(maxLag + 1) : 0, 0.0);
+    lagScratch.assign(useIncremental ? static_cast<size_t>(maxLag + 1) : 0, 0.0f);
+    incrementalValid = false;
+    hopsSinceAnchor = 0;
+
+    // The coarse search needs a few lags per octave at the decimated rate to be meaningful.
+    if (maxPeriod / coarseFactor < 4)
+        coarseFactor = 1;
+    coarseWindow.assign(coarseFactor > 1 ? static_cast<size_t>(size / coarseFactor) : 0, 0.0f);
+    coarseLagValues.assign(coarseFactor > 1 ? static_cast<size_t>(maxPeriod / coarseFactor + 1) : 0, 0.0f);
+
+    // Only the full-range dot-product search is sliced: the FFT and incremental engines fill every
+    // lag at once, and the tracked and coarse searches are already cheap. Each slice needs a
+    // callback of its own before the next hop arrives.
+    const bool canSlice = !useFft && !useIncremental && !useYin && !useTracking && coarseFactor == 1;
+    const int callbacksPerHop = std::max(1, execPeriod * downSample / blockSize);
+    analysisSlices = canSlice ? std::clamp(settings.analysisSlices, 1, std::min(kMaxAnalysisSlices, callbacksPerHop)) : 1;
+
+    hopSnapshot.assign(analysisSlices > 1 ? static_cast<size_t>(size) : 0, 0.0f);
+    lagsPerSlice = 0;
+    if (analysisSlices > 1)
+    {
+        int scheduledLags = 0;
+        for (const auto& run : lagRuns)
+            scheduledLags += run.count;
+        lagsPerSlice = (scheduledLags + analysisSlices - 1) / analysisSlices;
+    }
+    // A hop still being sliced was planned for the old lag layout; the next hop replaces it.
+    pendingSlices = 0;
+    settleScan = {};
+
+    if (useFft)
+    {
+        // The circular correlation of the window with its first maxPeriod samples does not
+        // wrap for lags up to maxLag once the transform covers the whole window.
+        const int fftOrder = std::max(1, log2ceil(size));
+        const size_t fftSize = static_cast<size_t>(1) << fftOrder;
+        fft = ffts[static_cast<size_t>(fftOrder)].get();
+        fftWindow.assign(fftSize * 2, 0.0f);
+        fftSegment.assign(fftSize * 2, 0.0f);
+    }
+    else
+    {
+        fft = nullptr;
+        fftWindow.clear();
+        fftSegment.clear();
+    }
+
+    if (useYin)
+    {
+        const int yinOrder = std::max(1, log2ceil(YinEngine::getWindowSize(maxPeriod)));
+        yin.configure(minPeriod, maxPeriod, settings.yinThreshold, ffts[static_cast<size_t>(yinOrder)].get());
+    }
+
+    // The ring always holds the latest ringCapacity analysis samples, so a new window size or
+    // hop rate can keep using them. Only a different analysis rate or filter invalidates them.
+    if (historyValid && downSample == previousDownSample && decimator.getFactor() == previousDecimatorFactor)
+    {
+        // A window longer than the history so far waits until it is full, as after a reset.
+        samplesUntilHop = std::max(std::min(samplesUntilHop, execPeriod), size - historyLength);
+        if (trackedPeriod < minPeriod || trackedPeriod > maxPeriod)
+            trackedPeriod = 0;
+        if (medianSize != previousMedianSize)
+            initMedian(medianValues.data(), medianAges.data(), medianSize, freq);
+    }
+    else
+    {
+        std::fill(ring.begin(), ring.end(), 0.0f);
+        writePos = 0;
+        historyLength = 0;
+        samplesUntilHop = size;
+        downSampleCounter = 0;
+        decimator.reset();
+        trackedPeriod = 0;
+        initMedian(medianValues.data(), medianAges.data(), medianSize, freq);
+    }
+    historyValid = true;
 }
 
 void PitchDetector::reset()
 {
-    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    std::fill(ring.begin(), ring.end(), 0.0f);
     initMedian(medianValues.data(), medianAges.data(), medianSize, freq);
-    index = 0;
+    writePos = 0;
+    historyLength = 0;
+    samplesUntilHop = size;
     downSampleCounter = 0;
+    decimator.reset();
     hasFreq = 0.0f;
+    incrementalValid = false;
+    trackedPeriod = 0;
+    pendingSlices = 0;
+    deferredHopOffset = -1;
+    stats = {};
+}
+
+bool PitchDetector::State::operator==(const State& other) const
+{
+    return window == other.window
+        && historyLength == other.historyLength
+        && samplesUntilHop == other.samplesUntilHop
+        && downSampleCounter == other.downSampleCounter
+        && decimatorHistory == other.decimatorHistory
+        && decimatorPhase == other.decimatorPhase
+        && medianValues == other.medianValues
+        && medianAges == other.medianAges
+        && freq == other.freq
+        && amp == other.amp
+        && hasFreq == other.hasFreq
+        && trackedPeriod == other.trackedPeriod
+        && trackedClarity == other.trackedClarity
+        && runningLagSums == other.runningLagSums
+        && incrementalValid == other.incrementalValid
+        && hopsSinceAnchor == other.hopsSinceAnchor
+        && pendingSlices == other.pendingSlices
+        && pendingRun == other.pendingRun
+        && pendingRunOffset == other.pendingRunOffset
+        && pendingHopOffset == other.pendingHopOffset
+        && pendingWindow == other.pendingWindow
+        && pendingLagValues == other.pendingLagValues
+        && pendingLagValid == other.pendingLagValid;
+}
+
+void PitchDetector::saveState(State& state) const
+{
+    jassert(!ring.empty());
+
+    // The ring starts out zeroed, so this is the window the next hop sees even before it is full.
+    const float* latest = ring.data() + writePos + ringCapacity - size;
+    state.window.assign(latest, latest + size);
+    state.historyLength = std::min(historyLength, size);
+    state.samplesUntilHop = samplesUntilHop;
+    state.downSampleCounter = downSampleCounter;
+    decimator.saveState(state.decimatorHistory, state.decimatorPhase);
+    state.medianValues = medianValues;
+    state.medianAges = medianAges;
+    state.freq = freq;
+    state.amp = amp;
+    state.hasFreq = hasFreq;
+    state.trackedPeriod = trackedPeriod;
+    state.trackedClarity = trackedClarity;
+
+    state.runningLagSums.clear();
+    if (useIncremental)
+        for (const auto& run : lagRuns)
+            state.runningLagSums.insert(state.runningLagSums.end(),
+                                        runningLagSums.begin() + run.first,
+                                        runningLagSums.begin() + run.first + run.count);
+    state.incrementalValid = incrementalValid;
+    state.hopsSinceAnchor = hopsSinceAnchor;
+
+    state.pendingSlices = pendingSlices;
+    state.pendingRun = pendingRun;
+    state.pendingRunOffset = pendingRunOffset;
+    state.pendingHopOffset = pendingHopOffset;
+    state.pendingWindow.clear();
+    state.pendingLagValues.clear();
+    state.pendingLagValid.clear();
+    if (pendingSlices > 0)
+    {
+        state.pendingWindow = hopSnapshot;
+        state.pendingLagValid = lagValid;
+        // Lags not yet filled for this hop hold stale values from earlier hops, so leave them out.
+        state.pendingLagValues.assign(lagValues.size(), 0.0f);
+        for (int lag = 0; lag <= maxLag; ++lag)
+            if (isLagValid(lag))
+                state.pendingLagValues[static_cast<size_t>(lag)] = lagValues[static_cast<size_t>(lag)];
+    }
+}
+
+void PitchDetector::restoreState(const State& state)
+{
+    jassert(static_cast<int>(state.window.size()) == size);
+    jassert(state.medianValues.size() == medianValues.size());
+
+    std::fill(ring.begin(), ring.end(), 0.0f);
+    writePos = 0;
+    writeToRing(state.window.data(), size, 1);
+    historyLength = state.historyLength;
+    samplesUntilHop = state.samplesUntilHop;
+    downSampleCounter = state.downSampleCounter;
+    decimator.restoreState(state.decimatorHistory, state.decimatorPhase);
+    medianValues = state.medianValues;
+    medianAges = state.medianAges;
+    freq = state.freq;
+    amp = state.amp;
+    hasFreq = state.hasFreq;
+    trackedPeriod = state.trackedPeriod;
+    trackedClarity = state.trackedClarity;
+
+    if (useIncremental)
+    {
+        size_t index = 0;
+        for (const auto& run : lagRuns)
+            for (int lag = run.first; lag < run.first + run.count; ++lag)
+                runningLagSums[static_cast<size_t>(lag)] = state.runningLagSums[index++];
+    }
+    incrementalValid = state.incrementalValid;
+    hopsSinceAnchor = state.hopsSinceAnchor;
+
+    pendingSlices = state.pendingSlices;
+    pendingRun = state.pendingRun;
+    pendingRunOffset = state.pendingRunOffset;
+    pendingHopOffset = state.pendingHopOffset;
+    if (pendingSlices > 0)
+    {
+        hopSnapshot = state.pendingWindow;
+        lagValues = state.pendingLagValues;
+        lagValid = state.pendingLagValid;
+        window = hopSnapshot.data();
+        settleScan = {};
+    }
+}
+
+int PitchDetector::getHopCycleSamples() const
+{
+    return downSample * execPeriod * (useIncremental ? incrementalRefreshHops + 1 : 1);
+}
+
+int PitchDetector::getWarmUpSamples() const
+{
+    const int filterHistory = decimator.isActive() ? 2 * decimator.getLatency() : 0;
+    return downSample * (size + (medianSize - 1) * execPeriod) + filterHistory;
 }
 
 void PitchDetector::processBlock(const float* input, int numSamples, std::vector<Detection>& detections)
 {
     detections.clear();
 
-    if (buffer.empty() || numSamples <= 0)
+    if (ring.empty() || numSamples <= 0)
         return;
 
-    for (int sample = 0; sample < numSamples; ++sample)
+    // Work left over from a hop in an earlier callback goes first, one slice per callback.
+    if (pendingSlices > 0)
+        runPendingSlice(std::min(pendingHopOffset, numSamples - 1), detections);
+
+    if (decimator.isActive())
     {
-        if (downSampleCounter == 0)
+        // Filter in chunks and feed the kept outputs to the ring in bulk.
+        for (int start = 0; start < numSamples; start += DecimatingFilter::kMaxChunk)
         {
-            buffer[static_cast<size_t>(index++)] = input[sample];
+            const int chunk = std::min(DecimatingFilter::kMaxChunk, numSamples - start);
+            const int firstKept = start + decimator.getNextKeptOffset();
+            const int kept = decimator.process(input + start, chunk, decimated.data());
+            feedAnalysis(decimated.data(), kept, 1, firstKept, detections);
+        }
+        return;
+    }
 
-            if (index >= size)
-            {
-                float outFreq = freq;
-                float outAmp = amp; 
-                float outClarity = hasFreq;
-                const bool gotPitch = analyse(outFreq, outAmp, outClarity);
-                freq = outFreq;
-                amp = outAmp; 
-                hasFreq = outClarity;
-
-                if (gotPitch && outClarity > 0.0f)
-                {
-                    Detection detection;
-                    detection.freq = outFreq;
-                    detection.amp = outAmp;
-                    
-                    detection.clarity = outClarity;
-                    detection.sampleOffset = sample;
-                    detections.push_back(detection);
-                }
+    // Input index of the first sample the decimator keeps in this block; after that every
+    // downSample-th sample is kept, so whole runs can be written without a per-sample branch.
+    const int sample = (downSampleCounter == 0) ? 0 : downSample - downSampleCounter;
+    downSampleCounter = (downSampleCounter + numSamples) % downSample;
+
+    if (sample < numSamples)
+        feedAnalysis(input + sample, (numSamples - 1 - sample) / downSample + 1, downSample, sample, detections);
+}
+
+void PitchDetector::feedAnalysis(const float* source, int count, int stride, int inputIndex, std::vector<Detection>& detections)
+{
+    // inputIndex is the block offset of source[0]; each analysis sample advances it by downSample.
+    while (count > 0)
+    {
+        const int run = std::min(count, samplesUntilHop);
+        writeToRing(source, run, stride);
+        source += run * stride;
+        count -= run;
+        inputIndex += run * downSample;
+        samplesUntilHop -= run;
 
-                const int interval = size - execPeriod;
-                for (int i = 0; i < interval; ++i)
-                    buffer[static_cast<size_t>(i)] = buffer[static_cast<size_t>(i + execPeriod)];
+        if (samplesUntilHop == 0)
+        {
+            runHop(inputIndex - downSample, detections);
+            samplesUntilHop = execPeriod;
+        }
+    }
+}
 
-                index = interval;
+void PitchDetector::writeToRing(const float* source, int count, int stride)
+{
+    float* lower = ring.data();
+    float* upper = lower + ringCapacity;
+    historyLength = std::min(historyLength + count, ringCapacity);
+
+    while (count > 0)
+    {
+        const int run = std::min(count, ringCapacity - writePos);
+        if (stride == 1)
+        {
+            std::copy(source, source + run, lower + writePos);
+            std::copy(source, source + run, upper + writePos);
+        }
+        else
+        {
+            for (int k = 0; k < run; ++k)
+            {
+                const float value = source[k * stride];
+                lower[writePos + k] = value;
+                upper[writePos + k] = value;
             }
         }
 
-        downSampleCounter++;
-        if (downSampleCounter >= downSample)
-            downSampleCounter = 0;
+        source += run * stride;
+        count -= run;
+        writePos += run;
+        if (writePos == ringCapacity)
+            writePos = 0;
+    }
+}
+
+int PitchDetector::getInputSamplesUntilHop() const
+{
+    // The hop runs on the samplesUntilHop-th kept sample, and after the first one every
+    // downSample-th input sample is kept.
+    const int firstKept = decimator.isActive() ? decimator.getNextKeptOffset()
+                                               : (downSampleCounter == 0 ? 0 : downSample - downSampleCounter);
+    return firstKept + (samplesUntilHop - 1) * downSample + 1;
+}
+
+void PitchDetector::runHop(int sampleOffset, std::vector<Detection>& detections)
+{
+    MYK_TRACE_SCOPE("analysis hop");
+    if (analysisSlices > 1)
+    {
+        // The ring keeps moving while the slices run, so they work on a copy of this hop's window.
+        // A hop that arrives before the previous one is done completes it here first.
+        while (pendingSlices > 0)
+            runPendingSlice(std::min(pendingHopOffset, sampleOffset), detections);
+
+        const float* latest = ring.data() + writePos + ringCapacity - size;
+        std::copy(latest, latest + size, hopSnapshot.begin());
+        window = hopSnapshot.data();
+        clearLagCache();
+        pendingSlices = analysisSlices;
+        pendingRun = 0;
+        pendingRunOffset = 0;
+        pendingHopOffset = sampleOffset;
+        return;
+    }
+
+    // Every sample is stored twice, ringCapacity apart, so the last size samples are always contiguous.
+    window = ring.data() + writePos + ringCapacity - size;
+    clearLagCache();
+    if (deferHops)
+    {
+        jassert(!useIncremental && !useFft && !useYin && deferredHopOffset < 0);
+        deferredHopOffset = sampleOffset;
+        return;
+    }
+    if (useIncremental)
+        advanceIncrementalLags();
+    finishHop(sampleOffset, detections);
+    if (useIncremental)
+        retireIncrementalLags();
+}
+
+void PitchDetector::runPendingSlice(int sampleOffset, std::vector<Detection>& detections)
+{
+    MYK_TRACE_SCOPE("analysis slice");
+    // Fill the next lagsPerSlice scheduled lags, in the same runs the search would use, until the
+    // search can settle on the lags so far; the slices after that have nothing to compute.
+    int budget = lagsPerSlice;
+    const int numRuns = static_cast<int>(lagRuns.size());
+    while (budget > 0 && pendingRun < numRuns && !isSearchSettled())
+    {
+        const auto& run = lagRuns[static_cast<size_t>(pendingRun)];
+        const int count = std::min({ budget, run.count - pendingRunOffset, kLagBlock });
+        lagSum(run.first + pendingRunOffset, count);
+        budget -= count;
+        pendingRunOffset += count;
+        if (pendingRunOffset == run.count)
+        {
+            pendingRun++;
+            pendingRunOffset = 0;
+        }
+    }
+
+    // The last slice also runs the search, which now only computes the refinement neighbours.
+    if (--pendingSlices == 0)
+        finishHop(sampleOffset, detections);
+}
+
+void PitchDetector::finishHop(int sampleOffset, std::vector<Detection>& detections)
+{
+    float outFreq = freq;
+    float outAmp = amp;
+    float outClarity = hasFreq;
+    const bool gotPitch = analyse(outFreq, outAmp, outClarity);
+
+    stats.hops++;
+    stats.lagCacheHits += stats.hopLagCacheHits;
+    stats.lagCacheMisses += stats.hopLagCacheMisses;
+    freq = outFreq;
+    amp = outAmp;
+    hasFreq = outClarity;
+
+    if (gotPitch && outClarity > 0.0f)
+    {
+        Detection detection;
+        detection.freq = outFreq;
+        detection.amp = outAmp;
+        detection.clarity = outClarity;
+        detection.sampleOffset = sampleOffset;
+        // A caller that reserved the vector gets at most that many detections, never a reallocation.
+        if (detections.capacity() != 0 && detections.size() == detections.capacity())
+            stats.droppedDetections++;
+        else
+            detections.push_back(detection);
+    }
+}
+
+void PitchDetector::finishDeferredHop(int sampleOffset, std::vector<Detection>& detections)
+{
+    jassert(hasDeferredHop());
+    deferredHopOffset = -1;
+    finishHop(sampleOffset, detections);
+}
+
+void PitchDetector::advanceIncrementalLags()
+{
+    // With no overlap between the old and new lag segments there is nothing to reuse.
+    const bool canSlide = execPeriod < maxPeriod;
+
+    if (!incrementalValid || !canSlide || hopsSinceAnchor >= incrementalRefreshHops)
+    {
+        // Re-anchor with a full recompute so rounding in the running sums cannot drift.
+        for (const auto& run : lagRuns)
+        {
+            lagSums(window, maxPeriod, run.first, run.count, lagScratch.data() + run.first);
+            for (int lag = run.first; lag < run.first + run.count; ++lag)
+                runningLagSums[static_cast<size_t>(lag)] = lagScratch[static_cast<size_t>(lag)];
+        }
+        incrementalValid = canSlide;
+        hopsSinceAnchor = 0;
+    }
+    else
+    {
+        // The window moved by execPeriod since the last hop and the departed products were already
+        // retired, so only the products of the newest execPeriod segment positions are missing.
+        const float* segment = window + (maxPeriod - execPeriod);
+        for (const auto& run : lagRuns)
+        {
+            lagSums(segment, execPeriod, run.first, run.count, lagScratch.data() + run.first);
+            for (int lag = run.first; lag < run.first + run.count; ++lag)
+                runningLagSums[static_cast<size_t>(lag)] += lagScratch[static_cast<size_t>(lag)];
+        }
+        hopsSinceAnchor++;
+    }
+
+    for (const auto& run : lagRuns)
+    {
+        for (int lag = run.first; lag < run.first + run.count; ++lag)
+        {
+            lagValues[static_cast<size_t>(lag)] = static_cast<float>(runningLagSums[static_cast<size_t>(lag)]);
+            markLagValid(lag);
+        }
+    }
+}
+
+void PitchDetector::retireIncrementalLags()
+{
+    if (!incrementalValid)
+        return;
+
+    // Remove the products of the first execPeriod segment positions, which leave on the shift.
+    for (const auto& run : lagRuns)
+    {
+        lagSums(window, execPeriod, run.first, run.count, lagScratch.data() + run.first);
+        for (int lag = run.first; lag < run.first + run.count; ++lag)
+            runningLagSums[static_cast<size_t>(lag)] -= lagScratch[static_cast<size_t>(lag)];
+    }
+}
+
+void PitchDetector::clearLagCache()
+{
+    std::fill(lagValid.begin(), lagValid.end(), 0);
+    settleScan = {};
+    stats.hopLagCacheHits = 0;
+    stats.hopLagCacheMisses = 0;
+}
+
+bool PitchDetector::isLagValid(int lag) const
+{
+    return (lagValid[static_cast<size_t>(lag >> 6)] >> (lag & 63) & 1) != 0;
+}
+
+void PitchDetector::markLagValid(int lag)
+{
+    lagValid[static_cast<size_t>(lag >> 6)] |= juce::uint64 { 1 } << (lag & 63);
+}
+
+void PitchDetector::setLagValue(int lag, float value)
+{
+    jassert(lag >= 0 && lag <= maxLag);
+    lagValues[static_cast<size_t>(lag)] = value;
+    markLagValid(lag);
+    stats.hopLagCacheMisses++;
+}
+
+void PitchDetector::getSearchLags(std::vector<int>& lags) const
+{
+    for (const auto& run : lagRuns)
+        for (int lag = run.first; lag < run.first + run.count; ++lag)
+            lags.push_back(lag);
+}
+
+float PitchDetector::lagSum(int lag, int span)
+{
+    if (lag < 0 || lag > maxLag)
+        return 0.0f;
+
+    if (isLagValid(lag))
+    {
+        stats.hopLagCacheHits++;
+        return lagValues[static_cast<size_t>(lag)];
+    }
+
+    // Compute a run of adjacent lags in one kernel pass when the caller is about to walk them,
+    // stopping short of any lag this hop already has.
+    const int lastLag = std::min(lag + std::max(span, 1), maxLag + 1);
+    int numLags = 1;
+    while (lag + numLags < lastLag && !isLagValid(lag + numLags))
+        numLags++;
+
+    lagSums(window, maxPeriod, lag, numLags, lagValues.data() + lag);
+    for (int k = lag; k < lag + numLags; ++k)
+        markLagValid(k);
+
+    stats.hopLagCacheMisses += numLags;
+    return lagValues[static_cast<size_t>(lag)];
+}
+
+void PitchDetector::computeFftLags()
+{
+    const int fftSize = fft->getSize();
+
+    std::copy(window, window + size, fftWindow.begin());
+    std::fill(fftWindow.begin() + size, fftWindow.end(), 0.0f);
+    std::copy(window, window + maxPeriod, fftSegment.begin());
+    std::fill(fftSegment.begin() + maxPeriod, fftSegment.end(), 0.0f);
+
+    fft->performRealOnlyForwardTransform(fftWindow.data(), true);
+    fft->performRealOnlyForwardTransform(fftSegment.data(), true);
+
+    // Cross-spectrum window * conj(segment); its inverse is the lag function (Wiener-Khinchin).
+    for (int k = 0; k <= fftSize / 2; ++k)
+    {
+        const size_t re = static_cast<size_t>(2 * k);
+        const size_t im = re + 1;
+        const float xr = fftWindow[re];
+        const float xi = fftWindow[im];
+        const float yr = fftSegment[re];
+        const float yi = fftSegment[im];
+        fftWindow[re] = xr * yr + xi * yi;
+        fftWindow[im] = xi * yr - xr * yi;
+    }
+
+    fft->performRealOnlyInverseTransform(fftWindow.data());
+    std::copy(fftWindow.begin(), fftWindow.begin() + maxLag + 1, lagValues.begin());
+    std::fill(lagValid.begin(), lagValid.end(), ~juce::uint64 { 0 });
+}
+
+bool PitchDetector::isAboveAmplitudeThreshold(const float* samples, int count) const
+{
+    for (int j = 0; j < count; ++j)
+        if (std::fabs(samples[j]) >= ampThreshold)
+            return true;
+    return false;
+}
+
+bool PitchDetector::isSearchSettled() const
+{
+    auto& scan = settleScan;
+    if (scan.settled)
+        return true;
+
+    if (!scan.started)
+    {
+        if (!isAboveAmplitudeThreshold(window, maxPeriod))
+            return scan.settled = true;
+        if (!isLagValid(0))
+            return false;
+
+        const float zeroLagVal = lagValues[0];
+        if (zeroLagVal <= 0.0f)
+            return scan.settled = true;
+        scan.threshold = zeroLagVal * peakThreshold;
+        scan.started = true;
+    }
+
+    // searchFullRange() on the cached lags only, stopping at the first lag it would compute.
+    if (!scan.pastThreshold)
+    {
+        for (; scan.lag <= maxPeriod; scan.lag += scan.binStep)
+        {
+            if (!isLagValid(scan.lag))
+                return false;
+            if (lagValues[static_cast<size_t>(scan.lag)] < scan.threshold)
+                break;
+            scan.binStep = binStep(scan.lag);
+        }
+        scan.pastThreshold = true;
+    }
+
+    for (; scan.lag <= maxPeriod; scan.lag += scan.binStep)
+    {
+        if (scan.lag >= minPeriod)
+        {
+            if (!isLagValid(scan.lag))
+                return false;
+            if (lagValues[static_cast<size_t>(scan.lag)] > scan.threshold)
+                scan.foundPeak = true;
+            else if (scan.foundPeak)
+                return scan.settled = true;
+        }
+        scan.binStep = binStep(scan.lag);
     }
+    return scan.settled = true;
 }
 
 bool PitchDetector::analyse(float& outFreq, float& outAmp, float& outClarity)
 {
-    bool foundPeak = false;
-    bool ampOk = false;
+    juce::uint64 stageStart = profiler != nullptr ? StageProfiler::now() : 0;
 
     if (maxPeriod <= 0 || minPeriod <= 0)
     {
@@ -160,63 +821,179 @@ bool PitchDetector::analyse(float& outFreq, float& outAmp, float& outClarity)
         return false;
     }
 
-    for (int j = 0; j < maxPeriod; ++j)
+    // YIN reads the newest samples, when a slow hop rate makes the window longer than it needs.
+    const int yinWindowSize = YinEngine::getWindowSize(maxPeriod);
+    const float* yinWindow = window + size - yinWindowSize;
+    // The gate spans differ on purpose: each checks the samples its search's energy comes from.
+    // Every autocorrelation lag, zero lag included, sums window[j] * window[j + lag] over the
+    // first maxPeriod samples, so a quiet stretch there leaves nothing to find whatever follows.
+    // YIN's difference function sums (x[j] - x[j + tau])^2 instead, which a quiet start does not
+    // silence, so a note beginning anywhere in its window counts.
+    const bool aboveThreshold = useYin ? isAboveAmplitudeThreshold(yinWindow, yinWindowSize)
+                                       : isAboveAmplitudeThreshold(window, maxPeriod);
+    if (!aboveThreshold)
     {
-        if (std::fabs(buffer[static_cast<size_t>(j)]) >= ampThreshold)
-        {
-            ampOk = true;
-            break;
-        }
+        outClarity = 0.0f;
+        return false;
     }
 
-    if (!ampOk)
+    float period = 0.0f;
+    float clarity = 0.0f;
+    const bool found = useYin ? findYinPeriod(yinWindow, period, clarity, stageStart)
+                              : findAutocorrelationPeriod(period, clarity, stageStart);
+
+    const float tempFreq = found ? analysisRate / period : 0.0f;
+    if (!found || tempFreq < minFreq || tempFreq > maxFreq)
     {
         outClarity = 0.0f;
         return false;
     }
 
-    float zeroLagVal = 0.0f;
-    for (int j = 0; j < maxPeriod; ++j)
-        zeroLagVal += buffer[static_cast<size_t>(j)] * buffer[static_cast<size_t>(j)];
+    outFreq = tempFreq;
+
+    if (medianSize > 1)
+    {
+        outFreq = insertMedian(medianValues.data(), medianAges.data(), medianSize, outFreq);
+        if (profiler != nullptr)
+            profiler->lap(StageProfiler::median, stageStart);
+    }
+
+    outClarity = getClarity ? clarity : 1.0f;
+    outAmp = 1.0f;// for now
+    return true;
+}
+
+bool PitchDetector::findAutocorrelationPeriod(float& outPeriod, float& outClarity, juce::uint64& stageStart)
+{
+    if (useFft)
+        computeFftLags();
+
+    const float zeroLagVal = lagSum(0, 1);
 
     if (zeroLagVal <= 0.0f)
+        return false;
+
+    const float threshold = zeroLagVal * peakThreshold;
+
+    const int priorPeriod = trackedPeriod;
+    const float priorClarity = trackedClarity;
+    trackedPeriod = 0;
+
+    int period = 0;
+    float maxSum = threshold;
+    bool foundPeak = false;
+
+    if (useTracking && priorPeriod > 0 && priorClarity >= trackingClarity)
+        foundPeak = searchAroundPrior(priorPeriod, threshold, period, maxSum);
+
+    if (foundPeak)
     {
-        outClarity = 0.0f;
+        stats.trackedSearches++;
+    }
+    else if (coarseFactor > 1)
+    {
+        foundPeak = searchCoarseToFine(threshold, period, maxSum);
+        stats.coarseSearches++;
+    }
+    else
+    {
+        foundPeak = searchFullRange(threshold, period, maxSum);
+        stats.fullSearches++;
+    }
+
+    if (profiler != nullptr)
+        stageStart = profiler->lap(StageProfiler::search, stageStart);
+
+    if (!foundPeak)
         return false;
+
+    float prevAmpSum = 0.0f;
+    float nextAmpSum = 0.0f;
+
+    if (period > 0)
+        prevAmpSum = lagSum(period - 1, 1);
+
+    if (period < maxPeriod)
+        nextAmpSum = lagSum(period + 1, 1);
+
+    
+    while (prevAmpSum > maxSum && period > 0)
+    {
+        nextAmpSum = maxSum;
+        maxSum = prevAmpSum;
+        period--;
+        prevAmpSum = lagSum(period - 1, 1);
     }
 
-    const float threshold = zeroLagVal * peakThreshold;
+    
+    while (nextAmpSum > maxSum && period < maxPeriod)
+    {
+        prevAmpSum = maxSum;
+        maxSum = nextAmpSum;
+        period++;
+        nextAmpSum = lagSum(period + 1, 1);
+    }
 
+    const float beta = 0.5f * (nextAmpSum - prevAmpSum);
+    const float gamma = 2.0f * maxSum - nextAmpSum - prevAmpSum;
+    float fPeriod = static_cast<float>(period);
+    if (std::fabs(gamma) > 1.0e-6f)
+        fPeriod += (beta / gamma);
+
+    if (profiler != nullptr)
+        stageStart = profiler->lap(StageProfiler::refine, stageStart);
+
+    // Out of range periods are rejected by the caller, and leave nothing to track.
+    const float tempFreq = analysisRate / fPeriod;
+    if (tempFreq >= minFreq && tempFreq <= maxFreq)
+    {
+        trackedPeriod = period;
+        trackedClarity = maxSum / zeroLagVal;
+    }
+
+    outPeriod = fPeriod;
+    outClarity = maxSum / zeroLagVal;
+    return true;
+}
+
+bool PitchDetector::findYinPeriod(const float* yinWindow, float& outPeriod, float& outClarity, juce::uint64& stageStart)
+{
+    float aperiodicity = 1.0f;
+    const bool found = yin.findPeriod(yinWindow, outPeriod, aperiodicity);
+    stats.fullSearches++;
+    trackedPeriod = 0;
+    if (profiler != nullptr)
+        stageStart = profiler->lap(StageProfiler::search, stageStart);
+
+    outClarity = 1.0f - aperiodicity;
+    return found;
+}
+
+bool PitchDetector::searchFullRange(float threshold, int& period, float& maxSum)
+{
+    bool foundPeak = false;
     int binstep = 1;
     int i = 0;
 
     for (i = 1; i <= maxPeriod; i += binstep)
     {
-        float ampSum = 0.0f;
-        for (int j = 0; j < maxPeriod; ++j)
-            ampSum += buffer[static_cast<size_t>(i + j)] * buffer[static_cast<size_t>(j)];
+        const float ampSum = lagSum(i, binstep == 1 ? kLagBlock : 1);
 
         if (ampSum < threshold)
             break;
 
-        const int octave = log2ceil(i);
-        if (octave <= maxLog2Bins)
-            binstep = 1;
-        else
-            binstep = 1 << (octave - maxLog2Bins);
+        binstep = binStep(i);
     }
 
     const int startPeriod = i;
-    int period = startPeriod;
-    float maxSum = threshold;
+    period = startPeriod;
+    maxSum = threshold;
 
     for (i = startPeriod; i <= maxPeriod; i += binstep)
     {
         if (i >= minPeriod)
         {
-            float ampSum = 0.0f;
-            for (int j = 0; j < maxPeriod; ++j)
-                ampSum += buffer[static_cast<size_t>(i + j)] * buffer[static_cast<size_t>(j)];
+            const float ampSum = lagSum(i, binstep == 1 ? kLagBlock : 1);
 
             if (ampSum > threshold)
             {
@@ -233,94 +1010,157 @@ bool PitchDetector::analyse(float& outFreq, float& outAmp, float& outClarity)
             }
         }
 
-        const int octave = log2ceil(i);
-        if (octave <= maxLog2Bins)
-            binstep = 1;
-        else
-            binstep = 1 << (octave - maxLog2Bins);
+        binstep = binStep(i);
     }
 
-    if (!foundPeak)
-    {
-        outClarity = 0.0f;
-        return false;
-    }
+    return foundPeak;
+}
 
-    float prevAmpSum = 0.0f;
-    float nextAmpSum = 0.0f;
+bool PitchDetector::searchAroundPrior(int priorPeriod, float threshold, int& period, float& maxSum)
+{
+    const float ratio = std::exp2(trackingSemitones / 12.0f);
+    const int low = std::max(minPeriod, static_cast<int>(std::floor(static_cast<float>(priorPeriod) / ratio)));
+    const int high = std::min(maxPeriod, static_cast<int>(std::ceil(static_cast<float>(priorPeriod) * ratio)));
 
-    if (period > 0)
+    // Walk the same lag grid as the full search so both paths consider the same candidates.
+    auto lag = std::lower_bound(lagSchedule.begin(), lagSchedule.end(), low);
+    int firstLag = -1;
+    int lastLag = -1;
+    int bestLag = -1;
+    float bestSum = threshold;
+
+    for (; lag != lagSchedule.end() && *lag <= high; ++lag)
     {
-        const int idx = period - 1;
-        for (int j = 0; j < maxPeriod; ++j)
-            prevAmpSum += buffer[static_cast<size_t>(idx + j)] * buffer[static_cast<size_t>(j)];
+        const float ampSum = lagSum(*lag, binStep(*lag) == 1 ? kLagBlock : 1);
+        if (firstLag < 0)
+            firstLag = *lag;
+        lastLag = *lag;
+
+        if (ampSum > bestSum)
+        {
+            bestSum = ampSum;
+            bestLag = *lag;
+        }
     }
 
-    if (period < maxPeriod)
+    // A peak on the window edge may belong to a note outside the window.
+    if (bestLag < 0 || bestLag == firstLag || bestLag == lastLag)
+        return false;
+
+    // If a half or a third of the period is also above threshold the note has jumped up by an
+    // octave or a twelfth, and the full search would have stopped at that shorter period first.
+    for (int divisor = 2; divisor <= 3; ++divisor)
     {
-        const int idx = period + 1;
-        for (int j = 0; j < maxPeriod; ++j)
-            nextAmpSum += buffer[static_cast<size_t>(idx + j)] * buffer[static_cast<size_t>(j)];
+        const int subPeriod = bestLag / divisor;
+        if (subPeriod >= minPeriod
+            && (lagSum(subPeriod, 2) > threshold || lagSum(subPeriod + 1, 1) > threshold))
+            return false;
     }
 
-    
-    while (prevAmpSum > maxSum && period > 0)
+    period = bestLag;
+    maxSum = bestSum;
+    return true;
+}
+
+bool PitchDetector::searchCoarseToFine(float threshold, int& period, float& maxSum)
+{
+    // Box-filter and decimate the window; the box response keeps the fundamental of anything
+    // up to maxFreq while thinning the lag grid by coarseFactor.
+    const int coarseSize = size / coarseFactor;
+    const float boxScale = 1.0f / static_cast<float>(coarseFactor);
+    for (int k = 0; k < coarseSize; ++k)
     {
-        nextAmpSum = maxSum;
-        maxSum = prevAmpSum;
-        period--;
-        const int idx = period - 1;
-        prevAmpSum = 0.0f;
-        for (int j = 0; j < maxPeriod; ++j)
-            prevAmpSum += buffer[static_cast<size_t>(idx + j)] * buffer[static_cast<size_t>(j)];
+        const float* source = window + k * coarseFactor;
+        float sum = 0.0f;
+        for (int t = 0; t < coarseFactor; ++t)
+            sum += source[t];
+        coarseWindow[static_cast<size_t>(k)] = sum * boxScale;
     }
 
-    
-    while (nextAmpSum > maxSum && period < maxPeriod)
+    const int coarseLength = maxPeriod / coarseFactor;
+    const int coarseMaxLag = coarseLength;
+    const int coarseMinPeriod = std::max(1, minPeriod / coarseFactor);
+    int computedLags = 0;
+
+    auto coarseLag = [&](int lag)
     {
-        prevAmpSum = maxSum;
-        maxSum = nextAmpSum;
-        period++;
-        const int idx = period + 1;
-        nextAmpSum = 0.0f;
-        for (int j = 0; j < maxPeriod; ++j)
-            nextAmpSum += buffer[static_cast<size_t>(idx + j)] * buffer[static_cast<size_t>(j)];
-    }
+        if (lag >= computedLags)
+        {
+            const int numLags = std::min(kCoarseLagBlock, coarseMaxLag + 1 - computedLags);
+            lagSums(coarseWindow.data(), coarseLength, computedLags, numLags, coarseLagValues.data() + computedLags);
+            computedLags += numLags;
+        }
+        return coarseLagValues[static_cast<size_t>(lag)];
+    };
 
-    const float beta = 0.5f * (nextAmpSum - prevAmpSum);
-    const float gamma = 2.0f * maxSum - nextAmpSum - prevAmpSum;
-    float fPeriod = static_cast<float>(period);
-    if (std::fabs(gamma) > 1.0e-6f)
-        fPeriod += (beta / gamma);
+    const float coarseThreshold = coarseLag(0) * peakThreshold;
+    if (coarseThreshold <= 0.0f)
+        return false;
 
-    const float tempFreq = analysisRate / fPeriod;
+    // Same shape as the full search: skip the zero-lag lobe, then take the first region above
+    // threshold and keep its strongest local maxima as candidates.
+    int lag = 1;
+    while (lag <= coarseMaxLag && coarseLag(lag) >= coarseThreshold)
+        lag++;
+
+    std::array<int, kMaxCoarseCandidates> candidates {};
+    std::array<float, kMaxCoarseCandidates> candidateSums {};
+    int numCandidates = 0;
+    bool inRegion = false;
 
-    if (tempFreq < minFreq || tempFreq > maxFreq)
+    for (lag = std::max(lag, coarseMinPeriod); lag <= coarseMaxLag; ++lag)
     {
-        outClarity = 0.0f;
-        return false;
-    }
+        const float value = coarseLag(lag);
+        if (value <= coarseThreshold)
+        {
+            if (inRegion)
+                break;
+            continue;
+        }
 
-    outFreq = tempFreq;
+        inRegion = true;
+        const float before = coarseLag(lag - 1);
+        const float after = lag < coarseMaxLag ? coarseLag(lag + 1) : value;
+        if (value < before || value < after)
+            continue;
 
-    if (medianSize > 1)
-        outFreq = insertMedian(medianValues.data(), medianAges.data(), medianSize, outFreq);
+        if (numCandidates < kMaxCoarseCandidates)
+        {
+            candidates[static_cast<size_t>(numCandidates)] = lag;
+            candidateSums[static_cast<size_t>(numCandidates)] = value;
+            numCandidates++;
+        }
+        else
+        {
+            const auto weakest = std::min_element(candidateSums.begin(), candidateSums.end());
+            if (value > *weakest)
+            {
+                candidates[static_cast<size_t>(weakest - candidateSums.begin())] = lag;
+                *weakest = value;
+            }
+        }
+    }
 
-    if (getClarity)
-        outClarity = maxSum / zeroLagVal;
-    else
-        outClarity = 1.0f;
-
-
-    // Map raw autocorrelation amplitude to a log-like curve:
-    // fast rise for low input, then compression toward 1.0 at the top.
-    const float rawAmp = (period > 0) ? (prevAmpSum / static_cast<float>(period)) : 0.0f;
-    constexpr float ampCurve = 20.0f;
-    const float safeAmp = std::max(0.0f, rawAmp);
-    const float mappedAmp = std::log1p(ampCurve * safeAmp) / std::log1p(ampCurve);
-    // outAmp = juce::jlimit(0.0f, 1.0f, mappedAmp);
-    outAmp = safeAmp; 
-    // DBG("After analyse: amp " << outAmp << " hasF " << hasFreq << " freq " << outFreq);
-    outAmp = 1.0;// for now
-    return true;
+    // Refine each candidate at the full analysis rate; the caller's hill climb and parabolic
+    // interpolation then run on full-rate lags as usual.
+    bool foundPeak = false;
+    maxSum = threshold;
+    for (int c = 0; c < numCandidates; ++c)
+    {
+        const int centre = candidates[static_cast<size_t>(c)] * coarseFactor;
+        const int first = std::max(minPeriod, centre - coarseFactor + 1);
+        const int last = std::min(maxPeriod, centre + coarseFactor - 1);
+        for (int fine = first; fine <= last; ++fine)
+        {
+            const float ampSum = lagSum(fine, last - fine + 1);
+            if (ampSum > maxSum)
+            {
+                foundPeak = true;
+                maxSum = ampSum;
+                period = fine;
+            }
+        }
+    }
+
+    return foundPeak;
 }
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <JuceHeader.h>
+#include <memory>
 #include <vector>
 
+#include "CorrelationKernels.h"
+#include "DecimatingFilter.h"
+#include "StageProfiler.h"
+#include "YinEngine.h"
+
 class PitchDetector
 {
 public:
@@ -13,10 +20,57 @@ public:
         float execFreq = 100.0f;
         int maxBinsPerOctave = 16;
         int medianSize = 1;
+        // A hop is unvoiced unless one of the samples its energy comes from reaches this level: the
+        // window's first maxPeriod samples for the autocorrelation, all of YIN's window for yin.
         float ampThreshold = 0.02f;
         float peakThreshold = 0.5f;
         int downSample = 1;
+        // Low-pass filter before dropping samples, so partials above the decimated Nyquist
+        // frequency do not alias into the analysis band. Off by default, so downSample > 1 keeps
+        // analysing the plain strided input.
+        bool antiAliasDownSample = false;
+        // Ignore downSample and derive the factor from maxFreq and the sample rate.
+        bool autoDownSample = false;
         bool clarity = false;
+        // Compute the whole lag function per hop with a real FFT instead of one dot product per lag.
+        bool fftCorrelation = false;
+        // Use the scalar lag kernel, which sums in the original order and so gives bit-identical
+        // detections; otherwise the best SIMD kernel for this CPU is picked at prepare(), unless
+        // it fails prepare()'s check against the scalar kernel.
+        bool scalarKernel = false;
+        // Keep running lag sums across overlapping hops and only add/remove the execPeriod samples
+        // that changed, re-anchoring with a full recompute every incrementalRefreshHops hops.
+        // Ignored when fftCorrelation is on.
+        bool incremental = false;
+        int incrementalRefreshHops = 64;
+        // After a confident hop, only search +/- trackingSemitones around the previous period.
+        // Falls back to the full search when the previous clarity is below trackingClarity or the
+        // constrained peak lands on the window edge.
+        bool tracking = false;
+        float trackingSemitones = 2.0f;
+        float trackingClarity = 0.8f;
+        // Run the lag search on a copy of the window decimated by this power of two, then refine
+        // the best candidates at the full analysis rate. 1 disables the coarse stage.
+        int coarseFactor = 1;
+        // Spread each hop's lag search over this many audio callbacks, bounding the per-callback
+        // cost at the price of getLatencySamples() extra latency. 1 runs it all at the hop.
+        // Clamped to the callbacks between hops at the prepared block size, and ignored when
+        // fftCorrelation, incremental, tracking or coarseFactor is on.
+        int analysisSlices = 1;
+
+        enum class Engine
+        {
+            // SuperCollider's Pitch: the first autocorrelation peak above peakThreshold, with
+            // every lag search option above.
+            autocorrelation,
+            // YinEngine on a 1.5 * maxPeriod window. The lag search options (fftCorrelation,
+            // incremental, tracking, coarseFactor, analysisSlices) and peakThreshold do not apply.
+            yin
+        };
+        // Picked once per hop; the input feed, decimation, amplitude gate and median are shared.
+        Engine engine = Engine::autocorrelation;
+        // YIN's absolute threshold: the largest normalised difference accepted as a period.
+        float yinThreshold = 0.15f;
     };
 
     struct Detection
@@ -27,24 +81,211 @@ public:
         int sampleOffset = 0;
     };
 
+    // Lag cache counters. A hit is a lag read served from this hop's cache (including lags filled by
+    // the FFT or incremental engines); a miss is a lag the dot-product kernel had to compute.
+    // trackedSearches, coarseSearches and fullSearches count which search settled each hop.
+    struct Stats
+    {
+        juce::int64 hops = 0;
+        juce::int64 lagCacheHits = 0;
+        juce::int64 lagCacheMisses = 0;
+        juce::int64 trackedSearches = 0;
+        juce::int64 coarseSearches = 0;
+        juce::int64 fullSearches = 0;
+        juce::int64 droppedDetections = 0;
+        int hopLagCacheHits = 0;
+        int hopLagCacheMisses = 0;
+    };
+
+    // Everything processBlock() carries from one call to the next under fixed settings. The
+    // history is kept as the current window only, oldest sample first.
+    struct State
+    {
+        std::vector<float> window;
+        int historyLength = 0;
+        int samplesUntilHop = 0;
+        int downSampleCounter = 0;
+        std::vector<float> decimatorHistory;
+        int decimatorPhase = 0;
+        std::vector<float> medianValues;
+        std::vector<int> medianAges;
+        float freq = 0.0f;
+        float amp = 0.0f;
+        float hasFreq = 0.0f;
+        int trackedPeriod = 0;
+        float trackedClarity = 0.0f;
+        // Running sums of the scheduled lags, in schedule order; empty unless incremental.
+        std::vector<double> runningLagSums;
+        bool incrementalValid = false;
+        int hopsSinceAnchor = 0;
+        // A hop whose lag search is still being sliced: its window and the lags filled so far.
+        int pendingSlices = 0;
+        int pendingRun = 0;
+        int pendingRunOffset = 0;
+        int pendingHopOffset = 0;
+        std::vector<float> pendingWindow;
+        std::vector<float> pendingLagValues;
+        std::vector<juce::uint64> pendingLagValid;
+
+        bool operator==(const State& other) const;
+        bool operator!=(const State& other) const { return !(*this == other); }
+    };
+
+    // Allocates for the widest settings at this sample rate, then applies settings and resets.
     void prepare(double sampleRate, int samplesPerBlock, const Settings& settings);
+    // Real-time safe reconfiguration within the capacity reserved by prepare(). Keeps the window
+    // history, median and tracking state whenever the analysis rate is unchanged.
+    void applySettings(const Settings& settings);
     void reset();
     void processBlock(const float* input, int numSamples, std::vector<Detection>& detections);
+    const Stats& getStats() const { return stats; }
+    // Input samples by which detections trail the input they describe: the anti-alias filter's
+    // group delay plus amortised analysis, assuming callbacks of the prepared block size.
+    int getLatencySamples() const
+    {
+        return (decimator.isActive() ? decimator.getLatency() : 0) + (analysisSlices > 1 ? analysisSlices * blockSize : 0);
+    }
+    // Snapshot and restore for splitting a stream between detectors, e.g. analysing chunks of a
+    // recording in parallel. Both detectors must be prepared with the same sample rate, block size
+    // and settings; a restored detector then produces the same detections as the saved one would
+    // have. Not real-time safe: both may allocate.
+    void saveState(State& state) const;
+    void restoreState(const State& state);
+    // Input samples per cycle of the hop schedule, including incremental re-anchoring. A detector
+    // reset a whole number of cycles into another's stream hops in step with it.
+    int getHopCycleSamples() const;
+    // Input samples after a reset before the window, anti-alias filter and median hold nothing but
+    // the detector's own input, assuming every hop finds a pitch.
+    int getWarmUpSamples() const;
+    // Times the search, refine and median stages of each analysis. Must be called from the thread
+    // that runs processBlock, or before it starts; null turns timing off.
+    void setProfiler(StageProfiler* newProfiler) { profiler = newProfiler; }
+
+    // Driving the lag search from outside, e.g. PitchDetectorBatch filling several detectors' lags
+    // with one kernel. While hops are deferred, a hop only sets up its window and empties the lag
+    // cache, and processBlock() reports no detections: the caller fills lags with setLagValue() and
+    // runs the search with finishDeferredHop() before feeding the next hop's last sample. Any lag
+    // the search needs that was not filled is computed as usual. Only for the plain
+    // autocorrelation, without fftCorrelation, incremental, analysisSlices or YIN.
+    void setDeferHops(bool shouldDefer) { deferHops = shouldDefer; }
+    bool hasDeferredHop() const { return deferredHopOffset >= 0; }
+    // Block offset of the deferred hop within the processBlock() call that reached it.
+    int getDeferredHopOffset() const { return deferredHopOffset; }
+    // Runs the deferred hop's search, reporting its detection at sampleOffset.
+    void finishDeferredHop(int sampleOffset, std::vector<Detection>& detections);
+    // Input samples up to and including the one that completes the next hop.
+    int getInputSamplesUntilHop() const;
+    // The current hop's window of getWindowSize() analysis samples; lag l sums window[j] * window[j + l]
+    // for j < getMaxPeriod().
+    const float* getWindow() const { return window; }
+    int getWindowSize() const { return size; }
+    // Longest window any applySettings() can ask for after prepare().
+    int getWindowCapacity() const { return ringCapacity; }
+    int getMaxPeriod() const { return maxPeriod; }
+    int getMaxLag() const { return maxLag; }
+    // Lag 0 and every lag the searches can visit, ascending, appended to lags.
+    void getSearchLags(std::vector<int>& lags) const;
+    bool isLagCached(int lag) const { return isLagValid(lag); }
+    void setLagValue(int lag, float value);
+    // Whether this hop's full-range search can reach its result from the lags cached so far.
+    bool isSearchSettled() const;
 
 private:
     static constexpr int kMaxMedianSize = 31;
+    static constexpr int kLagBlock = 4;
+    static constexpr int kMaxDownSample = 32;
+    static constexpr int kMaxAnalysisSlices = 16;
+    // Lowest minFreq prepare() reserves for; lower settings are clamped to it.
+    static constexpr float kMinSupportedFreq = 20.0f;
+    static constexpr int kMaxCoarseFactor = 8;
+    static constexpr int kCoarseLagBlock = 8;
+    static constexpr int kMaxCoarseCandidates = 3;
+
+    struct LagRun
+    {
+        int first = 0;
+        int count = 0;
+    };
+
+    // How far isSearchSettled() has followed searchFullRange() through this hop's cached lags.
+    // Lags are only added to the cache during a hop, so the next call resumes where this one
+    // stopped instead of rescanning from lag 0.
+    struct SettleScan
+    {
+        bool started = false;
+        bool settled = false;
+        bool pastThreshold = false;
+        bool foundPeak = false;
+        int lag = 1;
+        int binStep = 1;
+        float threshold = 0.0f;
+    };
 
     static int log2ceil(int x);
     static float insertMedian(float* values, int* ages, int size, float value);
     static void initMedian(float* values, int* ages, int size, float value);
 
+    void feedAnalysis(const float* source, int count, int stride, int inputIndex, std::vector<Detection>& detections);
+    void writeToRing(const float* source, int count, int stride);
+    void runHop(int sampleOffset, std::vector<Detection>& detections);
+    void runPendingSlice(int sampleOffset, std::vector<Detection>& detections);
+    void finishHop(int sampleOffset, std::vector<Detection>& detections);
+    bool isAboveAmplitudeThreshold(const float* samples, int count) const;
+
+    // analyse() owns what the two period searches share: the amplitude gate, the frequency range
+    // check, the median and the outputs. It picks the search with a plain switch on useYin rather
+    // than through an engine interface, because the autocorrelation's lag cache also serves the
+    // sliced, incremental and batch paths. Each search returns the period in analysis samples with
+    // a clarity in [0, 1] and laps its own stages on the profiler.
     bool analyse(float& outFreq, float& outAmp, float& outClarity);
+    bool findAutocorrelationPeriod(float& period, float& clarity, juce::uint64& stageStart);
+    bool findYinPeriod(const float* yinWindow, float& period, float& clarity, juce::uint64& stageStart);
+    bool searchFullRange(float threshold, int& period, float& maxSum);
+    bool searchAroundPrior(int priorPeriod, float threshold, int& period, float& maxSum);
+    bool searchCoarseToFine(float threshold, int& period, float& maxSum);
+    int binStep(int lag) const;
+    void clearLagCache();
+    bool isLagValid(int lag) const;
+    void markLagValid(int lag);
+    float lagSum(int lag, int span);
+    void advanceIncrementalLags();
+    void retireIncrementalLags();
+    void computeFftLags();
 
-    std::vector<float> buffer;
+    // Mirrored analysis history: 2 * ringCapacity samples, each written at writePos and
+    // writePos + ringCapacity, so the latest size samples always start at writePos + ringCapacity - size.
+    std::vector<float> ring;
+    const float* window = nullptr;
     std::vector<float> medianValues;
     std::vector<int> medianAges;
+    DecimatingFilter decimator;
+    StageProfiler* profiler = nullptr;
+    std::vector<float> decimated;
+
+    std::vector<std::unique_ptr<juce::dsp::FFT>> ffts;
+    juce::dsp::FFT* fft = nullptr;
+    std::vector<float> fftWindow;
+    std::vector<float> fftSegment;
+    YinEngine yin;
+    // Per-hop lag cache: lagValues[lag] is meaningful when its bit in lagValid is set.
+    std::vector<float> lagValues;
+    std::vector<juce::uint64> lagValid;
+    mutable SettleScan settleScan;
+    CorrelationKernels::LagSumsFunction lagSums = nullptr;
+    CorrelationKernels::Isa kernelIsa = CorrelationKernels::Isa::scalar;
+    // The kernels used when scalarKernel is off: the CPU's best, unless prepare()'s check failed.
+    CorrelationKernels::Isa vectorIsa = CorrelationKernels::Isa::scalar;
+
+    std::vector<int> lagSchedule;
+    std::vector<LagRun> lagRuns;
+    std::vector<double> runningLagSums;
+    std::vector<float> coarseWindow;
+    std::vector<float> coarseLagValues;
+    std::vector<float> lagScratch;
+    std::vector<float> hopSnapshot;
 
     float freq = 440.0f;
+    float initFreq = 440.0f;
     float amp = 0.0f;
     float minFreq = 60.0f;
     float maxFreq = 2000.0f;
@@ -53,16 +294,46 @@ private:
     float analysisRate = 44100.0f;
     float ampThreshold = 0.02f;
     float peakThreshold = 0.5f;
+    float trackingSemitones = 2.0f;
+    float trackingClarity = 0.8f;
+    float trackedClarity = 0.0f;
 
     int minPeriod = 0;
     int maxPeriod = 0;
+    int maxLag = 0;
     int execPeriod = 0;
-    int index = 0;
+    int writePos = 0;
+    int samplesUntilHop = 0;
     int size = 0;
+    int ringCapacity = 0;
+    // Analysis samples written since the ring was last cleared, up to ringCapacity.
+    int historyLength = 0;
     int downSample = 1;
     int maxLog2Bins = 0;
     int medianSize = 1;
     int downSampleCounter = 0;
+    int incrementalRefreshHops = 64;
+    int hopsSinceAnchor = 0;
+    int trackedPeriod = 0;
+    int coarseFactor = 1;
+    int analysisSlices = 1;
+    int blockSize = 1;
+    int lagsPerSlice = 0;
+    int pendingSlices = 0;
+    int pendingRun = 0;
+    int pendingRunOffset = 0;
+    // Block offset of the sliced hop, where its detection comes out analysisSlices callbacks later.
+    int pendingHopOffset = 0;
+
+    Stats stats;
 
     bool getClarity = false;
+    bool useFft = false;
+    bool useIncremental = false;
+    bool incrementalValid = false;
+    bool historyValid = false;
+    bool useTracking = false;
+    bool useYin = false;
+    bool deferHops = false;
+    int deferredHopOffset = -1;
 };
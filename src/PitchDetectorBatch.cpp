@@ -0,0 +1,163 @@
+#include "PitchDetectorBatch.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+
+void PitchDetectorBatch::prepare(double sampleRate, int samplesPerBlock, int numChannels, const PitchDetector::Settings& settings)
+{
+    numChannels = juce::jlimit(0, kMaxChannels, numChannels);
+    detectors.clear();
+    detectors.resize(static_cast<size_t>(numChannels));
+    detections.assign(static_cast<size_t>(numChannels), {});
+    for (size_t channel = 0; channel < detectors.size(); ++channel)
+    {
+        detectors[channel].prepare(sampleRate, samplesPerBlock, getChannelSettings(settings));
+        detectors[channel].setDeferHops(true);
+        detections[channel].reserve(128);
+    }
+
+    // The lane kernels must sum each lane exactly as the scalar kernel does. Checked here, as
+    // applySettings() runs on the audio thread; kernels that fail the check are not used.
+    laneIsa = CorrelationKernels::detectIsa();
+    const bool laneKernelsMatch = CorrelationKernels::laneLagSumsMatchScalar(laneIsa);
+    jassert(laneKernelsMatch);
+    if (!laneKernelsMatch)
+        laneIsa = CorrelationKernels::Isa::scalar;
+
+    // Sized for the widest lane kernel, so applySettings() can switch kernels without allocating.
+    const int maxLanes = CorrelationKernels::getLaneCount(laneIsa);
+    const size_t capacity = detectors.empty() ? 0 : static_cast<size_t>(detectors.front().getWindowCapacity() + 1) * static_cast<size_t>(maxLanes);
+    laneWindows.assign(capacity, 0.0f);
+    laneLags.assign(capacity, 0.0f);
+    gridLags.reserve(capacity);
+    applySettings(settings);
+}
+
+void PitchDetectorBatch::applySettings(const PitchDetector::Settings& settings)
+{
+    const auto isa = settings.scalarKernel ? CorrelationKernels::Isa::scalar : laneIsa;
+    laneLagSums = CorrelationKernels::getLaneLagSums(isa);
+    lanes = CorrelationKernels::getLaneCount(isa);
+
+    const auto channelSettings = getChannelSettings(settings);
+    for (auto& detector : detectors)
+        detector.applySettings(channelSettings);
+
+    gridLags.clear();
+    if (!detectors.empty())
+        detectors.front().getSearchLags(gridLags);
+}
+
+void PitchDetectorBatch::reset()
+{
+    for (auto& detector : detectors)
+        detector.reset();
+    for (auto& channel : detections)
+        channel.clear();
+}
+
+void PitchDetectorBatch::processBlock(const float* const* inputs, int numSamples)
+{
+    for (auto& channel : detections)
+        channel.clear();
+
+    if (detectors.empty() || numSamples <= 0)
+        return;
+
+    // The channels run the same settings from the same reset, so they all hop on the same sample:
+    // feed each one up to the next hop, then analyse that hop for all of them together.
+    int start = 0;
+    while (start < numSamples)
+    {
+        const int count = std::min(numSamples - start, detectors.front().getInputSamplesUntilHop());
+        for (size_t channel = 0; channel < detectors.size(); ++channel)
+            detectors[channel].processBlock(inputs[channel] + start, count, noDetections);
+
+        if (detectors.front().hasDeferredHop())
+            runHop(start);
+        start += count;
+    }
+}
+
+void PitchDetectorBatch::runHop(int blockOffset)
+{
+    MYK_TRACE_SCOPE("batch hop");
+    for (int firstChannel = 0; firstChannel < getNumChannels(); firstChannel += lanes)
+        fillGroupLags(firstChannel, std::min(lanes, getNumChannels() - firstChannel));
+
+    // The searches find every grid lag they visit cached; only refinement neighbours off the grid
+    // are left for the detectors' own scalar kernel.
+    const int hopOffset = detectors.front().getDeferredHopOffset();
+    for (size_t channel = 0; channel < detectors.size(); ++channel)
+    {
+        auto& detector = detectors[channel];
+        jassert(detector.getDeferredHopOffset() == hopOffset);
+        detector.finishDeferredHop(blockOffset + hopOffset, detections[channel]);
+    }
+}
+
+bool PitchDetectorBatch::isGroupSettled(int firstChannel, int count) const
+{
+    for (int channel = firstChannel; channel < firstChannel + count; ++channel)
+        if (!detectors[static_cast<size_t>(channel)].isSearchSettled())
+            return false;
+    return true;
+}
+
+void PitchDetectorBatch::fillGroupLags(int firstChannel, int count)
+{
+    if (isGroupSettled(firstChannel, count))
+        return;
+
+    // Lanes past the last channel keep whatever they held; their sums are never read.
+    const int size = detectors[static_cast<size_t>(firstChannel)].getWindowSize();
+    for (int lane = 0; lane < count; ++lane)
+    {
+        const float* window = detectors[static_cast<size_t>(firstChannel + lane)].getWindow();
+        float* interleaved = laneWindows.data() + lane;
+        for (int j = 0; j < size; ++j)
+            interleaved[j * lanes] = window[j];
+    }
+
+    // A pass of eight lags costs about as much as two single lags, and the searches walk up the
+    // grid, so it is filled in whole passes from the bottom.
+    const int numGridLags = static_cast<int>(gridLags.size());
+    for (int start = 0; start < numGridLags; start += kLagsPerPass)
+    {
+        runLanes(firstChannel, count, gridLags.data() + start, std::min(kLagsPerPass, numGridLags - start));
+        if (isGroupSettled(firstChannel, count))
+            break;
+    }
+}
+
+void PitchDetectorBatch::runLanes(int firstChannel, int count, const int* lags, int numLags)
+{
+    laneLagSums(laneWindows.data(), detectors[static_cast<size_t>(firstChannel)].getMaxPeriod(), lags, numLags, laneLags.data());
+
+    for (int lane = 0; lane < count; ++lane)
+    {
+        auto& detector = detectors[static_cast<size_t>(firstChannel + lane)];
+        for (int k = 0; k < numLags; ++k)
+            detector.setLagValue(lags[k], laneLags[static_cast<size_t>(k * lanes + lane)]);
+    }
+}
+
+const std::vector<PitchDetector::Detection>& PitchDetectorBatch::getDetections(int channel) const
+{
+    return detections[static_cast<size_t>(channel)];
+}
+
+const PitchDetector::Stats& PitchDetectorBatch::getStats(int channel) const
+{
+    return detectors[static_cast<size_t>(channel)].getStats();
+}
+
+PitchDetector::Settings PitchDetectorBatch::getChannelSettings(PitchDetector::Settings settings)
+{
+    settings.engine = PitchDetector::Settings::Engine::autocorrelation;
+    settings.fftCorrelation = false;
+    settings.incremental = false;
+    settings.analysisSlices = 1;
+    settings.scalarKernel = true;
+    return settings;
+}
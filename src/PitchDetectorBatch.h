@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+#include "CorrelationKernels.h"
+#include "PitchDetector.h"
+
+// Runs the same pitch analysis on several channels at once. Each channel keeps its own
+// PitchDetector for the input history, decimation, peak search and median, but the lag sums are
+// computed for a whole group of channels together: at each hop the group's windows are interleaved
+// (sample j of lane c at j * lanes + c), so one vector instruction computes the same lag for 8
+// channels with AVX2 or 4 with SSE2 and NEON. The detectors defer their hops, and the batch fills
+// the group's search grid from the bottom, several lags per pass, until every channel's search can
+// settle; a group with no channel above the amplitude threshold costs nothing. The searches then
+// run on the filled lag caches.
+//
+// The lane kernels sum each channel in the scalar kernel's order, so every channel's detections are
+// bit-identical to a lone PitchDetector running getChannelSettings() of the same settings.
+class PitchDetectorBatch
+{
+public:
+    static constexpr int kMaxChannels = 16;
+
+    // Not real-time safe: allocates numChannels detectors (clamped to kMaxChannels).
+    void prepare(double sampleRate, int samplesPerBlock, int numChannels, const PitchDetector::Settings& settings);
+
+    // Audio thread.
+    void applySettings(const PitchDetector::Settings& settings);
+    void reset();
+    // inputs holds getNumChannels() channels of numSamples samples each.
+    void processBlock(const float* const* inputs, int numSamples);
+
+    int getNumChannels() const { return static_cast<int>(detectors.size()); }
+    // Channels per kernel pass. A last group with fewer channels still costs a whole pass.
+    int getLaneCount() const { return lanes; }
+    // The last block's detections for a channel.
+    const std::vector<PitchDetector::Detection>& getDetections(int channel) const;
+    const PitchDetector::Stats& getStats(int channel) const;
+
+    // What each channel actually runs: the batch is its own lag engine for the autocorrelation,
+    // so YIN, FFT, incremental and sliced analysis are off, and scalarKernel is on to name the
+    // reference it matches.
+    static PitchDetector::Settings getChannelSettings(PitchDetector::Settings settings);
+
+private:
+    // Lags per pass of the multi-lag lane kernels.
+    static constexpr int kLagsPerPass = 8;
+
+    void runHop(int blockOffset);
+    bool isGroupSettled(int firstChannel, int count) const;
+    // Fills this hop's grid lags for count channels from firstChannel until their searches settle.
+    void fillGroupLags(int firstChannel, int count);
+    void runLanes(int firstChannel, int count, const int* lags, int numLags);
+
+    std::vector<PitchDetector> detectors;
+    std::vector<std::vector<PitchDetector::Detection>> detections;
+    // processBlock() output of the detectors themselves, which stays empty while hops are deferred.
+    std::vector<PitchDetector::Detection> noDetections;
+    // The interleaved windows of the group being analysed and lag sums for a pass of lags. Sized
+    // for the widest settings.
+    std::vector<float> laneWindows;
+    std::vector<float> laneLags;
+    // PitchDetector::getSearchLags() of the current settings.
+    std::vector<int> gridLags;
+    CorrelationKernels::LaneLagSumsFunction laneLagSums = nullptr;
+    // The CPU's best lane kernels, unless prepare()'s check failed.
+    CorrelationKernels::Isa laneIsa = CorrelationKernels::Isa::scalar;
+    int lanes = 1;
+};
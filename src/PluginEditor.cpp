@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "TraceRecorder.h"
 
 #include <array>
 
@@ -19,10 +20,12 @@ TestPluginAudioProcessorEditor::TestPluginAudioProcessorEditor (TestPluginAudioP
     // editor's size to whatever you need it to be.
     addAndMakeVisible(pianoRoll);
     addAndMakeVisible(levelMeter);
+    addChildComponent(profilerOverlay);
     addAndMakeVisible(controlTabs);
     controlTabs.setTabBarDepth(26);
     controlTabs.addTab("Basic", juce::Colour(0xFF151C22), &basicControls, false);
     controlTabs.addTab("Advanced", juce::Colour(0xFF151C22), &advancedControls, false);
+    controlTabs.addTab("Engine", juce::Colour(0xFF151C22), &engineControls, false);
 
     auto& vts = audioProcessor.getValueTreeState();
 
@@ -53,11 +56,39 @@ TestPluginAudioProcessorEditor::TestPluginAudioProcessorEditor (TestPluginAudioP
     configureSlider(advancedControls, downSampleSlider, downSampleLabel, "Downsample");
     configureSlider(advancedControls, noteLengthSlider, noteLengthLabel, "Max Note Length (s)");
     configureSlider(advancedControls, decaySlider, decayLabel, "Decay (s)");
+    configureSlider(engineControls, trackingRangeSlider, trackingRangeLabel, "Track Range (st)");
+    configureSlider(engineControls, trackingClaritySlider, trackingClarityLabel, "Track Clarity");
+    configureSlider(engineControls, analysisSlicesSlider, analysisSlicesLabel, "Analysis Slices");
+    configureSlider(engineControls, asyncLatencySlider, asyncLatencyLabel, "Async Latency (ms)");
+    configureSlider(engineControls, yinThresholdSlider, yinThresholdLabel, "YIN Thresh");
+
+    auto configureComboBox = [&](juce::Component& parent, juce::ComboBox& box, juce::Label& label, const juce::String& text, const juce::StringArray& items)
+    {
+        box.addItemList(items, 1);
+        label.setText(text, juce::dontSendNotification);
+        label.setColour(juce::Label::textColourId, juce::Colour(0xFFB7C6D9));
+        label.setJustificationType(juce::Justification::centredLeft);
+        parent.addAndMakeVisible(label);
+        parent.addAndMakeVisible(box);
+    };
+
+    configureComboBox(engineControls, coarseFactorBox, coarseFactorLabel, "Coarse Search", { "1", "2", "4", "8" });
+    configureComboBox(engineControls, engineBox, engineLabel, "Engine", { "Autocorrelation", "YIN" });
     scrollToggle.setButtonText("Scroll");
     scrollToggle.setToggleState(true, juce::dontSendNotification);
     clarityToggle.setButtonText("Clarity");
+    antiAliasToggle.setButtonText("Anti-alias");
+    autoDownSampleToggle.setButtonText("Auto DS");
     midiThruToggle.setButtonText("MIDI Thru");
     freezeToggle.setButtonText("GUI Freeze");
+    multiChannelToggle.setButtonText("Multi-channel");
+    dcBlockToggle.setButtonText("DC Block");
+    fftToggle.setButtonText("FFT Correlation");
+    incrementalToggle.setButtonText("Incremental Lags");
+    trackingToggle.setButtonText("Pitch Tracking");
+    asyncToggle.setButtonText("Async Analysis");
+    profilerToggle.setButtonText("CPU Overlay");
+    traceToggle.setButtonText("Record Trace");
     freezeIndicator.setText("Frozen", juce::dontSendNotification);
     freezeIndicator.setColour(juce::Label::textColourId, juce::Colour(0xFFE8C35E));
     freezeIndicator.setJustificationType(juce::Justification::centredRight);
@@ -65,8 +96,18 @@ TestPluginAudioProcessorEditor::TestPluginAudioProcessorEditor (TestPluginAudioP
     basicControls.addAndMakeVisible(scrollToggle);
     basicControls.addAndMakeVisible(midiThruToggle);
     basicControls.addAndMakeVisible(freezeToggle);
+    basicControls.addAndMakeVisible(multiChannelToggle);
+    basicControls.addAndMakeVisible(dcBlockToggle);
     basicControls.addAndMakeVisible(freezeIndicator);
     advancedControls.addAndMakeVisible(clarityToggle);
+    advancedControls.addAndMakeVisible(antiAliasToggle);
+    advancedControls.addAndMakeVisible(autoDownSampleToggle);
+    engineControls.addAndMakeVisible(fftToggle);
+    engineControls.addAndMakeVisible(incrementalToggle);
+    engineControls.addAndMakeVisible(trackingToggle);
+    engineControls.addAndMakeVisible(asyncToggle);
+    engineControls.addAndMakeVisible(profilerToggle);
+    engineControls.addAndMakeVisible(traceToggle);
 
     initFreqAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "initFreq", initFreqSlider);
     minFreqAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "minFreq", minFreqSlider);
@@ -82,14 +123,54 @@ TestPluginAudioProcessorEditor::TestPluginAudioProcessorEditor (TestPluginAudioP
     downSampleAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "downSample", downSampleSlider);
     noteLengthAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "noteLengthMs", noteLengthSlider);
     decayAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "decayTime", decaySlider);
+    trackingRangeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "trackingRange", trackingRangeSlider);
+    trackingClarityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "trackingClarity", trackingClaritySlider);
+    analysisSlicesAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "analysisSlices", analysisSlicesSlider);
+    asyncLatencyAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "asyncLatency", asyncLatencySlider);
+    yinThresholdAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(vts, "yinThreshold", yinThresholdSlider);
 
     clarityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "clarity", clarityToggle);
+    antiAliasAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "antiAlias", antiAliasToggle);
+    autoDownSampleAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "autoDownSample", autoDownSampleToggle);
     midiThruAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "midiThru", midiThruToggle);
     freezeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "freeze", freezeToggle);
+    multiChannelAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "multiChannel", multiChannelToggle);
+    dcBlockAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "dcBlock", dcBlockToggle);
+    fftAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "fftCorr", fftToggle);
+    incrementalAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "incremental", incrementalToggle);
+    trackingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "tracking", trackingToggle);
+    asyncAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(vts, "asyncAnalysis", asyncToggle);
+    engineAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(vts, "engine", engineBox);
+    coarseFactorAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(vts, "coarseSearch", coarseFactorBox);
     scrollToggle.onClick = [this]
     {
         pianoRoll.setScrollEnabled(scrollToggle.getToggleState());
     };
+    profilerToggle.onClick = [this]
+    {
+        profilerOverlay.setVisible(profilerToggle.getToggleState());
+    };
+    traceToggle.setToggleState(TraceRecorder::isRecording(), juce::dontSendNotification);
+    traceToggle.onClick = [this]
+    {
+        if (traceToggle.getToggleState())
+        {
+            TraceRecorder::start();
+            return;
+        }
+
+        TraceRecorder::stop();
+        const auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                              .getNonexistentChildFile("myk-pitch-trace", ".json");
+        const bool written = TraceRecorder::writeChromeTrace(file);
+        const int untraced = TraceRecorder::getUntracedThreadCount();
+        juce::String message = written ? "Saved " + file.getFullPathName() + "\nOpen it in ui.perfetto.dev or chrome://tracing."
+                                       : "Could not write " + file.getFullPathName();
+        if (untraced > 0)
+            message << "\n" << untraced << " thread(s) were left out: every trace buffer was taken.";
+        juce::AlertWindow::showMessageBoxAsync(written && untraced == 0 ? juce::MessageBoxIconType::InfoIcon : juce::MessageBoxIconType::WarningIcon,
+                                               "Trace", message);
+    };
 
     pianoRoll.setTimeWindowSeconds(8.0);
     pianoRoll.setScrollEnabled(true);
@@ -130,6 +211,7 @@ void TestPluginAudioProcessorEditor::resized()
     const int pianoHeight = fullArea.getHeight() / 2;
     
     pianoRoll.setBounds(fullArea.removeFromTop(pianoHeight));
+    profilerOverlay.setBounds(pianoRoll.getBounds().reduced(8).removeFromRight(300).removeFromTop(148));
 
     fullArea.removeFromTop(10);
     auto area = fullArea.reduced(12, 0);
@@ -157,6 +239,8 @@ void TestPluginAudioProcessorEditor::resized()
     scrollToggle.setBounds(scrollRow.removeFromLeft(100));
     midiThruToggle.setBounds(scrollRow.removeFromLeft(110));
     freezeToggle.setBounds(scrollRow.removeFromLeft(80));
+    multiChannelToggle.setBounds(scrollRow.removeFromLeft(120));
+    dcBlockToggle.setBounds(scrollRow.removeFromLeft(90));
     freezeIndicator.setBounds(scrollRow);
 
     auto advancedArea = advancedControls.getLocalBounds().reduced(10, 8);
@@ -172,6 +256,13 @@ void TestPluginAudioProcessorEditor::resized()
         slider.setBounds(line);
     };
 
+    auto comboRow = [&](juce::Rectangle<int>& column, juce::Label& label, juce::ComboBox& box)
+    {
+        auto line = column.removeFromTop(advancedRowHeight);
+        label.setBounds(line.removeFromLeft(labelWidth));
+        box.setBounds(line.removeFromLeft(160).reduced(0, 1));
+    };
+
     advancedRow(leftColumn, execFreqLabel, execFreqSlider);
     advancedRow(leftColumn, initFreqLabel, initFreqSlider);
     advancedRow(leftColumn, minFreqLabel, minFreqSlider);
@@ -187,10 +278,40 @@ void TestPluginAudioProcessorEditor::resized()
     rightColumn.removeFromTop(6);
     auto toggleRow = rightColumn.removeFromTop(24);
     clarityToggle.setBounds(toggleRow.removeFromLeft(90));
+    antiAliasToggle.setBounds(toggleRow.removeFromLeft(100));
+    autoDownSampleToggle.setBounds(toggleRow.removeFromLeft(90));
+
+    auto engineArea = engineControls.getLocalBounds().reduced(10, 8);
+    auto engineToggleRow = engineArea.removeFromTop(24);
+    fftToggle.setBounds(engineToggleRow.removeFromLeft(140));
+    incrementalToggle.setBounds(engineToggleRow.removeFromLeft(140));
+    trackingToggle.setBounds(engineToggleRow.removeFromLeft(140));
+    asyncToggle.setBounds(engineToggleRow.removeFromLeft(140));
+
+    engineArea.removeFromTop(6);
+    auto engineLeftColumn = engineArea.removeFromLeft((engineArea.getWidth() - columnGap) / 2);
+    engineArea.removeFromLeft(columnGap);
+    auto engineRightColumn = engineArea;
+
+    advancedRow(engineLeftColumn, trackingRangeLabel, trackingRangeSlider);
+    advancedRow(engineRightColumn, trackingClarityLabel, trackingClaritySlider);
+    comboRow(engineLeftColumn, coarseFactorLabel, coarseFactorBox);
+    advancedRow(engineRightColumn, analysisSlicesLabel, analysisSlicesSlider);
+    advancedRow(engineLeftColumn, asyncLatencyLabel, asyncLatencySlider);
+    advancedRow(engineRightColumn, yinThresholdLabel, yinThresholdSlider);
+
+    comboRow(engineLeftColumn, engineLabel, engineBox);
+
+    engineRightColumn.removeFromTop(2);
+    auto engineToggleRow2 = engineRightColumn.removeFromTop(20);
+    profilerToggle.setBounds(engineToggleRow2.removeFromLeft(140));
+    traceToggle.setBounds(engineToggleRow2.removeFromLeft(140));
 }
 
 void TestPluginAudioProcessorEditor::timerCallback()
 {
+    TraceRecorder::setThreadName("Message");
+    MYK_TRACE_SCOPE("editor timer");
     const bool frozen = audioProcessor.getValueTreeState().getRawParameterValue("freeze")->load() > 0.5f;
     const bool basicTabActive = (controlTabs.getCurrentTabIndex() == 0);
     freezeIndicator.setVisible(frozen && basicTabActive);
@@ -218,4 +339,7 @@ void TestPluginAudioProcessorEditor::timerCallback()
     }
 
     levelMeter.setRMS(audioProcessor.getRmsLevel());
+
+    if (profilerOverlay.isVisible())
+        profilerOverlay.update(audioProcessor.getProfiler());
 }
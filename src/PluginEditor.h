@@ -12,6 +12,7 @@
 #include "PluginProcessor.h"
 #include "OpenGLPianoRollComponent.h"
 #include "LevelMeterComp.h"
+#include "ProfilerOverlay.h"
 
 //==============================================================================
 /**
@@ -35,6 +36,7 @@ private:
 
     OpenGLPianoRollComponent pianoRoll;
     LevelMeterComp levelMeter;
+    ProfilerOverlay profilerOverlay;
 
     juce::Slider minFreqSlider;
     juce::Slider initFreqSlider;
@@ -50,10 +52,18 @@ private:
     juce::Slider downSampleSlider;
     juce::Slider noteLengthSlider;
     juce::Slider decaySlider;
+    juce::Slider trackingRangeSlider;
+    juce::Slider trackingClaritySlider;
+    juce::Slider analysisSlicesSlider;
+    juce::Slider asyncLatencySlider;
+    juce::Slider yinThresholdSlider;
+    juce::ComboBox engineBox;
+    juce::ComboBox coarseFactorBox;
 
     juce::TabbedComponent controlTabs { juce::TabbedButtonBar::TabsAtTop };
     juce::Component basicControls;
     juce::Component advancedControls;
+    juce::Component engineControls;
 
     juce::Label minFreqLabel;
     juce::Label initFreqLabel;
@@ -69,11 +79,28 @@ private:
     juce::Label downSampleLabel;
     juce::Label noteLengthLabel;
     juce::Label decayLabel;
+    juce::Label trackingRangeLabel;
+    juce::Label trackingClarityLabel;
+    juce::Label coarseFactorLabel;
+    juce::Label analysisSlicesLabel;
+    juce::Label asyncLatencyLabel;
+    juce::Label yinThresholdLabel;
+    juce::Label engineLabel;
 
     juce::ToggleButton scrollToggle;
     juce::ToggleButton clarityToggle;
+    juce::ToggleButton antiAliasToggle;
+    juce::ToggleButton autoDownSampleToggle;
     juce::ToggleButton midiThruToggle;
     juce::ToggleButton freezeToggle;
+    juce::ToggleButton multiChannelToggle;
+    juce::ToggleButton dcBlockToggle;
+    juce::ToggleButton fftToggle;
+    juce::ToggleButton incrementalToggle;
+    juce::ToggleButton trackingToggle;
+    juce::ToggleButton asyncToggle;
+    juce::ToggleButton profilerToggle;
+    juce::ToggleButton traceToggle;
     juce::Label freezeIndicator;
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> minFreqAttachment;
@@ -90,10 +117,25 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> downSampleAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> noteLengthAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> decayAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> trackingRangeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> trackingClarityAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> analysisSlicesAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> asyncLatencyAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> yinThresholdAttachment;
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> clarityAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> antiAliasAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> autoDownSampleAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> midiThruAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> freezeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> multiChannelAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> dcBlockAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> fftAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> incrementalAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> trackingAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> asyncAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> engineAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> coarseFactorAttachment;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TestPluginAudioProcessorEditor)
 };
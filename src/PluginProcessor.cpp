@@ -8,6 +8,8 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "RealtimeAudit.h"
+#include "TraceRecorder.h"
 
 #include <cmath>
 
@@ -30,6 +32,24 @@ namespace
     constexpr const char* paramDecayTime = "decayTime";
     constexpr const char* paramMidiThru = "midiThru";
     constexpr const char* paramFreeze = "freeze";
+    constexpr const char* paramFftCorrelation = "fftCorr";
+    constexpr const char* paramIncremental = "incremental";
+    constexpr const char* paramTracking = "tracking";
+    constexpr const char* paramTrackingRange = "trackingRange";
+    constexpr const char* paramTrackingClarity = "trackingClarity";
+    constexpr const char* paramCoarseFactor = "coarseSearch";
+    // Sessions saved before the coarse search became a choice hold the factor under this id.
+    constexpr const char* legacyParamCoarseFactor = "coarseFactor";
+    constexpr const char* paramAntiAlias = "antiAlias";
+    constexpr const char* paramAnalysisSlices = "analysisSlices";
+    constexpr const char* paramAsyncAnalysis = "asyncAnalysis";
+    constexpr const char* paramAsyncLatency = "asyncLatency";
+    constexpr float maxAsyncLatencyMs = 250.0f;
+    constexpr const char* paramAutoDownSample = "autoDownSample";
+    constexpr const char* paramMultiChannel = "multiChannel";
+    constexpr const char* paramDcBlock = "dcBlock";
+    constexpr const char* paramEngine = "engine";
+    constexpr const char* paramYinThreshold = "yinThreshold";
 
     PitchDetector::Settings readSettings(juce::AudioProcessorValueTreeState& params)
     {
@@ -43,7 +63,18 @@ namespace
         settings.ampThreshold = params.getRawParameterValue(paramAmpThresh)->load();
         settings.peakThreshold = params.getRawParameterValue(paramPeakThresh)->load();
         settings.downSample = static_cast<int>(params.getRawParameterValue(paramDownSample)->load());
+        settings.antiAliasDownSample = params.getRawParameterValue(paramAntiAlias)->load() > 0.5f;
+        settings.autoDownSample = params.getRawParameterValue(paramAutoDownSample)->load() > 0.5f;
         settings.clarity = params.getRawParameterValue(paramClarity)->load() > 0.5f;
+        settings.fftCorrelation = params.getRawParameterValue(paramFftCorrelation)->load() > 0.5f;
+        settings.incremental = params.getRawParameterValue(paramIncremental)->load() > 0.5f;
+        settings.tracking = params.getRawParameterValue(paramTracking)->load() > 0.5f;
+        settings.trackingSemitones = params.getRawParameterValue(paramTrackingRange)->load();
+        settings.trackingClarity = params.getRawParameterValue(paramTrackingClarity)->load();
+        settings.coarseFactor = 1 << static_cast<int>(params.getRawParameterValue(paramCoarseFactor)->load());
+        settings.analysisSlices = static_cast<int>(params.getRawParameterValue(paramAnalysisSlices)->load());
+        settings.engine = static_cast<PitchDetector::Settings::Engine>(static_cast<int>(params.getRawParameterValue(paramEngine)->load()));
+        settings.yinThreshold = params.getRawParameterValue(paramYinThreshold)->load();
         return settings;
     }
 
@@ -63,7 +94,18 @@ namespace
             && nearlyEqual(a.ampThreshold, b.ampThreshold)
             && nearlyEqual(a.peakThreshold, b.peakThreshold)
             && a.downSample == b.downSample
-            && a.clarity == b.clarity;
+            && a.antiAliasDownSample == b.antiAliasDownSample
+            && a.autoDownSample == b.autoDownSample
+            && a.clarity == b.clarity
+            && a.fftCorrelation == b.fftCorrelation
+            && a.incremental == b.incremental
+            && a.tracking == b.tracking
+            && nearlyEqual(a.trackingSemitones, b.trackingSemitones)
+            && nearlyEqual(a.trackingClarity, b.trackingClarity)
+            && a.coarseFactor == b.coarseFactor
+            && a.analysisSlices == b.analysisSlices
+            && a.engine == b.engine
+            && nearlyEqual(a.yinThreshold, b.yinThreshold);
     }
 }
 
@@ -81,10 +123,41 @@ TestPluginAudioProcessor::TestPluginAudioProcessor()
 #endif
     , parameters(*this, nullptr, "PARAMS", createParameterLayout())
 {
+    publishedSettings = readSettings(parameters);
+    settingsSnapshot.store(publishedSettings);
+    pitchDetector.setProfiler(&profiler);
+    startTimerHz(30);
 }
 
 TestPluginAudioProcessor::~TestPluginAudioProcessor()
 {
+    stopTimer();
+}
+
+void TestPluginAudioProcessor::timerCallback()
+{
+    // Parameters are read and compared here on the message thread; the audio thread only picks up
+    // a new snapshot when its version changes.
+    const auto settings = readSettings(parameters);
+    if (!settingsEqual(settings, publishedSettings))
+    {
+        publishedSettings = settings;
+        settingsSnapshot.store(settings);
+    }
+
+    // The worker threads only run while their mode is on; starting and stopping them can block.
+    const bool prepared = resourcesPrepared.load(std::memory_order_acquire);
+    const bool asyncAnalysis = parameters.getRawParameterValue(paramAsyncAnalysis)->load() > 0.5f && prepared;
+    if (asyncAnalysis && !analysisWorker.isRunning())
+        analysisWorker.start();
+    else if (!asyncAnalysis && analysisWorker.isRunning())
+        analysisWorker.stop();
+    voiceTracker.setWorkersEnabled(parameters.getRawParameterValue(paramMultiChannel)->load() > 0.5f && prepared);
+
+    // setLatencySamples notifies the host and listeners, which can lock, so it is only called here.
+    const int latency = pendingLatency.load(std::memory_order_relaxed);
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
 }
 
 //==============================================================================
@@ -157,33 +230,43 @@ void TestPluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPerB
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    resourcesPrepared.store(false, std::memory_order_release);
     lastSampleRate = sampleRate;
     lastBlockSize = samplesPerBlock;
     pitchSettings = readSettings(parameters);
+    publishedSettings = pitchSettings;
+    settingsSnapshot.store(pitchSettings);
+    appliedSettingsVersion = settingsSnapshot.getVersion();
     pitchDetector.prepare(sampleRate, samplesPerBlock, pitchSettings);
-    lastPitchSettings = pitchSettings;
-    monoBuffer.assign(static_cast<size_t>(samplesPerBlock), 0.0f);
+    profiler.prepare(sampleRate);
+    analysisWorker.prepare(sampleRate, samplesPerBlock, static_cast<int>(maxAsyncLatencyMs * 0.001f * static_cast<float>(sampleRate)), pitchSettings);
+    if (parameters.getRawParameterValue(paramAsyncAnalysis)->load() > 0.5f)
+        analysisWorker.start();
+    asyncActive = false;
+    asyncSettingsPending = false;
+    asyncResetPending = false;
+    voiceTracker.prepare(sampleRate, samplesPerBlock, getTotalNumInputChannels(), pitchSettings);
+    voiceTracker.setWorkersEnabled(parameters.getRawParameterValue(paramMultiChannel)->load() > 0.5f);
+    multiChannelActive = false;
+    updateReportedLatency();
+    setLatencySamples(pendingLatency.load());
+    inputConditioner.prepare(sampleRate, samplesPerBlock);
     detections.reserve(128);
     sampleCounter = 0;
     logCounter = 0;
-    currentActiveNote = -1;
-    lastDetectionSample = -1;
-    hasPendingNote = false;
-    pendingNote = -1;
-    pendingVelocity = 0;
-    // pendingDetectionSample = -1;
-    noteOnTimestamps.fill(0);
-    noteOffTimestamps.fill(0);
-    noteDetected.fill(false);
-    noteOffNeeded.fill(false);
-
-    
+    noteEvents.reserve(4);
+    sliceMidi.ensureSize(256);
+    noteSegmenter.reset();
+    resourcesPrepared.store(true, std::memory_order_release);
 }
 
 void TestPluginAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    resourcesPrepared.store(false, std::memory_order_release);
+    analysisWorker.stop();
+    voiceTracker.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -201,9 +284,13 @@ bool TestPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
      && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
-    // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    // Mono and stereo inputs pass straight through to a matching output. Wider inputs are for the
+    // multi-channel mode, which tracks every input channel as a voice of its own.
+    const int numInputs = layouts.getMainInputChannelSet().size();
+    if (numInputs < 1 || numInputs > MultiChannelTracker::kMaxVoices)
+        return false;
+    if (numInputs <= 2 && layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
    #endif
 
@@ -214,6 +301,9 @@ bool TestPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
 
 void TestPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    MYK_RT_SCOPE("TestPluginAudioProcessor::processBlock");
+    TraceRecorder::setThreadName("Audio");
+    MYK_TRACE_SCOPE("processBlock");
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -230,247 +320,123 @@ void TestPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
     const int numSamples = buffer.getNumSamples();
     if (numSamples <= 0 || totalNumInputChannels <= 0)
         return;
+    if (numSamples > lastBlockSize && lastBlockSize > 0)
+    {
+        processOversizedBlock(buffer, midiMessages);
+        return;
+    }
 
-    pitchSettings = readSettings(parameters);
+    const auto callbackStart = StageProfiler::now();
+
+    // Settings arrive as a snapshot from the message thread and are applied without allocating
+    // or dropping the analysis history. A read that overlaps a store is retried next block.
+    if (settingsSnapshot.getVersion() != appliedSettingsVersion)
+    {
+        PitchDetector::Settings published;
+        juce::uint32 version = 0;
+        if (settingsSnapshot.tryLoad(published, version))
+        {
+            pitchSettings = published;
+            appliedSettingsVersion = version;
+            pitchDetector.applySettings(pitchSettings);
+            voiceTracker.applySettings(pitchSettings);
+            asyncSettingsPending = true;
+        }
+    }
 
     const bool midiThru = parameters.getRawParameterValue(paramMidiThru)->load() > 0.5f;
 
     const float decayTimeSec = parameters.getRawParameterValue(paramDecayTime)->load();
     const float maxNoteLengthSec = parameters.getRawParameterValue(paramNoteLengthMs)->load();
     const float ampScale = parameters.getRawParameterValue(paramAmpScale)->load();
+    const bool dcBlock = parameters.getRawParameterValue(paramDcBlock)->load() > 0.5f;
     const int minVelocityParam = static_cast<int>(parameters.getRawParameterValue(paramMinVelocity)->load());
     const float minAllowedNoteLenSecs = parameters.getRawParameterValue(paramDelay)->load();
     const int64 decaySamples = static_cast<int64>(std::max(0.0f, decayTimeSec) * static_cast<float>(lastSampleRate));
     const int64 maxNoteLengthSamples = static_cast<int64>(std::max(0.0f, maxNoteLengthSec) * static_cast<float>(lastSampleRate));
     const int64 noteDelaySamples = static_cast<int64>(std::max(0.0f, minAllowedNoteLenSecs) * static_cast<float>(lastSampleRate));
 
-    if (!settingsEqual(pitchSettings, lastPitchSettings))
+    const bool asyncAnalysis = parameters.getRawParameterValue(paramAsyncAnalysis)->load() > 0.5f;
+    if (asyncAnalysis != asyncActive)
     {
-        pitchDetector.prepare(lastSampleRate, lastBlockSize, pitchSettings);
-        lastPitchSettings = pitchSettings;
+        // The side that was idle has a stale window, so it starts from scratch.
+        if (asyncAnalysis)
+        {
+            asyncResetPending = true;
+            asyncStartSample = sampleCounter;
+        }
+        else
+            pitchDetector.reset();
+        asyncActive = asyncAnalysis;
     }
 
     if (!midiThru)
         midiMessages.clear();
 
-    if (static_cast<int>(monoBuffer.size()) < numSamples)
-        monoBuffer.assign(static_cast<size_t>(numSamples), 0.0f);
-
-    const float channelScale = 1.0f / static_cast<float>(totalNumInputChannels);
-    float rmsSum = 0.0f;
-
-    constexpr int maxCachedInputChannels = 64;
-    std::array<const float*, maxCachedInputChannels> readPointers {};
-    const int numCachedInputChannels = juce::jmin(totalNumInputChannels, maxCachedInputChannels);
-    jassert(totalNumInputChannels <= maxCachedInputChannels);
-    for (int channel = 0; channel < numCachedInputChannels; ++channel)
-        readPointers[static_cast<size_t>(channel)] = buffer.getReadPointer(channel);
+    const bool multiChannel = parameters.getRawParameterValue(paramMultiChannel)->load() > 0.5f
+                           && voiceTracker.getNumVoices() > 0;
+    if (multiChannel != multiChannelActive)
+    {
+        // Close whatever the mode being left still holds; the other mode starts from scratch.
+        if (multiChannel)
+        {
+            releaseNotes(noteSegmenter.getState(), 1, midiMessages);
+            voiceTracker.reset();
+        }
+        else
+        {
+            for (int voice = 0; voice < voiceTracker.getNumVoices(); ++voice)
+                releaseNotes(voiceTracker.getSegmenterState(voice), voice + 1, midiMessages);
+            pitchDetector.reset();
+            inputConditioner.reset();
+            asyncResetPending = true;
+            asyncStartSample = sampleCounter;
+        }
+        noteSegmenter.reset();
+        multiChannelActive = multiChannel;
+    }
 
-    for (int sample = 0; sample < numSamples; ++sample)
+    if (multiChannelActive)
     {
-        float mixed = 0.0f;
-        for (int channel = 0; channel < numCachedInputChannels; ++channel)
-            mixed += readPointers[static_cast<size_t>(channel)][sample];
-
-        mixed *= channelScale;
-        mixed *= ampScale; 
-        monoBuffer[static_cast<size_t>(sample)] = mixed;
-        rmsSum += mixed * mixed;
+        NoteSegmenter::Settings segmenterSettings;
+        segmenterSettings.minNoteLengthSamples = static_cast<int64>(minAllowedNoteLenSecs * getSampleRate());
+        segmenterSettings.minVelocity = minVelocityParam;
+        processVoices(buffer, totalNumInputChannels, numSamples, ampScale, dcBlock, segmenterSettings, midiMessages);
+        updateReportedLatency();
+        profiler.endCallback(numSamples, callbackStart);
+        sampleCounter += numSamples;
+        return;
     }
 
-    const float rms = std::sqrt(rmsSum / static_cast<float>(numSamples));
+    auto stageStart = StageProfiler::now();
+
+    // A mono input at unity gain reaches the detector straight from the host's buffer.
+    const float* conditioned = inputConditioner.process(buffer.getArrayOfReadPointers(), totalNumInputChannels, numSamples,
+                                                        ampScale, dcBlock);
+    const float rms = inputConditioner.getRms();
     rmsLevel.store(rms, std::memory_order_relaxed);
-    
+    peakLevel.store(inputConditioner.getPeak(), std::memory_order_relaxed);
+    stageStart = profiler.lap(StageProfiler::downmix, stageStart);
 
     const int64 blockStartSample = sampleCounter;
     const int64 blockEndSample = sampleCounter + numSamples;
 
-    pitchDetector.processBlock(monoBuffer.data(), numSamples, detections);
-
-    
+    if (asyncActive)
+        runAsyncAnalysis(conditioned, numSamples, blockStartSample);
+    else
+        pitchDetector.processBlock(conditioned, numSamples, detections);
+    updateReportedLatency();
+    stageStart = profiler.lap(StageProfiler::detector, stageStart);
 
-    bool sendNoteOn = false;
-    bool sendNoteOff = false;
-    int noteOnToSend = -1;
-    int noteOffToSend = -1;
-    int noteOffSampleOffset = 0;
-    int noteOnSampleOffset = 0;
     
 
-    int velToPlay = -1;
-    int64 durToPlaySamples = -1;
-    const int64 minAllowedNoteLenSamples = minAllowedNoteLenSecs * getSampleRate();
-    int64 timeSinceNoteStartSamples = 0;
-
-    InstrumentState playerState;
-
-    // first detect silence 
-    if (detections.size() == 0){// silence 
-        silenceForNSamples += getBlockSize();
-
-        // if (silenceForNSamples > minAllowedNoteLenSamples){
-        //     playerState = InstrumentState::ShortSilence;        
-        // } 
-
-        // if (silenceForNSamples > minAllowedNoteLenSamples && 
-        //     currentActiveNote == -1){ // just a long silence
-            
-        //         playerState = InstrumentState::LongSilence;        
-        // }
-        if (silenceForNSamples > minAllowedNoteLenSamples && // long silence
-            currentActiveNote != -1){ // was playing a note
-                playerState = InstrumentState::NoteEndedNowSilentSendNoteOff;  
-                // reset it 
-                noteDetected[currentActiveNote] = false; 
-            
-                noteOffToSend = currentActiveNote; 
-                noteOffSampleOffset = getBlockSize() - 1;// give it some grace at the end 
-                currentActiveNote = -1;
-            }
-    }
-    if (detections.size() > 0){// notes
-        silenceForNSamples = 0;// reset that one 
-        PitchDetector::Detection newNoteData = detections[0];// only ever one actually
-        if (currentActiveNote != -1){// we are playing 
-            timeSinceNoteStartSamples = (blockStartSample + newNoteData.sampleOffset) - currentActiveNoteStartSample;
-        }
-        else{
-            timeSinceNoteStartSamples = 0;
-        }
-        int newNoteMidiNum = static_cast<int>(std::lround(69.0 + 12.0 * std::log2(newNoteData.freq / 440.0)));
-        // DBG("Got note " << newNoteMidiNum);
-        if (currentActiveNote == -1 &&// was not playing
-            newNoteMidiNum > 0){// is playing now 
-                playerState = InstrumentState::NoteAfterSilence;   
-                // start the timer 
-                currentActiveNoteStartSample = blockStartSample + newNoteData.sampleOffset; 
-        }
-        if (currentActiveNote != -1 &&// was playing
-            newNoteMidiNum != currentActiveNote){// note changed 
-                // DBG("Note switch from " << currentActiveNote << " to " << newNoteMidiNum );
-                noteDetected[currentActiveNote] = false; // reset this so i can request it next time i get this note
-                playerState = InstrumentState::NoteAfterOtherNote;  
-                // reset note start time for new note 
-                currentActiveNoteStartSample = blockStartSample + newNoteData.sampleOffset; 
-                // prepare to send a note off for the old note 
-                noteOffToSend = currentActiveNote; 
-                noteOffSampleOffset = newNoteData.sampleOffset;
-                
-        } 
-
-        if (currentActiveNote != -1 &&// was playing
-            newNoteMidiNum == currentActiveNote){// still playing same note 
-                playerState = InstrumentState::NoteHeldNotLongEnoughYet;// assume its too short
-                
-                // is the held note held long enough to 
-                // allow a note on message? 
-                // DBG("held note "<< currentActiveNote << "  length so far " << timeSinceNoteStartSamples << " of " << minAllowedNoteLenSamples);
-
-                if (timeSinceNoteStartSamples > minAllowedNoteLenSamples){
-                    if (noteDetected[currentActiveNote]){// already requested a note on
-                        playerState = InstrumentState::NoteHeldNoteOnSent; 
-                        // DBG("I think I sent note " << currentActiveNote);
-                    }
-                    else{// its long enough and we've not requested a note on yet 
-                        // DBG("Time to send a note on " << currentActiveNote << " set request note to true");
-                        playerState = InstrumentState::NoteLongEnoughSendNoteOn; 
-                        noteDetected[currentActiveNote] = true; 
-                        noteOnToSend = currentActiveNote;
-                        noteOnSampleOffset = newNoteData.sampleOffset;
-                        DBG("RMS " << rms);
-                        velToPlay = juce::jlimit(minVelocityParam, 127, static_cast<int>(rms  * 127.0f));
-
-                    }
-                }
-        } 
-        currentActiveNote = newNoteMidiNum;
-    }
-
-    const double blockStartSeconds = static_cast<double>(blockStartSample) / getSampleRate();
+    NoteSegmenter::Settings segmenterSettings;
+    segmenterSettings.minNoteLengthSamples = static_cast<int64>(minAllowedNoteLenSecs * getSampleRate());
+    segmenterSettings.minVelocity = minVelocityParam;
+    noteSegmenter.processBlock(detections, blockStartSample, getBlockSize(), rms, segmenterSettings, noteEvents);
 
-
-    switch (playerState)
-    {
-        // case InstrumentState::LongSilence:       DBG("LongSilence"); break;
-        // case InstrumentState::ShortSilence:      DBG("ShortSilence"); break;
-        case InstrumentState::NoteAfterSilence:  {
-            // DBG("NoteAfterSilence"); 
-            break;
-        }
-        case InstrumentState::NoteAfterOtherNote:{
-            if (!noteOffNeeded[noteOffToSend]){// note is not on
-                break; 
-            }
-            // DBG("NoteAfterOtherNote"); 
-            // only if we actually sent an on for this note
-            // if (noteOffNeeded[noteOffToSend]){
-            // DBG("OFF " << noteOffToSend << "\n\n");
-            midiMessages.addEvent(juce::MidiMessage::noteOff(1, noteOffToSend), noteOffSampleOffset);
-            NoteEvent eventOff;
-            eventOff.note = noteOffToSend;
-            eventOff.velocity = 0.0f;
-            eventOff.noteOn = false;
-            eventOff.timeSeconds = blockStartSeconds + static_cast<double>(noteOffSampleOffset) / getSampleRate();
-            pushNoteEventFromAudioThread(eventOff);
-            lastNoteOff = noteOffToSend;
-            noteOffNeeded[noteOffToSend] = false; 
-
-            // }            
-            break;
-        }
- 
-        case InstrumentState::NoteHeldNotLongEnoughYet:{
-            // DBG("NoteHeldNotLongEnoughYet  min " << minAllowedNoteLenSamples << " is: " << timeSinceNoteStartSamples); 
-            // DBG("ON " << noteOnToSend << " rms " << rmsSum);
-            // midiMessages.addEvent(juce::MidiMessage::noteOn(1, noteOnToSend, static_cast<juce::uint8>(64)), noteOnSampleOffset);
-            break;
-        }
-        case InstrumentState::NoteLongEnoughSendNoteOn:{
-            // DBG("NoteLongEnoughSendNoteOn");
-            // DBG("ON " << noteOnToSend << " rms " << rmsSum);
-            juce::uint8 vel = static_cast<juce::uint8>(velToPlay);
-
-            midiMessages.addEvent(juce::MidiMessage::noteOn(1, noteOnToSend, vel), noteOnSampleOffset);
-            // tell the piano roll
-            NoteEvent eventOn;
-            eventOn.note = noteOnToSend;
-            eventOn.velocity = static_cast<float>(vel) / 127.0f;
-            eventOn.noteOn = true;
-            eventOn.timeSeconds = blockStartSeconds + static_cast<double>(noteOnSampleOffset) / getSampleRate();
-            pushNoteEventFromAudioThread(eventOn);
-            noteOffNeeded[noteOnToSend] = true; 
-
-            break;
-        }
-        case InstrumentState::NoteHeldNoteOnSent:{
-            // DBG("NoteHeldNoteOnSent"); 
-            break;
-        }
-        case InstrumentState::NoteEndedNowSilentSendNoteOff:{
-            // DBG("NoteEndedNowSilent"); 
-            // if (lastNoteOff == noteOffToSend){
-                // break; 
-            // }
-            if (!noteOffNeeded[noteOffToSend]){// not on - don't need note off
-                break; 
-            }
-            // DBG("OFF " << noteOffToSend << "\n\n");
-
-            midiMessages.addEvent(juce::MidiMessage::noteOff(1, noteOffToSend), noteOffSampleOffset);
-            // tell the piano roll
-            NoteEvent eventOff;
-            eventOff.note = noteOffToSend;
-            eventOff.velocity = 0.0f;
-            eventOff.noteOn = false;
-            eventOff.timeSeconds = blockStartSeconds + static_cast<double>(noteOffSampleOffset) / getSampleRate();
-            pushNoteEventFromAudioThread(eventOff);
-            noteOffNeeded[noteOffToSend] = false; 
-
-            break;
-        }
-    }
-
-    
+    for (const auto& segmented : noteEvents)
+        sendNoteEvent(segmented, 1, blockStartSample, midiMessages);
 
     // // managing the detections
     // if (detections.size() > 0){// we saw a note. 
@@ -565,24 +531,8 @@ void TestPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
 
     // }
 
-    if (!midiMessages.isEmpty())
-    {
-        for (const auto metadata : midiMessages)
-        {
-            const auto& msg = metadata.getMessage();
-            if (msg.isNoteOn())
-            {
-                DBG("MIDI ON " << msg.getNoteNumber() << " vel " << static_cast<int>(msg.getVelocity())
-                               << " ch " << msg.getChannel() << " at " << metadata.samplePosition);
-            }
-            else if (msg.isNoteOff())
-            {
-                DBG("MIDI OFF " << msg.getNoteNumber() << " ch " << msg.getChannel()
-                                << " at " << metadata.samplePosition);
-            }
-        }
-    }
-
+    profiler.lap(StageProfiler::noteState, stageStart);
+    profiler.endCallback(numSamples, callbackStart);
     sampleCounter += numSamples;
 }
 
@@ -614,8 +564,21 @@ void TestPluginAudioProcessor::setStateInformation (const void* data, int sizeIn
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
     auto tree = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
-    if (tree.isValid())
-        parameters.replaceState(tree);
+    if (!tree.isValid())
+        return;
+
+    // The old integer factor was rounded down to a power of two, so keep the factor it ran with.
+    auto legacyCoarse = tree.getChildWithProperty("id", legacyParamCoarseFactor);
+    if (legacyCoarse.isValid())
+    {
+        const int factor = juce::jlimit(1, 8, static_cast<int>(legacyCoarse.getProperty("value")));
+        int index = 0;
+        while ((2 << index) <= factor)
+            ++index;
+        legacyCoarse.setProperty("id", paramCoarseFactor, nullptr);
+        legacyCoarse.setProperty("value", index, nullptr);
+    }
+    parameters.replaceState(tree);
 }
 
 int TestPluginAudioProcessor::pullNoteEvents(NoteEvent* dest, int maxToRead)
@@ -623,6 +586,7 @@ int TestPluginAudioProcessor::pullNoteEvents(NoteEvent* dest, int maxToRead)
     if (dest == nullptr || maxToRead <= 0)
         return 0;
 
+    TraceRecorder::Scope traceScope("noteFifo pull");
     int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
     noteFifo.prepareToRead(maxToRead, start1, size1, start2, size2);
 
@@ -639,6 +603,9 @@ int TestPluginAudioProcessor::pullNoteEvents(NoteEvent* dest, int maxToRead)
     }
 
     noteFifo.finishedRead(copied);
+    for (int i = 0; i < copied; ++i)
+        TraceRecorder::flowEnd("noteFifo", noteEventsPulled++);
+    traceScope.setValue(copied);
     return copied;
 }
 
@@ -647,6 +614,138 @@ float TestPluginAudioProcessor::getRmsLevel() const
     return rmsLevel.load(std::memory_order_relaxed);
 }
 
+float TestPluginAudioProcessor::getPeakLevel() const
+{
+    return peakLevel.load(std::memory_order_relaxed);
+}
+
+void TestPluginAudioProcessor::runAsyncAnalysis(const float* input, int numSamples, int64 blockStartSample)
+{
+    if (analysisWorker.pushSamples(input, numSamples, blockStartSample,
+                                   asyncSettingsPending, asyncResetPending, pitchSettings))
+    {
+        asyncSettingsPending = false;
+        asyncResetPending = false;
+    }
+
+    // A detection at sample p plays at p + latency, so results due after this block stay queued.
+    // One that arrives after its slot has already played is dropped and counted.
+    detections.clear();
+    const int64 blockEndSample = blockStartSample + numSamples;
+    while (detections.size() < detections.capacity())
+    {
+        const auto* result = analysisWorker.peekResult();
+        if (result == nullptr)
+            break;
+
+        // Left over from before async analysis was last switched off.
+        if (result->samplePosition < asyncStartSample)
+        {
+            analysisWorker.popResult();
+            continue;
+        }
+
+        const int64 dueSample = result->samplePosition + asyncLatencySamples;
+        if (dueSample >= blockEndSample)
+            break;
+        if (dueSample < blockStartSample)
+        {
+            analysisWorker.dropResult();
+            continue;
+        }
+
+        auto detection = result->detection;
+        detection.sampleOffset = static_cast<int>(juce::jlimit<int64>(0, numSamples - 1, dueSample - blockStartSample));
+        detections.push_back(detection);
+        TraceRecorder::flowEnd("analysis result", result->samplePosition);
+        analysisWorker.popResult();
+    }
+}
+
+void TestPluginAudioProcessor::processOversizedBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // The incoming MIDI stays where it is, or is dropped without MIDI thru; each slice only adds
+    // its own note events, offset by the slice's start.
+    if (parameters.getRawParameterValue(paramMidiThru)->load() <= 0.5f)
+        midiMessages.clear();
+
+    const int numSamples = buffer.getNumSamples();
+    for (int start = 0; start < numSamples; start += lastBlockSize)
+    {
+        const int count = std::min(lastBlockSize, numSamples - start);
+        juce::AudioBuffer<float> slice(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, count);
+        sliceMidi.clear();
+        processBlock(slice, sliceMidi);
+        midiMessages.addEvents(sliceMidi, 0, count, start);
+    }
+}
+
+void TestPluginAudioProcessor::processVoices(const juce::AudioBuffer<float>& buffer, int numInputChannels, int numSamples, float gain, bool dcBlock,
+                                             const NoteSegmenter::Settings& segmenterSettings, juce::MidiBuffer& midiMessages)
+{
+    auto stageStart = StageProfiler::now();
+    voiceTracker.processBlock(buffer.getArrayOfReadPointers(), numInputChannels, numSamples, gain, dcBlock,
+                              sampleCounter, getBlockSize(), segmenterSettings);
+    stageStart = profiler.lap(StageProfiler::detector, stageStart);
+
+    // Voice n sends on MIDI channel n, the usual one-channel-per-string layout of guitar synths.
+    float loudest = 0.0f;
+    float peak = 0.0f;
+    for (int voice = 0; voice < voiceTracker.getNumVoices(); ++voice)
+    {
+        loudest = std::max(loudest, voiceTracker.getRms(voice));
+        peak = std::max(peak, voiceTracker.getPeak(voice));
+        for (const auto& segmented : voiceTracker.getEvents(voice))
+            sendNoteEvent(segmented, voice + 1, sampleCounter, midiMessages);
+    }
+    rmsLevel.store(loudest, std::memory_order_relaxed);
+    peakLevel.store(peak, std::memory_order_relaxed);
+    profiler.lap(StageProfiler::noteState, stageStart);
+}
+
+void TestPluginAudioProcessor::sendNoteEvent(const NoteSegmenter::Event& segmented, int midiChannel, int64 blockStartSample, juce::MidiBuffer& midiMessages)
+{
+    if (segmented.noteOn)
+        midiMessages.addEvent(juce::MidiMessage::noteOn(midiChannel, segmented.note, static_cast<juce::uint8>(segmented.velocity)), segmented.sampleOffset);
+    else
+        midiMessages.addEvent(juce::MidiMessage::noteOff(midiChannel, segmented.note), segmented.sampleOffset);
+
+    // tell the piano roll
+    NoteEvent event;
+    event.note = segmented.note;
+    event.velocity = static_cast<float>(segmented.velocity) / 127.0f;
+    event.noteOn = segmented.noteOn;
+    event.timeSeconds = static_cast<double>(blockStartSample + segmented.sampleOffset) / getSampleRate();
+    event.channel = midiChannel;
+    pushNoteEventFromAudioThread(event);
+}
+
+void TestPluginAudioProcessor::releaseNotes(const NoteSegmenter::State& state, int midiChannel, juce::MidiBuffer& midiMessages)
+{
+    for (int note = 0; note < static_cast<int>(state.noteOffNeeded.size()); ++note)
+    {
+        if (!state.noteOffNeeded[static_cast<size_t>(note)])
+            continue;
+
+        NoteSegmenter::Event event;
+        event.note = note;
+        sendNoteEvent(event, midiChannel, sampleCounter, midiMessages);
+    }
+}
+
+void TestPluginAudioProcessor::updateReportedLatency()
+{
+    const float latencyMs = parameters.getRawParameterValue(paramAsyncLatency)->load();
+    asyncLatencySamples = static_cast<int>(std::min(latencyMs, maxAsyncLatencyMs) * 0.001f * static_cast<float>(lastSampleRate));
+
+    int latency = pitchDetector.getLatencySamples();
+    if (multiChannelActive)
+        latency = voiceTracker.getLatencySamples();
+    else if (asyncActive)
+        latency = asyncLatencySamples;
+    pendingLatency.store(latency, std::memory_order_relaxed);
+}
+
 void TestPluginAudioProcessor::pushNoteEventFromAudioThread(const NoteEvent& event)
 {
     int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
@@ -655,6 +754,8 @@ void TestPluginAudioProcessor::pushNoteEventFromAudioThread(const NoteEvent& eve
     {
         noteEventBuffer[static_cast<size_t>(start1)] = event;
         noteFifo.finishedWrite(1);
+        TraceRecorder::instant("noteFifo push", event.note);
+        TraceRecorder::flowStart("noteFifo", noteEventsPushed++);
     }
 }
 
@@ -675,10 +776,26 @@ juce::AudioProcessorValueTreeState::ParameterLayout TestPluginAudioProcessor::cr
     params.push_back(std::make_unique<juce::AudioParameterFloat>(paramPeakThresh, "Peak Thresh", juce::NormalisableRange<float>(0.1f, 1.0f, 0.001f), 0.5f));
     params.push_back(std::make_unique<juce::AudioParameterInt>(paramDownSample, "Downsample", 1, 32, 1));
     params.push_back(std::make_unique<juce::AudioParameterBool>(paramClarity, "Clarity", true));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramAntiAlias, "Anti-alias", false));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramAutoDownSample, "Auto Downsample", false));
     params.push_back(std::make_unique<juce::AudioParameterFloat>(paramNoteLengthMs, "Max Note Length (s)", juce::NormalisableRange<float>(3.0f, 10.0f, 0.1f), 5.0f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>(paramDecayTime, "Decay Time (s)", juce::NormalisableRange<float>(0.0f, 0.5f, 0.001f), 0.001f));
     params.push_back(std::make_unique<juce::AudioParameterBool>(paramMidiThru, "MIDI Thru", false));
     params.push_back(std::make_unique<juce::AudioParameterBool>(paramFreeze, "GUI Freeze", false));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramFftCorrelation, "FFT Correlation", false));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramIncremental, "Incremental Lags", false));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramTracking, "Pitch Tracking", false));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(paramTrackingRange, "Track Range (st)", juce::NormalisableRange<float>(0.5f, 12.0f, 0.1f), 2.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(paramTrackingClarity, "Track Clarity", juce::NormalisableRange<float>(0.5f, 1.0f, 0.001f), 0.8f));
+    // The coarse search decimates by powers of two, so only those are offered.
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(paramCoarseFactor, "Coarse Search", juce::StringArray { "1", "2", "4", "8" }, 0));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(paramAnalysisSlices, "Analysis Slices", 1, 16, 1));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramAsyncAnalysis, "Async Analysis", false));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(paramAsyncLatency, "Async Latency (ms)", juce::NormalisableRange<float>(5.0f, maxAsyncLatencyMs, 0.1f), 50.0f));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramMultiChannel, "Multi-channel", false));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(paramDcBlock, "DC Block", false));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(paramEngine, "Engine", juce::StringArray { "Autocorrelation", "YIN" }, 0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(paramYinThreshold, "YIN Thresh", juce::NormalisableRange<float>(0.01f, 0.5f, 0.001f), 0.15f));
 
     return { params.begin(), params.end() };
 }
@@ -13,24 +13,14 @@
 #include <atomic>
 #include <vector>
 
+#include "AnalysisWorker.h"
+#include "InputConditioner.h"
+#include "MultiChannelTracker.h"
+#include "NoteSegmenter.h"
 #include "PitchDetector.h"
+#include "SeqLock.h"
+#include "StageProfiler.h"
 
-// * Long / real silence ( silence > minNoteLen) detected
-// * Short silence / but note still playing (silence < minNoteLen) detected
-// * Started a note after silence
-// * Started a note after another note
-// * Ended a note
-// * Note played for long enough to trigger note on
-enum class InstrumentState{
-  LongSilence, 
-  ShortSilence,
-  NoteAfterSilence,
-  NoteAfterOtherNote, 
-  NoteHeldNotLongEnoughYet,
-  NoteLongEnoughSendNoteOn,
-  NoteHeldNoteOnSent,
-  NoteEndedNowSilentSendNoteOff, 
-};
 //==============================================================================
 /**
 */
@@ -38,6 +28,7 @@ class TestPluginAudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                             , private juce::Timer
 {
 public:
     //==============================================================================
@@ -86,57 +77,75 @@ public:
         float velocity = 0.0f;
         bool noteOn = false;
         double timeSeconds = 0.0;
+        // The MIDI channel the note was sent on: 1, or the voice's channel in multi-channel mode.
+        int channel = 1;
     };
 
     int pullNoteEvents(NoteEvent* dest, int maxToRead);
     float getRmsLevel() const;
+    // Largest sample magnitude of the last block after gain and DC blocking.
+    float getPeakLevel() const;
+    const StageProfiler& getProfiler() const { return profiler; }
 
 private:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
+    void timerCallback() override;
     void pushNoteEventFromAudioThread(const NoteEvent& event);
+    // Runs a block longer than prepareToPlay's in slices of that size, which the input
+    // conditioners are sized for.
+    void processOversizedBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
+    void runAsyncAnalysis(const float* input, int numSamples, int64 blockStartSample);
+    void processVoices(const juce::AudioBuffer<float>& buffer, int numInputChannels, int numSamples, float gain, bool dcBlock,
+                       const NoteSegmenter::Settings& segmenterSettings, juce::MidiBuffer& midiMessages);
+    void sendNoteEvent(const NoteSegmenter::Event& segmented, int midiChannel, int64 blockStartSample, juce::MidiBuffer& midiMessages);
+    // Sends note-offs on midiChannel for every note the segmenter still holds.
+    void releaseNotes(const NoteSegmenter::State& state, int midiChannel, juce::MidiBuffer& midiMessages);
+    void updateReportedLatency();
 
     juce::AudioProcessorValueTreeState parameters;
 
     PitchDetector pitchDetector;
     PitchDetector::Settings pitchSettings;
-    PitchDetector::Settings lastPitchSettings;
-    std::vector<float> monoBuffer;
+    // Message thread: last settings published to the audio thread through settingsSnapshot.
+    PitchDetector::Settings publishedSettings;
+    SeqLock<PitchDetector::Settings> settingsSnapshot;
+    juce::uint32 appliedSettingsVersion = 0;
+    InputConditioner inputConditioner;
     std::vector<PitchDetector::Detection> detections;
+    NoteSegmenter noteSegmenter;
+    std::vector<NoteSegmenter::Event> noteEvents;
+    StageProfiler profiler;
+    AnalysisWorker analysisWorker;
+    bool asyncActive = false;
+    bool asyncSettingsPending = false;
+    bool asyncResetPending = false;
+    int asyncLatencySamples = 0;
+    // First sample analysed since async analysis was last switched on; older results are stale.
+    int64 asyncStartSample = 0;
+    // Between prepareToPlay and releaseResources, when the timer may start the worker threads.
+    std::atomic<bool> resourcesPrepared { false };
+    // One detector and segmenter per input channel, each sending on its own MIDI channel.
+    MultiChannelTracker voiceTracker;
+    bool multiChannelActive = false;
+    // Audio thread: latency for the message thread to report to the host.
+    std::atomic<int> pendingLatency { 0 };
 
     juce::AbstractFifo noteFifo { 1024 };
     std::vector<NoteEvent> noteEventBuffer { 1024 };
+    // Sequence numbers that link each pushed note event to its pull in traces.
+    juce::int64 noteEventsPushed = 0;
+    juce::int64 noteEventsPulled = 0;
 
     std::atomic<float> rmsLevel { 0.0f };
+    std::atomic<float> peakLevel { 0.0f };
     int64 sampleCounter = 0;
     double lastSampleRate = 44100.0;
     int lastBlockSize = 0;
+    // Note events of one slice of an oversized block, before they are moved to its position.
+    juce::MidiBuffer sliceMidi;
     int64 logCounter = 0;
 
-    int currentActiveNote = -1;
-
-    int64 currentActiveNoteStartSample = -1;
-
-
-    int64 lastDetectionSample = -1;
-    int64 silenceForNSamples = -1;
-    
-    
-    bool hasPendingNote = false;
-    int pendingNote = -1;
-    juce::uint8 pendingVelocity = 0;
-    // int64 pendingDetectionSample = -1;
-
-    std::array<bool, 127> noteDetected {};
-    std::array<bool, 127> noteOffNeeded {};
-
-
-    int lastNoteOff = -1;
-    int64 lastNoteOffSeconds = -1;
-    std::array<long, 127> noteOnTimestamps {};
-    std::array<long, 127> noteOffTimestamps {};
-    
-    
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TestPluginAudioProcessor)
 };
@@ -0,0 +1,72 @@
+#include "ProfilerOverlay.h"
+
+ProfilerOverlay::ProfilerOverlay()
+{
+    setInterceptsMouseClicks(false, false);
+}
+
+void ProfilerOverlay::update(const StageProfiler& profiler)
+{
+    if (profiler.getSnapshot(snapshot))
+    {
+        hasSnapshot = true;
+        repaint();
+    }
+}
+
+void ProfilerOverlay::paint(juce::Graphics& g)
+{
+    auto area = getLocalBounds().toFloat();
+    g.setColour(juce::Colour(0xD0151C22));
+    g.fillRoundedRectangle(area, 4.0f);
+
+    auto text = getLocalBounds().reduced(8, 6);
+    g.setFont(juce::FontOptions(12.0f));
+
+    if (!hasSnapshot)
+    {
+        g.setColour(juce::Colour(0xFFB7C6D9));
+        g.drawText("Waiting for audio...", text, juce::Justification::topLeft);
+        return;
+    }
+
+    // Over half the deadline leaves little room for the host and other plugins.
+    const auto deadlineColour = snapshot.deadlineMaxPercent >= 100.0f ? juce::Colour(0xFFE86A5E)
+                              : snapshot.deadlineP99Percent >= 50.0f ? juce::Colour(0xFFE8C35E)
+                                                                      : juce::Colour(0xFF8BD3A0);
+    g.setColour(deadlineColour);
+    g.drawText("Deadline " + juce::String(snapshot.deadlineMeanPercent, 1) + "% mean, "
+                   + juce::String(snapshot.deadlineP99Percent, 1) + "% p99, "
+                   + juce::String(snapshot.deadlineMaxPercent, 1) + "% max, "
+                   + juce::String(snapshot.overruns) + " over",
+               text.removeFromTop(16), juce::Justification::centredLeft);
+
+    constexpr int rowHeight = 15;
+    const int columnWidth = (text.getWidth() - 90) / 3;
+    auto drawRow = [&](const juce::String& name, const juce::String& mean, const juce::String& p99, const juce::String& max)
+    {
+        auto row = text.removeFromTop(rowHeight);
+        g.drawText(name, row.removeFromLeft(90), juce::Justification::centredLeft);
+        g.drawText(mean, row.removeFromLeft(columnWidth), juce::Justification::centredRight);
+        g.drawText(p99, row.removeFromLeft(columnWidth), juce::Justification::centredRight);
+        g.drawText(max, row, juce::Justification::centredRight);
+    };
+
+    g.setColour(juce::Colour(0xFF7F93A8));
+    drawRow("us", "mean", "p99", "max");
+
+    g.setColour(juce::Colour(0xFFE6F1FF));
+    for (int i = 0; i < StageProfiler::numStages; ++i)
+    {
+        const auto stage = static_cast<StageProfiler::Stage>(i);
+        const auto& summary = snapshot.stages[static_cast<size_t>(i)];
+        // Search, refine and median are parts of the detector stage.
+        const bool detectorPart = stage == StageProfiler::search || stage == StageProfiler::refine || stage == StageProfiler::median;
+        const juce::String name = juce::String(detectorPart ? "  " : "") + StageProfiler::getStageName(stage);
+        if (summary.count == 0)
+            drawRow(name, "-", "-", "-");
+        else
+            drawRow(name, juce::String(summary.meanMicros, 1),
+                    juce::String(summary.p99Micros, 1), juce::String(summary.maxMicros, 1));
+    }
+}
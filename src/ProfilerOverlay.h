@@ -0,0 +1,23 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "StageProfiler.h"
+
+// Translucent table of the latest StageProfiler window, drawn over the piano roll.
+class ProfilerOverlay : public juce::Component
+{
+public:
+    ProfilerOverlay();
+
+    // Message thread. Repaints only when a new snapshot was available.
+    void update(const StageProfiler& profiler);
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    StageProfiler::Snapshot snapshot;
+    bool hasSnapshot = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProfilerOverlay)
+};
@@ -0,0 +1,270 @@
+#include "RealtimeAudit.h"
+
+#if MYK_RT_AUDIT
+
+#if ! (JUCE_LINUX || JUCE_MAC || JUCE_BSD)
+ #error "MYK_RT_AUDIT relies on symbol interposition and is only supported on Linux and macOS"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <new>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+// The overrides must stay visible to the dynamic linker so that calls made from shared libraries,
+// such as libstdc++ allocating inside a std::string, land here too.
+#define MYK_RT_HOOK __attribute__((visibility("default")))
+
+namespace
+{
+    constexpr int kMaxStoredViolations = 256;
+
+    std::array<RealtimeAudit::Violation, kMaxStoredViolations> violations;
+    std::atomic<int> numViolations { 0 };
+    std::atomic<bool> trapOnViolation { false };
+
+    thread_local int scopeDepth = 0;
+    thread_local const char* scopeLabel = nullptr;
+    // Set while a hook records a violation, so anything it calls is not audited again.
+    thread_local bool insideHook = false;
+
+    void record(RealtimeAudit::Kind kind, const char* function, std::size_t bytes)
+    {
+        if (scopeDepth == 0 || insideHook)
+            return;
+
+        insideHook = true;
+        const int index = numViolations.fetch_add(1, std::memory_order_relaxed);
+        if (index < kMaxStoredViolations)
+        {
+            auto& violation = violations[static_cast<size_t>(index)];
+            violation.kind = kind;
+            violation.scope = scopeLabel;
+            violation.function = function;
+            violation.bytes = bytes;
+            violation.numFrames = backtrace(violation.frames, RealtimeAudit::kMaxFrames);
+        }
+
+        if (trapOnViolation.load(std::memory_order_relaxed))
+            __builtin_trap();
+        insideHook = false;
+    }
+
+    // Resolves the next definition of an interposed function without a function-local static,
+    // whose guard could itself take a lock.
+    template <typename Function>
+    Function nextSymbol(std::atomic<Function>& cache, const char* name)
+    {
+        auto function = cache.load(std::memory_order_acquire);
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+            cache.store(function, std::memory_order_release);
+        }
+        return function;
+    }
+
+    void* allocate(std::size_t size)
+    {
+        record(RealtimeAudit::Kind::allocation, "operator new", size);
+        if (void* pointer = std::malloc(size == 0 ? 1 : size))
+            return pointer;
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        record(RealtimeAudit::Kind::allocation, "operator new", size);
+        void* pointer = nullptr;
+        const auto align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+        if (posix_memalign(&pointer, align, size == 0 ? 1 : size) != 0)
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+    void release(void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            record(RealtimeAudit::Kind::deallocation, "operator delete", 0);
+        std::free(pointer);
+    }
+
+    struct BacktraceWarmup
+    {
+        // The first backtrace() call may load the unwinder, which allocates and locks.
+        BacktraceWarmup()
+        {
+            void* frames[2];
+            backtrace(frames, 2);
+            if (std::getenv("MYK_RT_AUDIT_TRAP") != nullptr)
+                trapOnViolation.store(true);
+        }
+    };
+    const BacktraceWarmup backtraceWarmup;
+
+    const char* getKindName(RealtimeAudit::Kind kind)
+    {
+        switch (kind)
+        {
+            case RealtimeAudit::Kind::allocation: return "allocation";
+            case RealtimeAudit::Kind::deallocation: return "deallocation";
+            case RealtimeAudit::Kind::mutexLock: return "mutex lock";
+            case RealtimeAudit::Kind::systemCall: return "system call";
+        }
+        return "unknown";
+    }
+
+    juce::String describeFrame(void* address)
+    {
+        Dl_info info {};
+        if (dladdr(address, &info) == 0 || info.dli_sname == nullptr)
+            return juce::String::toHexString(reinterpret_cast<juce::pointer_sized_int>(address));
+
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        juce::String name(status == 0 && demangled != nullptr ? demangled : info.dli_sname);
+        std::free(demangled);
+        const auto offset = static_cast<const char*>(address) - static_cast<const char*>(info.dli_saddr);
+        return name + " + " + juce::String(static_cast<juce::int64>(offset));
+    }
+}
+
+namespace RealtimeAudit
+{
+    ScopedRealtime::ScopedRealtime(const char* label) noexcept
+        : previousLabel(scopeLabel)
+    {
+        scopeLabel = label;
+        scopeDepth++;
+    }
+
+    ScopedRealtime::~ScopedRealtime() noexcept
+    {
+        scopeDepth--;
+        scopeLabel = previousLabel;
+    }
+
+    void setTrapOnViolation(bool shouldTrap)
+    {
+        trapOnViolation.store(shouldTrap);
+    }
+
+    int getNumViolations()
+    {
+        return numViolations.load();
+    }
+
+    juce::String createReport()
+    {
+        const int total = numViolations.load();
+        juce::String report;
+        report << total << " real-time violation" << (total == 1 ? "" : "s") << "\n";
+
+        const int stored = std::min(total, kMaxStoredViolations);
+        for (int i = 0; i < stored; ++i)
+        {
+            const auto& violation = violations[static_cast<size_t>(i)];
+            report << "#" << i << " " << getKindName(violation.kind) << " (" << violation.function;
+            if (violation.bytes > 0)
+                report << ", " << static_cast<juce::int64>(violation.bytes) << " bytes";
+            report << ") in " << (violation.scope != nullptr ? violation.scope : "?") << "\n";
+
+            // Frame 0 is record() itself.
+            for (int frame = 1; frame < violation.numFrames; ++frame)
+                report << "    " << describeFrame(violation.frames[frame]) << "\n";
+        }
+
+        if (total > stored)
+            report << (total - stored) << " more not stored\n";
+        return report;
+    }
+
+    void reset()
+    {
+        numViolations.store(0);
+    }
+}
+
+MYK_RT_HOOK void* operator new(std::size_t size) { return allocate(size); }
+MYK_RT_HOOK void* operator new[](std::size_t size) { return allocate(size); }
+MYK_RT_HOOK void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+MYK_RT_HOOK void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+MYK_RT_HOOK void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); }
+    catch (...) { return nullptr; }
+}
+
+MYK_RT_HOOK void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); }
+    catch (...) { return nullptr; }
+}
+
+MYK_RT_HOOK void operator delete(void* pointer) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete[](void* pointer) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete(void* pointer, std::size_t) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete[](void* pointer, std::size_t) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete(void* pointer, std::align_val_t) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete[](void* pointer, std::align_val_t) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete(void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+MYK_RT_HOOK void operator delete[](void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+
+// Interposed locking and blocking calls. Each records a violation when called inside an audited
+// scope and then forwards to the next definition, normally libc's.
+extern "C"
+{
+    MYK_RT_HOOK int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        static std::atomic<int (*)(pthread_mutex_t*)> next { nullptr };
+        record(RealtimeAudit::Kind::mutexLock, "pthread_mutex_lock", 0);
+        return nextSymbol(next, "pthread_mutex_lock")(mutex);
+    }
+
+    MYK_RT_HOOK int pthread_cond_wait(pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        static std::atomic<int (*)(pthread_cond_t*, pthread_mutex_t*)> next { nullptr };
+        record(RealtimeAudit::Kind::mutexLock, "pthread_cond_wait", 0);
+        return nextSymbol(next, "pthread_cond_wait")(condition, mutex);
+    }
+
+    MYK_RT_HOOK ssize_t write(int fd, const void* data, size_t size)
+    {
+        static std::atomic<ssize_t (*)(int, const void*, size_t)> next { nullptr };
+        record(RealtimeAudit::Kind::systemCall, "write", 0);
+        return nextSymbol(next, "write")(fd, data, size);
+    }
+
+    MYK_RT_HOOK ssize_t read(int fd, void* data, size_t size)
+    {
+        static std::atomic<ssize_t (*)(int, void*, size_t)> next { nullptr };
+        record(RealtimeAudit::Kind::systemCall, "read", 0);
+        return nextSymbol(next, "read")(fd, data, size);
+    }
+
+    MYK_RT_HOOK int nanosleep(const struct timespec* duration, struct timespec* remaining)
+    {
+        static std::atomic<int (*)(const struct timespec*, struct timespec*)> next { nullptr };
+        record(RealtimeAudit::Kind::systemCall, "nanosleep", 0);
+        return nextSymbol(next, "nanosleep")(duration, remaining);
+    }
+
+    MYK_RT_HOOK int usleep(useconds_t microseconds)
+    {
+        static std::atomic<int (*)(useconds_t)> next { nullptr };
+        record(RealtimeAudit::Kind::systemCall, "usleep", 0);
+        return nextSymbol(next, "usleep")(microseconds);
+    }
+}
+
+#endif
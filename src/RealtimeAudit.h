@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstddef>
+
+// Real-time safety audit, compiled in with MYK_RT_AUDIT=1 (CMake option MYK_RT_AUDIT).
+//
+// MYK_RT_SCOPE marks a scope that must not allocate, free, lock a mutex or make a blocking
+// system call. While such a scope is active on a thread, the global operator new/delete overrides
+// and the interposed pthread/libc functions in RealtimeAudit.cpp record a violation with the
+// scope label, the intercepted call and a short backtrace. Set MYK_RT_AUDIT_TRAP=1 in the
+// environment, or call setTrapOnViolation(true), to stop in the debugger at the offending call.
+// Without MYK_RT_AUDIT the macro expands to nothing.
+#if MYK_RT_AUDIT
+
+namespace RealtimeAudit
+{
+    enum class Kind
+    {
+        allocation,
+        deallocation,
+        mutexLock,
+        systemCall
+    };
+
+    static constexpr int kMaxFrames = 12;
+
+    struct Violation
+    {
+        Kind kind = Kind::allocation;
+        const char* scope = nullptr;
+        const char* function = nullptr;
+        std::size_t bytes = 0;
+        int numFrames = 0;
+        void* frames[kMaxFrames] {};
+    };
+
+    class ScopedRealtime
+    {
+    public:
+        explicit ScopedRealtime(const char* label) noexcept;
+        ~ScopedRealtime() noexcept;
+
+    private:
+        const char* previousLabel = nullptr;
+    };
+
+    void setTrapOnViolation(bool shouldTrap);
+    // Total violations since the last reset, including any beyond the stored report capacity.
+    int getNumViolations();
+    // Symbolised listing of the stored violations. Allocates, so call it outside audited scopes.
+    juce::String createReport();
+    void reset();
+}
+
+ #define MYK_RT_SCOPE(label) const RealtimeAudit::ScopedRealtime mykRealtimeScope (label)
+#else
+ #define MYK_RT_SCOPE(label)
+#endif
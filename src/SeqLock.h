@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer sequence lock for publishing a small trivially copyable snapshot. The writer never
+// blocks; a reader gets a consistent copy or, if a write overlapped it, false, so a real-time
+// reader can simply try again on its next callback instead of spinning.
+template <typename T>
+class SeqLock
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+    // Writer thread only.
+    void store(const T& value)
+    {
+        std::array<juce::uint64, kNumWords> words {};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const auto start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kNumWords; ++i)
+            data[i].store(words[i], std::memory_order_relaxed);
+        sequence.store(start + 2, std::memory_order_release);
+    }
+
+    // Version of the latest completed store; 0 until the first one.
+    juce::uint32 getVersion() const
+    {
+        return sequence.load(std::memory_order_acquire) >> 1;
+    }
+
+    bool tryLoad(T& value, juce::uint32& version) const
+    {
+        const auto start = sequence.load(std::memory_order_acquire);
+        if ((start & 1) != 0)
+            return false;
+
+        std::array<juce::uint64, kNumWords> words {};
+        for (size_t i = 0; i < kNumWords; ++i)
+            words[i] = data[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != start)
+            return false;
+
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        version = start >> 1;
+        return true;
+    }
+
+private:
+    static constexpr size_t kNumWords = (sizeof(T) + sizeof(juce::uint64) - 1) / sizeof(juce::uint64);
+
+    std::atomic<juce::uint32> sequence { 0 };
+    std::array<std::atomic<juce::uint64>, kNumWords> data {};
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+
+// Wait-free single-producer single-consumer queue of preallocated slots, built on
+// juce::AbstractFifo like the note event FIFO. Items are written and read in place, so pushing a
+// large frame costs one copy into its slot and no allocation. resize() allocates and must only be
+// called while neither side is using the queue.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(int capacity = 1)
+    {
+        resize(capacity);
+    }
+
+    void resize(int capacity)
+    {
+        // AbstractFifo keeps one slot free to tell full from empty.
+        slots.assign(static_cast<size_t>(std::max(1, capacity) + 1), T {});
+        fifo.setTotalSize(static_cast<int>(slots.size()));
+    }
+
+    void reset()
+    {
+        fifo.reset();
+    }
+
+    // Lets the owner preallocate inside every slot, e.g. reserve a vector member, so that filling a
+    // slot later does not allocate. Same restriction as resize().
+    template <typename Function>
+    void forEachSlot(Function&& function)
+    {
+        for (auto& slot : slots)
+            function(slot);
+    }
+
+    int getCapacity() const { return fifo.getTotalSize() - 1; }
+    int getNumReady() const { return fifo.getNumReady(); }
+
+    // Producer: returns the next free slot, or nullptr when full. Call commitWrite() once it is filled.
+    T* acquireWrite()
+    {
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        return size1 > 0 ? &slots[static_cast<size_t>(start1)] : nullptr;
+    }
+
+    void commitWrite()
+    {
+        fifo.finishedWrite(1);
+    }
+
+    bool push(const T& item)
+    {
+        if (auto* slot = acquireWrite())
+        {
+            *slot = item;
+            commitWrite();
+            return true;
+        }
+        return false;
+    }
+
+    // Consumer: returns the oldest item without removing it, or nullptr when empty.
+    const T* peek() const
+    {
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        return size1 > 0 ? &slots[static_cast<size_t>(start1)] : nullptr;
+    }
+
+    void commitRead()
+    {
+        fifo.finishedRead(1);
+    }
+
+    bool pop(T& item)
+    {
+        if (const auto* slot = peek())
+        {
+            item = *slot;
+            commitRead();
+            return true;
+        }
+        return false;
+    }
+
+private:
+    juce::AbstractFifo fifo { 2 };
+    std::vector<T> slots;
+};
@@ -0,0 +1,178 @@
+#include "StageProfiler.h"
+
+#include <algorithm>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+const char* StageProfiler::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+        case downmix: return "Downmix";
+        case detector: return "Detector";
+        case search: return "Search";
+        case refine: return "Refine";
+        case median: return "Median";
+        case noteState: return "Note state";
+        case callback: return "Callback";
+        case numStages: break;
+    }
+    return "";
+}
+
+juce::uint64 StageProfiler::now() noexcept
+{
+   #if JUCE_INTEL
+    return static_cast<juce::uint64>(__rdtsc());
+   #else
+    return static_cast<juce::uint64>(juce::Time::getHighResolutionTicks());
+   #endif
+}
+
+void StageProfiler::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    windowLength = static_cast<juce::int64>(sampleRate * kWindowSeconds);
+
+   #if JUCE_INTEL
+    // The timestamp counter runs at a fixed rate on anything recent, but that rate is not exposed.
+    const auto clockStart = juce::Time::getHighResolutionTicks();
+    const auto counterStart = now();
+    const auto clockTicks = juce::Time::getHighResolutionTicksPerSecond() / 500;
+    while (juce::Time::getHighResolutionTicks() - clockStart < clockTicks)
+    {
+    }
+    const auto elapsedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - clockStart);
+    ticksPerSecond = static_cast<double>(now() - counterStart) / elapsedSeconds;
+   #else
+    ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+   #endif
+
+    for (auto& histogram : histograms)
+        histogram.clear();
+    deadline.clear();
+    overruns = 0;
+    windowSamples = 0;
+}
+
+juce::uint64 StageProfiler::lap(Stage stage, juce::uint64 since) noexcept
+{
+    const auto time = now();
+    histograms[static_cast<size_t>(stage)].add(time - since);
+    return time;
+}
+
+void StageProfiler::endCallback(int numSamples, juce::uint64 callbackStart) noexcept
+{
+    const auto elapsed = now() - callbackStart;
+    histograms[static_cast<size_t>(callback)].add(elapsed);
+
+    const double budgetTicks = static_cast<double>(numSamples) / sampleRate * ticksPerSecond;
+    const auto share = static_cast<juce::uint64>(10000.0 * static_cast<double>(elapsed) / budgetTicks);
+    deadline.add(share);
+    if (share >= 10000)
+        overruns++;
+
+    windowSamples += numSamples;
+    if (windowSamples >= windowLength)
+        publish();
+}
+
+bool StageProfiler::getSnapshot(Snapshot& snapshot) const
+{
+    juce::uint32 version = 0;
+    return published.tryLoad(snapshot, version) && version > 0;
+}
+
+void StageProfiler::publish()
+{
+    Snapshot snapshot;
+    const double microsPerTick = 1.0e6 / ticksPerSecond;
+    for (size_t i = 0; i < histograms.size(); ++i)
+    {
+        const auto& histogram = histograms[i];
+        auto& summary = snapshot.stages[i];
+        summary.count = static_cast<juce::int64>(histogram.count);
+        if (histogram.count == 0)
+            continue;
+
+        summary.meanMicros = static_cast<float>(static_cast<double>(histogram.total) / static_cast<double>(histogram.count) * microsPerTick);
+        summary.p99Micros = static_cast<float>(static_cast<double>(histogram.getPercentile(0.99)) * microsPerTick);
+        summary.maxMicros = static_cast<float>(static_cast<double>(histogram.max) * microsPerTick);
+    }
+
+    if (deadline.count > 0)
+    {
+        snapshot.deadlineMeanPercent = static_cast<float>(0.01 * static_cast<double>(deadline.total) / static_cast<double>(deadline.count));
+        snapshot.deadlineP99Percent = static_cast<float>(0.01 * static_cast<double>(deadline.getPercentile(0.99)));
+        snapshot.deadlineMaxPercent = static_cast<float>(0.01 * static_cast<double>(deadline.max));
+    }
+    snapshot.overruns = overruns;
+    snapshot.windowSeconds = static_cast<float>(static_cast<double>(windowSamples) / sampleRate);
+    published.store(snapshot);
+
+    for (auto& histogram : histograms)
+        histogram.clear();
+    deadline.clear();
+    overruns = 0;
+    windowSamples = 0;
+}
+
+// Four buckets per octave: the position of the top bit plus the two bits below it.
+int StageProfiler::getBucket(juce::uint64 value) noexcept
+{
+    if (value < 8)
+        return static_cast<int>(value);
+
+    int topBit = 3;
+    while ((value >> (topBit + 1)) != 0)
+        ++topBit;
+    const auto bucket = topBit * 4 + static_cast<int>((value >> (topBit - 2)) & 3);
+    return std::min(bucket, kNumBuckets - 1);
+}
+
+juce::uint64 StageProfiler::getBucketUpperBound(int bucket) noexcept
+{
+    if (bucket < 12)
+        return static_cast<juce::uint64>(bucket + 1);
+
+    const int topBit = bucket / 4;
+    const auto mantissa = static_cast<juce::uint64>(4 + bucket % 4 + 1);
+    return mantissa << (topBit - 2);
+}
+
+void StageProfiler::Histogram::add(juce::uint64 value) noexcept
+{
+    buckets[static_cast<size_t>(getBucket(value))]++;
+    total += value;
+    max = std::max(max, value);
+    count++;
+}
+
+juce::uint64 StageProfiler::Histogram::getPercentile(double fraction) const noexcept
+{
+    // Reports the top of the bucket holding the percentile, capped at the largest value seen.
+    const auto target = static_cast<juce::uint64>(fraction * static_cast<double>(count));
+    juce::uint64 seen = 0;
+    for (int bucket = 0; bucket < kNumBuckets; ++bucket)
+    {
+        seen += buckets[static_cast<size_t>(bucket)];
+        if (seen > target)
+            return std::min(getBucketUpperBound(bucket), max);
+    }
+    return max;
+}
+
+void StageProfiler::Histogram::clear() noexcept
+{
+    buckets.fill(0);
+    total = 0;
+    max = 0;
+    count = 0;
+}
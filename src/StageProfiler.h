@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+#include "SeqLock.h"
+
+// Per-stage timing of the audio callback. The audio thread records raw counter ticks (the CPU
+// timestamp counter on x86, the high resolution clock elsewhere) into log-spaced histograms
+// without allocating or locking, and once per window publishes a summary through a SeqLock that
+// the editor polls. All recording methods are audio thread only.
+class StageProfiler
+{
+public:
+    enum Stage
+    {
+        downmix,
+        detector,
+        search,
+        refine,
+        median,
+        noteState,
+        callback,
+        numStages
+    };
+
+    struct StageSummary
+    {
+        juce::int64 count = 0;
+        float meanMicros = 0.0f;
+        float p99Micros = 0.0f;
+        float maxMicros = 0.0f;
+    };
+
+    struct Snapshot
+    {
+        std::array<StageSummary, numStages> stages {};
+        // Callback time as a percentage of the block's duration.
+        float deadlineMeanPercent = 0.0f;
+        float deadlineP99Percent = 0.0f;
+        float deadlineMaxPercent = 0.0f;
+        juce::int64 overruns = 0;
+        float windowSeconds = 0.0f;
+    };
+
+    static const char* getStageName(Stage stage);
+
+    static juce::uint64 now() noexcept;
+
+    // Calibrates the counter against the system clock, so it blocks for a couple of milliseconds.
+    void prepare(double sampleRate);
+
+    // Records the time since `since` against the stage and returns the current count, so
+    // consecutive stages can be chained without reading the counter twice.
+    juce::uint64 lap(Stage stage, juce::uint64 since) noexcept;
+    // Records the whole callback and its share of the deadline, and publishes at the end of a window.
+    void endCallback(int numSamples, juce::uint64 callbackStart) noexcept;
+
+    // Any thread. False until the first window completes or while a publish overlaps the read.
+    bool getSnapshot(Snapshot& snapshot) const;
+
+private:
+    static constexpr int kNumBuckets = 128;
+    static constexpr double kWindowSeconds = 1.0;
+
+    struct Histogram
+    {
+        std::array<juce::uint32, kNumBuckets> buckets {};
+        juce::uint64 total = 0;
+        juce::uint64 max = 0;
+        juce::uint64 count = 0;
+
+        void add(juce::uint64 value) noexcept;
+        juce::uint64 getPercentile(double fraction) const noexcept;
+        void clear() noexcept;
+    };
+
+    static int getBucket(juce::uint64 value) noexcept;
+    static juce::uint64 getBucketUpperBound(int bucket) noexcept;
+
+    void publish();
+
+    std::array<Histogram, numStages> histograms;
+    // Callback time in hundredths of a percent of the block duration.
+    Histogram deadline;
+    juce::int64 overruns = 0;
+    juce::int64 windowSamples = 0;
+    juce::int64 windowLength = 48000;
+    double sampleRate = 48000.0;
+    double ticksPerSecond = 1.0e9;
+
+    SeqLock<Snapshot> published;
+};
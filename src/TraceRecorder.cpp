@@ -0,0 +1,264 @@
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr int kMaxThreads = 16;
+    constexpr juce::int64 kEventsPerThread = 1 << 14;
+
+    enum class Phase : char
+    {
+        complete,
+        instant,
+        flowStart,
+        flowEnd
+    };
+
+    struct Event
+    {
+        const char* name;
+        juce::int64 startTicks;
+        juce::int64 durationTicks;
+        juce::int64 value;
+        Phase phase;
+    };
+
+    struct ThreadBuffer
+    {
+        std::unique_ptr<Event[]> events;
+        std::atomic<bool> claimed { false };
+        std::atomic<const char*> name { nullptr };
+        // Written by the owning thread only. A generation behind the recorder's means the buffer
+        // still holds a previous recording, which the owner discards on its next event.
+        std::atomic<juce::uint32> generation { 0 };
+        std::atomic<juce::int64> count { 0 };
+    };
+
+    std::array<ThreadBuffer, kMaxThreads> buffers;
+    std::atomic<bool> recording { false };
+    std::atomic<juce::uint32> currentGeneration { 0 };
+    std::atomic<int> untracedThreads { 0 };
+    juce::int64 recordingStartTicks = 0;
+
+    // Hands the calling thread's buffer back when the thread exits, so short-lived threads such
+    // as pool workers do not use up the slots. The events it recorded stay in the trace until
+    // another thread claims the buffer.
+    struct ThreadSlot
+    {
+        ~ThreadSlot()
+        {
+            if (buffer != nullptr)
+                buffer->claimed.store(false, std::memory_order_release);
+        }
+
+        ThreadBuffer* buffer = nullptr;
+        // Generation in which this thread last found every buffer taken; it retries next recording.
+        juce::uint32 missedGeneration = 0;
+    };
+
+    thread_local ThreadSlot threadSlot;
+    thread_local const char* threadName = nullptr;
+
+    bool tryClaim(ThreadBuffer& buffer, juce::uint32 generation)
+    {
+        bool expected = false;
+        if (!buffer.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            return false;
+
+        buffer.name.store(threadName);
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.generation.store(generation, std::memory_order_release);
+        threadSlot.buffer = &buffer;
+        return true;
+    }
+
+    ThreadBuffer* getThreadBuffer(juce::uint32 generation)
+    {
+        if (threadSlot.buffer != nullptr || threadSlot.missedGeneration == generation)
+            return threadSlot.buffer;
+
+        // Buffers left by exited threads of this recording are only reused once nothing else is free.
+        for (auto& buffer : buffers)
+            if (buffer.generation.load(std::memory_order_acquire) != generation && tryClaim(buffer, generation))
+                return threadSlot.buffer;
+
+        for (auto& buffer : buffers)
+            if (tryClaim(buffer, generation))
+                return threadSlot.buffer;
+
+        // Every buffer belongs to another thread; this one is left out of the recording.
+        threadSlot.missedGeneration = generation;
+        untracedThreads.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    void record(Phase phase, const char* name, juce::int64 start, juce::int64 duration, juce::int64 value)
+    {
+        if (!recording.load(std::memory_order_acquire))
+            return;
+
+        const auto generation = currentGeneration.load(std::memory_order_acquire);
+        auto* buffer = getThreadBuffer(generation);
+        if (buffer == nullptr)
+            return;
+
+        if (buffer->generation.load(std::memory_order_relaxed) != generation)
+        {
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->generation.store(generation, std::memory_order_release);
+        }
+
+        const auto index = buffer->count.load(std::memory_order_relaxed);
+        buffer->events[static_cast<size_t>(index & (kEventsPerThread - 1))] = { name, start, duration, value, phase };
+        buffer->count.store(index + 1, std::memory_order_release);
+    }
+
+    juce::String toMicros(juce::int64 ticks)
+    {
+        return juce::String(juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6, 3);
+    }
+}
+
+namespace TraceRecorder
+{
+    void start()
+    {
+        stop();
+        for (auto& buffer : buffers)
+            if (buffer.events == nullptr)
+                buffer.events = std::make_unique<Event[]>(static_cast<size_t>(kEventsPerThread));
+
+        recordingStartTicks = juce::Time::getHighResolutionTicks();
+        untracedThreads.store(0, std::memory_order_relaxed);
+        currentGeneration.fetch_add(1, std::memory_order_release);
+        recording.store(true, std::memory_order_release);
+    }
+
+    void stop()
+    {
+        recording.store(false, std::memory_order_release);
+    }
+
+    bool isRecording()
+    {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    int getUntracedThreadCount()
+    {
+        return untracedThreads.load(std::memory_order_relaxed);
+    }
+
+    bool writeChromeTrace(const juce::File& file)
+    {
+        juce::FileOutputStream stream(file);
+        if (!stream.openedOk())
+            return false;
+
+        stream.setPosition(0);
+        stream.truncate();
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        const auto generation = currentGeneration.load(std::memory_order_acquire);
+        bool first = true;
+        auto beginEvent = [&]
+        {
+            if (!first)
+                stream << ",\n";
+            first = false;
+        };
+
+        for (int tid = 0; tid < kMaxThreads; ++tid)
+        {
+            auto& buffer = buffers[static_cast<size_t>(tid)];
+            if (buffer.events == nullptr || buffer.generation.load(std::memory_order_acquire) != generation)
+                continue;
+
+            const auto* name = buffer.name.load();
+            beginEvent();
+            stream << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid
+                   << ",\"args\":{\"name\":\"" << (name != nullptr ? juce::String(name) : "Thread " + juce::String(tid)) << "\"}}";
+
+            // Only events that cannot have been overwritten while they were read are kept.
+            const auto end = buffer.count.load(std::memory_order_acquire);
+            const auto begin = std::max<juce::int64>(0, end - kEventsPerThread);
+            std::vector<Event> events;
+            events.reserve(static_cast<size_t>(end - begin));
+            for (auto i = begin; i < end; ++i)
+                events.push_back(buffer.events[static_cast<size_t>(i & (kEventsPerThread - 1))]);
+            const auto firstIntact = buffer.count.load(std::memory_order_acquire) - kEventsPerThread + 1;
+
+            for (auto i = begin; i < end; ++i)
+            {
+                if (i < firstIntact)
+                    continue;
+
+                const auto& event = events[static_cast<size_t>(i - begin)];
+                beginEvent();
+                stream << "{\"name\":\"" << event.name << "\",\"pid\":1,\"tid\":" << tid
+                       << ",\"ts\":" << toMicros(event.startTicks - recordingStartTicks);
+                switch (event.phase)
+                {
+                    case Phase::complete:
+                        stream << ",\"ph\":\"X\",\"dur\":" << toMicros(event.durationTicks)
+                               << ",\"args\":{\"value\":" << event.value << "}}";
+                        break;
+                    case Phase::instant:
+                        stream << ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"value\":" << event.value << "}}";
+                        break;
+                    case Phase::flowStart:
+                        stream << ",\"ph\":\"s\",\"cat\":\"" << event.name << "\",\"id\":" << event.value << "}";
+                        break;
+                    case Phase::flowEnd:
+                        stream << ",\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"" << event.name << "\",\"id\":" << event.value << "}";
+                        break;
+                }
+            }
+        }
+
+        stream << "\n]}\n";
+        stream.flush();
+        return stream.getStatus().wasOk();
+    }
+
+    void setThreadName(const char* name)
+    {
+        threadName = name;
+        if (threadSlot.buffer != nullptr)
+            threadSlot.buffer->name.store(name, std::memory_order_relaxed);
+    }
+
+    void instant(const char* name, juce::int64 value)
+    {
+        record(Phase::instant, name, juce::Time::getHighResolutionTicks(), 0, value);
+    }
+
+    void flowStart(const char* name, juce::int64 id)
+    {
+        record(Phase::flowStart, name, juce::Time::getHighResolutionTicks(), 0, id);
+    }
+
+    void flowEnd(const char* name, juce::int64 id)
+    {
+        record(Phase::flowEnd, name, juce::Time::getHighResolutionTicks(), 0, id);
+    }
+
+    Scope::Scope(const char* scopeName, juce::int64 scopeValue) noexcept
+        : name(scopeName),
+          value(scopeValue),
+          startTicks(recording.load(std::memory_order_relaxed) ? juce::Time::getHighResolutionTicks() : -1)
+    {
+    }
+
+    Scope::~Scope() noexcept
+    {
+        // Scopes that began before recording started are left out rather than clipped.
+        if (startTicks >= 0)
+            record(Phase::complete, name, startTicks, juce::Time::getHighResolutionTicks() - startTicks, value);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Timeline tracing across the audio, analysis, OpenGL and message threads, written out as a
+// Chrome trace (chrome://tracing or ui.perfetto.dev).
+//
+// Each thread writes into its own fixed ring of events, claimed on its first event and released
+// when the thread exits, so recording never allocates or locks and only the newest events per
+// thread are kept. When not recording,
+// every call is a single relaxed atomic load. Event names must be string literals.
+namespace TraceRecorder
+{
+    // Message thread. The first start() allocates the buffers; later ones only clear them.
+    void start();
+    void stop();
+    bool isRecording();
+    // Threads left out of the current recording because every buffer was taken.
+    int getUntracedThreadCount();
+    // Writes everything recorded since the last start(). Call after stop() for a complete trace.
+    bool writeChromeTrace(const juce::File& file);
+
+    // Label for the calling thread in the trace. Cheap enough to call on every callback.
+    void setThreadName(const char* name);
+
+    void instant(const char* name, juce::int64 value = 0);
+    // Arrows between events on different threads that share a name and id, such as an item
+    // pushed into a FIFO and the same item pulled out of it.
+    void flowStart(const char* name, juce::int64 id);
+    void flowEnd(const char* name, juce::int64 id);
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name, juce::int64 value = 0) noexcept;
+        ~Scope() noexcept;
+
+        void setValue(juce::int64 newValue) noexcept { value = newValue; }
+
+    private:
+        const char* name;
+        juce::int64 value;
+        juce::int64 startTicks;
+    };
+}
+
+#define MYK_TRACE_SCOPE(name) const TraceRecorder::Scope JUCE_JOIN_MACRO (mykTraceScope, __LINE__) (name)
@@ -0,0 +1,99 @@
+#include "WakeSemaphore.h"
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <cerrno>
+ #include <ctime>
+ #include <semaphore.h>
+#endif
+
+#if JUCE_MAC || JUCE_IOS
+
+struct WakeSemaphore::Native
+{
+    Native() : semaphore(dispatch_semaphore_create(0)) {}
+    ~Native() { dispatch_release(semaphore); }
+
+    void post() noexcept { dispatch_semaphore_signal(semaphore); }
+
+    bool wait(int timeoutMs) noexcept
+    {
+        const auto deadline = dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(timeoutMs) * static_cast<int64_t>(NSEC_PER_MSEC));
+        return dispatch_semaphore_wait(semaphore, deadline) == 0;
+    }
+
+    dispatch_semaphore_t semaphore;
+};
+
+#elif JUCE_WINDOWS
+
+struct WakeSemaphore::Native
+{
+    Native() : semaphore(CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr)) {}
+    ~Native() { CloseHandle(semaphore); }
+
+    void post() noexcept { ReleaseSemaphore(semaphore, 1, nullptr); }
+
+    bool wait(int timeoutMs) noexcept
+    {
+        return WaitForSingleObject(semaphore, static_cast<DWORD>(timeoutMs)) == WAIT_OBJECT_0;
+    }
+
+    HANDLE semaphore;
+};
+
+#else
+
+struct WakeSemaphore::Native
+{
+    Native() { sem_init(&semaphore, 0, 0); }
+    ~Native() { sem_destroy(&semaphore); }
+
+    void post() noexcept { sem_post(&semaphore); }
+
+    bool wait(int timeoutMs) noexcept
+    {
+        // sem_timedwait takes an absolute CLOCK_REALTIME deadline.
+        timespec deadline {};
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeoutMs / 1000;
+        deadline.tv_nsec += static_cast<long>(timeoutMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        for (;;)
+        {
+            if (sem_timedwait(&semaphore, &deadline) == 0)
+                return true;
+            if (errno != EINTR)
+                return false;
+        }
+    }
+
+    sem_t semaphore;
+};
+
+#endif
+
+WakeSemaphore::WakeSemaphore()
+    : native(std::make_unique<Native>())
+{
+}
+
+WakeSemaphore::~WakeSemaphore() = default;
+
+void WakeSemaphore::post() noexcept
+{
+    native->post();
+}
+
+bool WakeSemaphore::wait(int timeoutMs) noexcept
+{
+    return native->wait(timeoutMs);
+}
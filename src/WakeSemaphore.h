@@ -0,0 +1,26 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+
+// Counting semaphore for waking a worker from the audio thread. post() takes no lock: it is an
+// atomic increment that only enters the kernel when a thread is blocked in wait(). Backed by a
+// POSIX semaphore on Linux and the BSDs, a dispatch semaphore on Apple platforms and a Win32
+// semaphore on Windows.
+class WakeSemaphore
+{
+public:
+    WakeSemaphore();
+    ~WakeSemaphore();
+
+    // Any thread, including the audio thread.
+    void post() noexcept;
+    // Blocks until a post() is available or timeoutMs has passed. Returns true if it took a post.
+    bool wait(int timeoutMs) noexcept;
+
+private:
+    struct Native;
+    std::unique_ptr<Native> native;
+
+    JUCE_DECLARE_NON_COPYABLE (WakeSemaphore)
+};
@@ -0,0 +1,117 @@
+#include "WorkStealingPool.h"
+
+class WorkStealingPool::Worker : public juce::Thread
+{
+public:
+    Worker(WorkStealingPool& ownerPool, int workerIndex)
+        : juce::Thread("Pool worker " + juce::String(workerIndex)), pool(ownerPool), index(workerIndex)
+    {
+    }
+
+    ~Worker() override
+    {
+        stopThread(-1);
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            Task task;
+            bool stolen = false;
+            if (!pool.takeTask(index, task, stolen))
+            {
+                // A short timeout covers a signal that raced with the empty check.
+                pool.workAvailable.wait(5);
+                continue;
+            }
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            task(index);
+            stats.busySeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            stats.tasksRun++;
+            if (stolen)
+                stats.tasksStolen++;
+
+            if (pool.pendingTasks.fetch_sub(1) == 1)
+                pool.allDone.signal();
+        }
+    }
+
+    WorkStealingPool& pool;
+    const int index;
+    juce::CriticalSection lock;
+    std::deque<Task> tasks;
+    WorkerStats stats;
+};
+
+WorkStealingPool::WorkStealingPool(int numWorkers)
+{
+    for (int i = 0; i < std::max(1, numWorkers); ++i)
+        workers.push_back(std::make_unique<Worker>(*this, i));
+    for (auto& worker : workers)
+        worker->startThread();
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+    workAvailable.signal();
+    workers.clear();
+}
+
+void WorkStealingPool::submit(Task task, int preferredWorker)
+{
+    const int count = getNumWorkers();
+    const int index = preferredWorker >= 0 ? preferredWorker % count : nextWorker.fetch_add(1) % count;
+    auto& worker = *workers[static_cast<size_t>(index)];
+
+    pendingTasks.fetch_add(1);
+    {
+        const juce::ScopedLock sl(worker.lock);
+        worker.tasks.push_back(std::move(task));
+    }
+    workAvailable.signal();
+}
+
+void WorkStealingPool::waitForAll()
+{
+    while (pendingTasks.load() > 0)
+        allDone.wait(50);
+}
+
+WorkStealingPool::WorkerStats WorkStealingPool::getStats(int workerIndex) const
+{
+    return workers[static_cast<size_t>(workerIndex)]->stats;
+}
+
+bool WorkStealingPool::takeTask(int workerIndex, Task& task, bool& stolen)
+{
+    {
+        auto& own = *workers[static_cast<size_t>(workerIndex)];
+        const juce::ScopedLock sl(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    const int count = getNumWorkers();
+    for (int offset = 1; offset < count; ++offset)
+    {
+        auto& victim = *workers[static_cast<size_t>((workerIndex + offset) % count)];
+        const juce::ScopedLock sl(victim.lock);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
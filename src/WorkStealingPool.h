@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Thread pool for the offline tools. Each worker owns a deque: it takes its own tasks in the order
+// they were submitted and, when that runs dry, steals the newest task from another worker, so
+// callers can front-load the longest tasks. Tasks are expected to be
+// coarse (a file, a chunk, a settings combination), so each deque is guarded by a plain lock.
+// Not for the audio thread.
+class WorkStealingPool
+{
+public:
+    // Receives the index of the worker running it, for per-worker scratch state.
+    using Task = std::function<void(int workerIndex)>;
+
+    struct WorkerStats
+    {
+        juce::int64 tasksRun = 0;
+        juce::int64 tasksStolen = 0;
+        double busySeconds = 0.0;
+    };
+
+    explicit WorkStealingPool(int numWorkers = juce::SystemStats::getNumCpus());
+    ~WorkStealingPool();
+
+    int getNumWorkers() const { return static_cast<int>(workers.size()); }
+
+    // Any thread, including a task. Queues on preferredWorker's deque, or spreads tasks round-robin
+    // when it is -1. Tasks submitted from a task should pass its workerIndex to keep them local.
+    void submit(Task task, int preferredWorker = -1);
+
+    // Blocks until every submitted task, including ones submitted by tasks, has finished.
+    void waitForAll();
+
+    // Only meaningful once waitForAll() has returned.
+    WorkerStats getStats(int workerIndex) const;
+
+private:
+    class Worker;
+
+    bool takeTask(int workerIndex, Task& task, bool& stolen);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int> pendingTasks { 0 };
+    std::atomic<int> nextWorker { 0 };
+    juce::WaitableEvent workAvailable;
+    juce::WaitableEvent allDone;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkStealingPool)
+};
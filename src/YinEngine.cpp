@@ -0,0 +1,94 @@
+#include "YinEngine.h"
+
+void YinEngine::reserve(int maxWindowSize)
+{
+    size_t fftSize = 1;
+    while (fftSize < static_cast<size_t>(std::max(1, maxWindowSize)))
+        fftSize <<= 1;
+    windowSpectrum.reserve(fftSize * 2);
+    segmentSpectrum.reserve(fftSize * 2);
+    normalised.reserve(static_cast<size_t>(maxWindowSize) + 1);
+}
+
+void YinEngine::configure(int newMinPeriod, int newMaxPeriod, float newThreshold, juce::dsp::FFT* newFft)
+{
+    maxPeriod = std::max(2, newMaxPeriod);
+    minPeriod = std::clamp(newMinPeriod, 2, maxPeriod);
+    integrationSize = getIntegrationSize(maxPeriod);
+    threshold = newThreshold;
+    fft = newFft;
+    jassert(fft != nullptr && fft->getSize() >= getWindowSize(maxPeriod));
+
+    const size_t spectrumSize = static_cast<size_t>(fft->getSize()) * 2;
+    windowSpectrum.assign(spectrumSize, 0.0f);
+    segmentSpectrum.assign(spectrumSize, 0.0f);
+    normalised.assign(static_cast<size_t>(maxPeriod) + 1, 1.0f);
+}
+
+bool YinEngine::findPeriod(const float* window, float& period, float& aperiodicity)
+{
+    const int fftSize = fft->getSize();
+    const int windowSize = maxPeriod + integrationSize;
+
+    std::copy(window, window + windowSize, windowSpectrum.begin());
+    std::fill(windowSpectrum.begin() + windowSize, windowSpectrum.end(), 0.0f);
+    std::copy(window, window + integrationSize, segmentSpectrum.begin());
+    std::fill(segmentSpectrum.begin() + integrationSize, segmentSpectrum.end(), 0.0f);
+
+    fft->performRealOnlyForwardTransform(windowSpectrum.data(), true);
+    fft->performRealOnlyForwardTransform(segmentSpectrum.data(), true);
+
+    // Cross-spectrum window * conj(segment): its inverse is sum_{j < W} x[j] * x[j + tau].
+    for (int k = 0; k <= fftSize / 2; ++k)
+    {
+        const size_t re = static_cast<size_t>(2 * k);
+        const size_t im = re + 1;
+        const float xr = windowSpectrum[re];
+        const float xi = windowSpectrum[im];
+        const float yr = segmentSpectrum[re];
+        const float yi = segmentSpectrum[im];
+        windowSpectrum[re] = xr * yr + xi * yi;
+        windowSpectrum[im] = xi * yr - xr * yi;
+    }
+    fft->performRealOnlyInverseTransform(windowSpectrum.data());
+
+    double segmentEnergy = 0.0;
+    for (int j = 0; j < integrationSize; ++j)
+        segmentEnergy += static_cast<double>(window[j]) * window[j];
+
+    // The energies are summed in double, so sliding one sample in and out per lag cannot drift.
+    double shiftedEnergy = segmentEnergy;
+    double cumulative = 0.0;
+    normalised[0] = 1.0f;
+    for (int tau = 1; tau <= maxPeriod; ++tau)
+    {
+        const float entering = window[tau + integrationSize - 1];
+        const float leaving = window[tau - 1];
+        shiftedEnergy += static_cast<double>(entering) * entering - static_cast<double>(leaving) * leaving;
+        const double difference = std::max(0.0, segmentEnergy + shiftedEnergy - 2.0 * windowSpectrum[static_cast<size_t>(tau)]);
+        cumulative += difference;
+        normalised[static_cast<size_t>(tau)] = cumulative > 0.0 ? static_cast<float>(difference * tau / cumulative) : 1.0f;
+    }
+
+    int tau = minPeriod;
+    while (tau <= maxPeriod && normalised[static_cast<size_t>(tau)] >= threshold)
+        tau++;
+    if (tau > maxPeriod)
+        return false;
+    while (tau < maxPeriod && normalised[static_cast<size_t>(tau + 1)] < normalised[static_cast<size_t>(tau)])
+        tau++;
+
+    // Parabolic interpolation of the dip; tau >= 2, so both neighbours exist below maxPeriod.
+    period = static_cast<float>(tau);
+    if (tau < maxPeriod)
+    {
+        const float previous = normalised[static_cast<size_t>(tau - 1)];
+        const float current = normalised[static_cast<size_t>(tau)];
+        const float next = normalised[static_cast<size_t>(tau + 1)];
+        const float curvature = previous - 2.0f * current + next;
+        if (curvature > 1.0e-9f)
+            period += 0.5f * (previous - next) / curvature;
+    }
+    aperiodicity = std::clamp(normalised[static_cast<size_t>(tau)], 0.0f, 1.0f);
+    return true;
+}
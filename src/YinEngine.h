@@ -0,0 +1,42 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+
+// YIN (de Cheveigne and Kawahara, 2002) for PitchDetector's yin engine. The difference function
+// d(tau) = sum_{j < W} (x[j] - x[j + tau])^2 is expanded into the two segment energies, slid along
+// the window one sample per lag, minus twice their cross-correlation, which one FFT gives for
+// every lag at once. The period is the first dip of the cumulative mean normalised difference
+// d'(tau) = d(tau) * tau / sum_{k <= tau} d(k) below the threshold, followed to its minimum.
+//
+// The normalisation keeps d' meaningful with an integration window W of half the longest period,
+// so the analysis window is 1.5 * maxPeriod samples against the autocorrelation's 2 * maxPeriod.
+class YinEngine
+{
+public:
+    static int getIntegrationSize(int maxPeriod) { return std::max(1, maxPeriod / 2); }
+    static int getWindowSize(int maxPeriod) { return maxPeriod + getIntegrationSize(maxPeriod); }
+
+    // Not real-time safe: allocates for windows of up to maxWindowSize samples.
+    void reserve(int maxWindowSize);
+    // Real-time safe within the reserved size. fft must hold at least getWindowSize(maxPeriod)
+    // samples, so the circular correlation does not wrap.
+    void configure(int minPeriod, int maxPeriod, float threshold, juce::dsp::FFT* fft);
+
+    // Finds the period of the getWindowSize() samples at window, in samples with sub-sample
+    // precision, and its aperiodicity d'(period) in [0, 1]. False when no lag between minPeriod
+    // and maxPeriod dips below the threshold.
+    bool findPeriod(const float* window, float& period, float& aperiodicity);
+
+private:
+    juce::dsp::FFT* fft = nullptr;
+    std::vector<float> windowSpectrum;
+    std::vector<float> segmentSpectrum;
+    // d'(tau) for tau in [0, maxPeriod].
+    std::vector<float> normalised;
+    int minPeriod = 1;
+    int maxPeriod = 1;
+    int integrationSize = 1;
+    float threshold = 0.15f;
+};
@@ -0,0 +1,239 @@
+// Turns recorded takes into Standard MIDI Files with the plugin's analysis chain, spreading the
+// files over a work-stealing pool.
+//
+//   myk-batch-transcribe [--threads N] [--out dir] [--block 256] [--gain 1] [--min-freq 60]
+//                        [--max-freq 2000] [--exec 100] [--median 7] [--min-note-ms 50]
+//                        [--min-velocity 0] <file or directory> ...
+//
+// Directories are searched recursively for every format JUCE can read. Each take is written as
+// <name>.mid next to it, or under --out keeping its path relative to the directory it was found
+// in. Prints files/s and the realtime factor overall and per worker; exits with 1 if any file
+// could not be read or written.
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include "OfflineTranscriber.h"
+#include "WorkStealingPool.h"
+
+namespace
+{
+    struct Options
+    {
+        int threads = juce::SystemStats::getNumCpus();
+        juce::File outDirectory;
+        OfflineTranscriber::Settings settings = OfflineTranscriber::getDefaultSettings();
+        juce::StringArray inputs;
+    };
+
+    struct Job
+    {
+        juce::File input;
+        juce::File output;
+        juce::int64 bytes = 0;
+        // Filled in by the worker.
+        bool ok = false;
+        juce::String error;
+        double audioSeconds = 0.0;
+        int notes = 0;
+        int workerIndex = -1;
+        int startOrder = -1;
+    };
+
+    struct WorkerTotals
+    {
+        int files = 0;
+        double audioSeconds = 0.0;
+    };
+
+    bool parseArguments(const juce::StringArray& args, Options& options)
+    {
+        auto& detector = options.settings.detector;
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+            if (arg == "--threads" && hasValue)
+                options.threads = std::max(1, args[++i].getIntValue());
+            else if (arg == "--out" && hasValue)
+                options.outDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--block" && hasValue)
+                options.settings.blockSize = std::max(1, args[++i].getIntValue());
+            else if (arg == "--gain" && hasValue)
+                options.settings.gain = args[++i].getFloatValue();
+            else if (arg == "--min-freq" && hasValue)
+                detector.minFreq = args[++i].getFloatValue();
+            else if (arg == "--max-freq" && hasValue)
+                detector.maxFreq = args[++i].getFloatValue();
+            else if (arg == "--exec" && hasValue)
+                detector.execFreq = args[++i].getFloatValue();
+            else if (arg == "--median" && hasValue)
+                detector.medianSize = args[++i].getIntValue();
+            else if (arg == "--min-note-ms" && hasValue)
+                options.settings.minNoteSeconds = args[++i].getFloatValue() * 0.001f;
+            else if (arg == "--min-velocity" && hasValue)
+                options.settings.minVelocity = juce::jlimit(0, 127, args[++i].getIntValue());
+            else if (!arg.startsWith("--"))
+                options.inputs.add(arg);
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+                return false;
+            }
+        }
+        return !options.inputs.isEmpty();
+    }
+
+    juce::File getOutputFile(const juce::File& input, const juce::File& searchRoot, const juce::File& outDirectory)
+    {
+        if (outDirectory == juce::File())
+            return input.withFileExtension("mid");
+        const auto relative = searchRoot == juce::File() ? input.getFileName() : input.getRelativePathFrom(searchRoot);
+        return outDirectory.getChildFile(relative).withFileExtension("mid");
+    }
+
+    std::vector<Job> collectJobs(const Options& options, const juce::String& wildcard)
+    {
+        std::vector<Job> jobs;
+        for (const auto& path : options.inputs)
+        {
+            const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+            if (file.isDirectory())
+            {
+                auto found = file.findChildFiles(juce::File::findFiles, true, wildcard);
+                found.sort();
+                for (const auto& child : found)
+                    jobs.push_back({ child, getOutputFile(child, file, options.outDirectory), child.getSize() });
+            }
+            else
+            {
+                jobs.push_back({ file, getOutputFile(file, {}, options.outDirectory), file.getSize() });
+            }
+        }
+        return jobs;
+    }
+
+    void transcribe(Job& job, juce::AudioFormatManager& formats, const OfflineTranscriber::Settings& settings)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(job.input));
+        if (reader == nullptr)
+        {
+            job.error = "could not read";
+            return;
+        }
+
+        OfflineTranscriber::Result result;
+        if (!OfflineTranscriber::transcribe(*reader, settings, result))
+        {
+            job.error = "decode failed";
+            return;
+        }
+        job.audioSeconds = static_cast<double>(result.numSamples) / result.sampleRate;
+        job.notes = static_cast<int>(std::count_if(result.events.begin(), result.events.end(),
+                                                   [](const OfflineTranscriber::Event& e) { return e.noteOn; }));
+
+        if (!OfflineTranscriber::writeMidiFile(result, job.output))
+        {
+            job.error = "could not write " + job.output.getFullPathName();
+            return;
+        }
+        job.ok = true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    Options options;
+    if (!parseArguments(args, options))
+    {
+        std::cerr << "Usage: myk-batch-transcribe [options] <file or directory> ...\n";
+        return 2;
+    }
+
+    juce::AudioFormatManager wildcardFormats;
+    wildcardFormats.registerBasicFormats();
+    auto jobs = collectJobs(options, wildcardFormats.getWildcardForAllFormats());
+    if (jobs.empty())
+    {
+        std::cerr << "No audio files found\n";
+        return 2;
+    }
+
+    // Largest first, so the long takes start early and stealing evens out the tail.
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.bytes > b.bytes; });
+
+    WorkStealingPool pool(options.threads);
+    // Format readers are not shared between threads, so each worker keeps its own manager.
+    std::vector<std::unique_ptr<juce::AudioFormatManager>> formats;
+    for (int i = 0; i < pool.getNumWorkers(); ++i)
+    {
+        formats.push_back(std::make_unique<juce::AudioFormatManager>());
+        formats.back()->registerBasicFormats();
+    }
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    std::atomic<int> nextStartOrder { 0 };
+    for (auto& job : jobs)
+    {
+        pool.submit([&job, &formats, &options, &nextStartOrder](int workerIndex)
+        {
+            job.startOrder = nextStartOrder.fetch_add(1);
+            job.workerIndex = workerIndex;
+            transcribe(job, *formats[static_cast<size_t>(workerIndex)], options.settings);
+        });
+    }
+    pool.waitForAll();
+    const double wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    // Each worker takes its own tasks in submission order, so the largest file is among the first
+    // ones dequeued; anything later means it sat behind smaller files.
+    const bool largestStartedFirst = jobs.front().startOrder < pool.getNumWorkers();
+    jassert(largestStartedFirst);
+    if (!largestStartedFirst)
+        std::cerr << "Largest file started " << jobs.front().startOrder + 1 << "th of " << jobs.size() << "\n";
+
+    int failed = 0;
+    double audioSeconds = 0.0;
+    std::vector<WorkerTotals> totals(static_cast<size_t>(pool.getNumWorkers()));
+    for (const auto& job : jobs)
+    {
+        if (!job.ok)
+        {
+            std::cerr << job.input.getFullPathName() << ": " << job.error << "\n";
+            failed++;
+            continue;
+        }
+        audioSeconds += job.audioSeconds;
+        auto& worker = totals[static_cast<size_t>(job.workerIndex)];
+        worker.files++;
+        worker.audioSeconds += job.audioSeconds;
+    }
+
+    const int succeeded = static_cast<int>(jobs.size()) - failed;
+    std::cout << succeeded << " file(s), " << juce::String(audioSeconds, 1) << " s of audio in "
+              << juce::String(wallSeconds, 2) << " s: " << juce::String(succeeded / wallSeconds, 2) << " files/s, "
+              << juce::String(audioSeconds / wallSeconds, 1) << "x realtime, "
+              << juce::String(audioSeconds / wallSeconds / pool.getNumWorkers(), 1) << "x per worker\n";
+    std::cout << "worker   files  stolen   busy s   realtime x\n";
+    for (int i = 0; i < pool.getNumWorkers(); ++i)
+    {
+        const auto stats = pool.getStats(i);
+        const auto& worker = totals[static_cast<size_t>(i)];
+        std::cout << juce::String(i).paddedLeft(' ', 6)
+                  << juce::String(worker.files).paddedLeft(' ', 8)
+                  << juce::String(stats.tasksStolen).paddedLeft(' ', 8)
+                  << juce::String(stats.busySeconds, 2).paddedLeft(' ', 9)
+                  << juce::String(stats.busySeconds > 0.0 ? worker.audioSeconds / stats.busySeconds : 0.0, 1).paddedLeft(' ', 13) << "\n";
+    }
+
+    if (failed > 0)
+        std::cerr << failed << " file(s) failed\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// Transcribes one long WAV recording (a rehearsal, a live set) to a Standard MIDI File by
+// analysing memory-mapped chunks of it in parallel, with the same result as a single pass.
+//
+//   myk-chunk-transcribe [--threads N] [--chunk-seconds 60] [--overlap-seconds 2] [--verify]
+//                        [--block 256] [--gain 1] [--min-freq 60] [--max-freq 2000] [--exec 100]
+//                        [--median 7] [--min-note-ms 50] [--min-velocity 0] <file.wav> [out.mid]
+//
+// Writes <name>.mid next to the input unless an output file is given. --verify also runs the
+// single sequential pass over the same mapping and exits with 1 if its events differ.
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "ChunkedTranscriber.h"
+
+namespace
+{
+    struct Options
+    {
+        int threads = juce::SystemStats::getNumCpus();
+        bool verify = false;
+        ChunkedTranscriber::Settings settings;
+        juce::StringArray files;
+    };
+
+    bool parseArguments(const juce::StringArray& args, Options& options)
+    {
+        auto& analysis = options.settings.analysis;
+        auto& detector = analysis.detector;
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+            if (arg == "--threads" && hasValue)
+                options.threads = std::max(1, args[++i].getIntValue());
+            else if (arg == "--chunk-seconds" && hasValue)
+                options.settings.chunkSeconds = args[++i].getDoubleValue();
+            else if (arg == "--overlap-seconds" && hasValue)
+                options.settings.overlapSeconds = args[++i].getDoubleValue();
+            else if (arg == "--verify")
+                options.verify = true;
+            else if (arg == "--block" && hasValue)
+                analysis.blockSize = std::max(1, args[++i].getIntValue());
+            else if (arg == "--gain" && hasValue)
+                analysis.gain = args[++i].getFloatValue();
+            else if (arg == "--min-freq" && hasValue)
+                detector.minFreq = args[++i].getFloatValue();
+            else if (arg == "--max-freq" && hasValue)
+                detector.maxFreq = args[++i].getFloatValue();
+            else if (arg == "--exec" && hasValue)
+                detector.execFreq = args[++i].getFloatValue();
+            else if (arg == "--median" && hasValue)
+                detector.medianSize = args[++i].getIntValue();
+            else if (arg == "--min-note-ms" && hasValue)
+                analysis.minNoteSeconds = args[++i].getFloatValue() * 0.001f;
+            else if (arg == "--min-velocity" && hasValue)
+                analysis.minVelocity = juce::jlimit(0, 127, args[++i].getIntValue());
+            else if (!arg.startsWith("--"))
+                options.files.add(arg);
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+                return false;
+            }
+        }
+        return options.files.size() == 1 || options.files.size() == 2;
+    }
+
+    bool transcribeSequentially(const juce::File& file, const OfflineTranscriber::Settings& settings, OfflineTranscriber::Result& result)
+    {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(juce::WavAudioFormat().createMemoryMappedReader(file));
+        return reader != nullptr && reader->mapEntireFile() && OfflineTranscriber::transcribe(*reader, settings, result);
+    }
+
+    // Index of the first event that differs, or -1 when both lists are the same.
+    int findFirstDifference(const std::vector<OfflineTranscriber::Event>& a, const std::vector<OfflineTranscriber::Event>& b)
+    {
+        const size_t common = std::min(a.size(), b.size());
+        for (size_t i = 0; i < common; ++i)
+        {
+            if (a[i].samplePosition != b[i].samplePosition || a[i].note != b[i].note
+                || a[i].velocity != b[i].velocity || a[i].noteOn != b[i].noteOn)
+                return static_cast<int>(i);
+        }
+        return a.size() == b.size() ? -1 : static_cast<int>(common);
+    }
+
+    double secondsSince(juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    Options options;
+    if (!parseArguments(args, options))
+    {
+        std::cerr << "Usage: myk-chunk-transcribe [options] <file.wav> [out.mid]\n";
+        return 2;
+    }
+
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+    const auto input = cwd.getChildFile(options.files[0]);
+    const auto output = options.files.size() > 1 ? cwd.getChildFile(options.files[1]) : input.withFileExtension("mid");
+
+    WorkStealingPool pool(options.threads);
+    OfflineTranscriber::Result result;
+    ChunkedTranscriber::Stats stats;
+    const auto start = juce::Time::getHighResolutionTicks();
+    if (!ChunkedTranscriber::transcribe(input, options.settings, pool, result, stats))
+    {
+        std::cerr << input.getFullPathName() << ": not a readable WAV file\n";
+        return 1;
+    }
+    const double wallSeconds = secondsSince(start);
+
+    if (!OfflineTranscriber::writeMidiFile(result, output))
+    {
+        std::cerr << "Could not write " << output.getFullPathName() << "\n";
+        return 1;
+    }
+
+    auto toSeconds = [&result](juce::int64 samples) { return juce::String(static_cast<double>(samples) / result.sampleRate, 2); };
+    const double audioSeconds = static_cast<double>(result.numSamples) / result.sampleRate;
+    std::cout << toSeconds(result.numSamples) << " s of audio in " << juce::String(wallSeconds, 2) << " s on "
+              << pool.getNumWorkers() << " worker(s): " << juce::String(audioSeconds / wallSeconds, 1) << "x realtime\n"
+              << stats.chunks << " chunk(s) of " << toSeconds(stats.chunkSamples) << " s with "
+              << toSeconds(stats.overlapSamples) << " s warm-up (" << toSeconds(stats.warmUpSamples) << " s in total)\n"
+              << stats.resyncedChunks << " chunk(s) resynced, " << toSeconds(stats.resyncSamples) << " s analysed again\n";
+
+    if (options.verify)
+    {
+        OfflineTranscriber::Result sequential;
+        const auto sequentialStart = juce::Time::getHighResolutionTicks();
+        if (!transcribeSequentially(input, options.settings.analysis, sequential))
+        {
+            std::cerr << "Sequential pass failed\n";
+            return 1;
+        }
+        const double sequentialSeconds = secondsSince(sequentialStart);
+
+        const int difference = findFirstDifference(result.events, sequential.events);
+        std::cout << "sequential pass " << juce::String(sequentialSeconds, 2) << " s, speedup "
+                  << juce::String(sequentialSeconds / wallSeconds, 2) << "x, " << static_cast<int>(sequential.events.size()) << " event(s): ";
+        if (difference >= 0)
+        {
+            std::cout << "differs from event " << difference << "\n";
+            return 1;
+        }
+        std::cout << "identical\n";
+    }
+    return 0;
+}
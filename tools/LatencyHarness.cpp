@@ -0,0 +1,389 @@
+// Measures how long the plugin takes to turn a plucked note into a MIDI note-on, and a release into
+// a note-off, by driving TestPluginAudioProcessor offline with synthetic notes whose onsets fall at
+// random positions within the block.
+//
+//   myk-latency-harness [--full] [--trials 40] [--seed 1] [--json latency.json]
+//
+// By default each axis (sample rate, block size, execFreq, median size, min note length, minFreq)
+// is varied on its own around a baseline configuration; --full runs every combination. Latency is
+// measured from the first sample of the onset or release to the sample position of the MIDI event,
+// without any host latency compensation.
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "PluginProcessor.h"
+
+namespace
+{
+    struct Config
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 256;
+        float execFreq = 100.0f;
+        int medianSize = 7;
+        float delayMs = 50.0f;
+        float minFreq = 60.0f;
+    };
+
+    struct Options
+    {
+        bool full = false;
+        int trials = 40;
+        int seed = 1;
+        juce::File jsonFile;
+    };
+
+    struct Trial
+    {
+        int note = 0;
+        juce::int64 onSample = 0;
+        juce::int64 releaseSample = 0;
+    };
+
+    struct Stimulus
+    {
+        std::vector<float> samples;
+        std::vector<Trial> trials;
+    };
+
+    struct MidiEvent
+    {
+        juce::int64 sample = 0;
+        int note = 0;
+        bool noteOn = false;
+    };
+
+    struct Distribution
+    {
+        std::vector<double> values;
+
+        double percentile(double p) const
+        {
+            if (values.empty())
+                return 0.0;
+            auto sorted = values;
+            std::sort(sorted.begin(), sorted.end());
+            const auto index = static_cast<size_t>(std::lround(p / 100.0 * static_cast<double>(sorted.size() - 1)));
+            return sorted[index];
+        }
+
+        double mean() const
+        {
+            double sum = 0.0;
+            for (auto value : values)
+                sum += value;
+            return values.empty() ? 0.0 : sum / static_cast<double>(values.size());
+        }
+    };
+
+    struct Measurement
+    {
+        Distribution onset;
+        Distribution release;
+        int missed = 0;
+        int wrongNote = 0;
+        // Further note-ons of the same pitch while the note was still sounding.
+        int retriggers = 0;
+        int reportedLatencySamples = 0;
+    };
+
+    const double sampleRates[] = { 44100.0, 48000.0, 96000.0 };
+    const int blockSizes[] = { 32, 64, 128, 256, 512, 1024 };
+    // execFreq is clamped to [minFreq, maxFreq], so lower values would all run at minFreq.
+    const float execFreqs[] = { 60.0f, 100.0f, 200.0f, 400.0f };
+    const int medianSizes[] = { 1, 7, 15 };
+    const float delaysMs[] = { 1.0f, 20.0f, 50.0f, 100.0f };
+    const float minFreqs[] = { 40.0f, 60.0f, 100.0f };
+
+    bool isSameConfig(const Config& a, const Config& b)
+    {
+        return a.sampleRate == b.sampleRate && a.blockSize == b.blockSize && a.execFreq == b.execFreq
+            && a.medianSize == b.medianSize && a.delayMs == b.delayMs && a.minFreq == b.minFreq;
+    }
+
+    std::vector<Config> buildMatrix(bool full)
+    {
+        std::vector<Config> configs;
+        const Config baseline;
+        if (full)
+        {
+            for (auto sampleRate : sampleRates)
+                for (auto blockSize : blockSizes)
+                    for (auto execFreq : execFreqs)
+                        for (auto medianSize : medianSizes)
+                            for (auto delayMs : delaysMs)
+                                for (auto minFreq : minFreqs)
+                                    configs.push_back({ sampleRate, blockSize, execFreq, medianSize, delayMs, minFreq });
+            return configs;
+        }
+
+        configs.push_back(baseline);
+        auto vary = [&](const auto& values, auto apply)
+        {
+            for (auto value : values)
+            {
+                auto c = baseline;
+                apply(c, value);
+                if (std::none_of(configs.begin(), configs.end(), [&](const Config& other) { return isSameConfig(other, c); }))
+                    configs.push_back(c);
+            }
+        };
+        vary(sampleRates, [](Config& c, double v) { c.sampleRate = v; });
+        vary(blockSizes, [](Config& c, int v) { c.blockSize = v; });
+        vary(execFreqs, [](Config& c, float v) { c.execFreq = v; });
+        vary(medianSizes, [](Config& c, int v) { c.medianSize = v; });
+        vary(delaysMs, [](Config& c, float v) { c.delayMs = v; });
+        vary(minFreqs, [](Config& c, float v) { c.minFreq = v; });
+        return configs;
+    }
+
+    juce::String getConfigId(const Config& c)
+    {
+        return "sr=" + juce::String(static_cast<int>(c.sampleRate)) + " block=" + juce::String(c.blockSize)
+             + " exec=" + juce::String(c.execFreq, 0) + " median=" + juce::String(c.medianSize)
+             + " delay=" + juce::String(c.delayMs, 0) + "ms minFreq=" + juce::String(c.minFreq, 0);
+    }
+
+    // Plucked harmonic notes with random pitch, length and gap. The note and gap lengths are drawn in
+    // samples, so onsets and releases land at arbitrary positions within the block. The same seed
+    // gives the same notes at every sample rate.
+    Stimulus makeStimulus(double sampleRate, int numTrials, int seed)
+    {
+        juce::Random random(seed);
+        Stimulus stimulus;
+        const double twoPi = juce::MathConstants<double>::twoPi;
+        const auto attack = static_cast<juce::int64>(0.001 * sampleRate);
+        const auto releaseRamp = static_cast<juce::int64>(0.003 * sampleRate);
+
+        juce::int64 position = static_cast<juce::int64>(0.5 * sampleRate);
+        for (int i = 0; i < numTrials; ++i)
+        {
+            Trial trial;
+            trial.note = 40 + random.nextInt(37);
+            trial.onSample = position;
+            trial.releaseSample = position + static_cast<juce::int64>((0.3 + 0.3 * random.nextDouble()) * sampleRate);
+            stimulus.trials.push_back(trial);
+            position = trial.releaseSample + static_cast<juce::int64>((0.2 + 0.2 * random.nextDouble()) * sampleRate);
+        }
+        // Long enough for the last note-off to come out.
+        stimulus.samples.assign(static_cast<size_t>(position + static_cast<juce::int64>(sampleRate)), 0.0f);
+
+        for (const auto& trial : stimulus.trials)
+        {
+            const double freq = 440.0 * std::pow(2.0, (trial.note - 69) / 12.0);
+            const auto length = trial.releaseSample - trial.onSample + releaseRamp;
+            for (juce::int64 i = 0; i < length; ++i)
+            {
+                const double t = static_cast<double>(i) / sampleRate;
+                double envelope = 0.5 * std::exp(-t / 1.5);
+                envelope *= std::min(1.0, static_cast<double>(i) / static_cast<double>(attack));
+                if (i >= length - releaseRamp)
+                    envelope *= static_cast<double>(length - i) / static_cast<double>(releaseRamp);
+
+                const double phase = twoPi * freq * t;
+                double value = 0.0;
+                for (int harmonic = 1; harmonic <= 4; ++harmonic)
+                    if (freq * harmonic < 0.5 * sampleRate)
+                        value += std::sin(harmonic * phase) / harmonic;
+                stimulus.samples[static_cast<size_t>(trial.onSample + i)] = static_cast<float>(envelope * value);
+            }
+        }
+        return stimulus;
+    }
+
+    void setParameter(juce::AudioProcessorValueTreeState& state, const char* id, float value)
+    {
+        auto* parameter = state.getParameter(id);
+        jassert(parameter != nullptr);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    std::vector<MidiEvent> render(const Config& c, const Stimulus& stimulus, int& reportedLatencySamples)
+    {
+        TestPluginAudioProcessor processor;
+        auto& state = processor.getValueTreeState();
+        // prepareToPlay reads the detector settings straight from the parameters.
+        setParameter(state, "execFreq", c.execFreq);
+        setParameter(state, "median", static_cast<float>(c.medianSize));
+        setParameter(state, "delay", c.delayMs * 0.001f);
+        setParameter(state, "minFreq", c.minFreq);
+        processor.setRateAndBufferSizeDetails(c.sampleRate, c.blockSize);
+        processor.prepareToPlay(c.sampleRate, c.blockSize);
+        reportedLatencySamples = processor.getLatencySamples();
+
+        juce::AudioBuffer<float> buffer(processor.getTotalNumInputChannels(), c.blockSize);
+        juce::MidiBuffer midi;
+        std::vector<MidiEvent> events;
+        const auto total = static_cast<juce::int64>(stimulus.samples.size());
+        for (juce::int64 start = 0; start + c.blockSize <= total; start += c.blockSize)
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.copyFrom(channel, 0, stimulus.samples.data() + start, c.blockSize);
+            midi.clear();
+            processor.processBlock(buffer, midi);
+
+            for (const auto metadata : midi)
+            {
+                const auto message = metadata.getMessage();
+                if (message.isNoteOn())
+                    events.push_back({ start + metadata.samplePosition, message.getNoteNumber(), true });
+                else if (message.isNoteOff())
+                    events.push_back({ start + metadata.samplePosition, message.getNoteNumber(), false });
+            }
+        }
+        processor.releaseResources();
+        return events;
+    }
+
+    // Each trial takes the first note-on of its pitch between its onset and the next trial's onset,
+    // then the first note-off of that pitch between its release and the next onset.
+    Measurement measure(const Config& c, const Stimulus& stimulus, const std::vector<MidiEvent>& events)
+    {
+        Measurement m;
+        const double msPerSample = 1000.0 / c.sampleRate;
+        for (size_t t = 0; t < stimulus.trials.size(); ++t)
+        {
+            const auto& trial = stimulus.trials[t];
+            const auto windowEnd = t + 1 < stimulus.trials.size() ? stimulus.trials[t + 1].onSample
+                                                                   : static_cast<juce::int64>(stimulus.samples.size());
+            auto inWindow = [&](const MidiEvent& e) { return e.noteOn && e.sample >= trial.onSample && e.sample < windowEnd; };
+            const auto on = std::find_if(events.begin(), events.end(), [&](const MidiEvent& e) { return inWindow(e) && e.note == trial.note; });
+            if (on == events.end())
+            {
+                if (std::any_of(events.begin(), events.end(), inWindow))
+                    m.wrongNote++;
+                else
+                    m.missed++;
+                continue;
+            }
+
+            m.onset.values.push_back(static_cast<double>(on->sample - trial.onSample) * msPerSample);
+            m.retriggers += static_cast<int>(std::count_if(on + 1, events.end(), [&](const MidiEvent& e)
+            {
+                return e.noteOn && e.note == trial.note && e.sample < trial.releaseSample;
+            }));
+            const auto off = std::find_if(on, events.end(), [&](const MidiEvent& e)
+            {
+                return !e.noteOn && e.note == trial.note && e.sample >= trial.releaseSample && e.sample < windowEnd;
+            });
+            if (off != events.end())
+                m.release.values.push_back(static_cast<double>(off->sample - trial.releaseSample) * msPerSample);
+        }
+        return m;
+    }
+
+    juce::var toJson(const Distribution& d)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("count", static_cast<int>(d.values.size()));
+        object->setProperty("meanMs", d.mean());
+        object->setProperty("minMs", d.percentile(0.0));
+        object->setProperty("p50Ms", d.percentile(50.0));
+        object->setProperty("p90Ms", d.percentile(90.0));
+        object->setProperty("p99Ms", d.percentile(99.0));
+        object->setProperty("maxMs", d.percentile(100.0));
+        return juce::var(object);
+    }
+
+    juce::var toJson(const juce::String& id, const Config& c, const Measurement& m)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("id", id);
+        object->setProperty("sampleRate", c.sampleRate);
+        object->setProperty("blockSize", c.blockSize);
+        object->setProperty("execFreq", c.execFreq);
+        object->setProperty("medianSize", c.medianSize);
+        object->setProperty("delayMs", c.delayMs);
+        object->setProperty("minFreq", c.minFreq);
+        object->setProperty("reportedLatencySamples", m.reportedLatencySamples);
+        object->setProperty("missed", m.missed);
+        object->setProperty("wrongNote", m.wrongNote);
+        object->setProperty("retriggers", m.retriggers);
+        object->setProperty("onset", toJson(m.onset));
+        object->setProperty("release", toJson(m.release));
+        return juce::var(object);
+    }
+
+    bool parseArguments(const juce::StringArray& args, Options& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+            if (arg == "--full")
+                options.full = true;
+            else if (arg == "--trials" && hasValue)
+                options.trials = std::max(1, args[++i].getIntValue());
+            else if (arg == "--seed" && hasValue)
+                options.seed = args[++i].getIntValue();
+            else if (arg == "--json" && hasValue)
+                options.jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    Options options;
+    if (!parseArguments(args, options))
+        return 2;
+
+    std::cout << juce::String("config").paddedRight(' ', 64) << "  on p50     p90     p99     max"
+              << "  off p50     p90     p99     max  missed  wrong  retrig\n";
+
+    juce::Array<juce::var> results;
+    double stimulusRate = 0.0;
+    Stimulus stimulus;
+    for (const auto& c : buildMatrix(options.full))
+    {
+        if (c.sampleRate != stimulusRate)
+        {
+            stimulus = makeStimulus(c.sampleRate, options.trials, options.seed);
+            stimulusRate = c.sampleRate;
+        }
+
+        int reportedLatencySamples = 0;
+        const auto events = render(c, stimulus, reportedLatencySamples);
+        auto m = measure(c, stimulus, events);
+        m.reportedLatencySamples = reportedLatencySamples;
+
+        const auto id = getConfigId(c);
+        auto column = [](double value, int width) { return juce::String(value, 1).paddedLeft(' ', width); };
+        std::cout << id.paddedRight(' ', 64)
+                  << column(m.onset.percentile(50.0), 8) << column(m.onset.percentile(90.0), 8)
+                  << column(m.onset.percentile(99.0), 8) << column(m.onset.percentile(100.0), 8)
+                  << column(m.release.percentile(50.0), 9) << column(m.release.percentile(90.0), 8)
+                  << column(m.release.percentile(99.0), 8) << column(m.release.percentile(100.0), 8)
+                  << juce::String(m.missed).paddedLeft(' ', 8) << juce::String(m.wrongNote).paddedLeft(' ', 7)
+                  << juce::String(m.retriggers).paddedLeft(' ', 8) << "\n";
+        results.add(toJson(id, c, m));
+    }
+    std::cout << "Latencies in ms from the onset or release to the MIDI event.\n";
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("trials", options.trials);
+    root->setProperty("seed", options.seed);
+    root->setProperty("configs", results);
+    if (options.jsonFile != juce::File() && !options.jsonFile.replaceWithText(juce::JSON::toString(juce::var(root))))
+    {
+        std::cerr << "Could not write " << options.jsonFile.getFullPathName() << "\n";
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,643 @@
+// Searches PitchDetector settings for one instrument: decodes a labelled corpus once and runs every
+// combination of the swept parameters over it in parallel, then reports the cheapest combination
+// that reaches the accuracy target and can save it as a plugin state.
+//
+//   myk-param-sweep [--threads N] [--target 0.9] [--onset-ms 150] [--cache corpus.cache]
+//                   [--preset best.state] [--top 10] [--exec 60,100,200,400] [--bins 4,8,16,32]
+//                   [--median 1,3,7,15] [--peak 0.3,0.5,0.7] [--downsample 1,2,4] [--block 256]
+//                   [--gain 1] [--min-freq 60] [--max-freq 2000] [--min-note-ms 50]
+//                   [--min-velocity 0] <file or directory> ...
+//
+// Every take needs a Standard MIDI File with the same name next to it (take.wav, take.mid) holding
+// the notes played. A detected note counts when a reference note of the same pitch starts between
+// 50 ms before it and --onset-ms after it; accuracy is the F1 score over all notes of the corpus.
+// Takes are downmixed to mono floats in memory, or into --cache: when that file exists it is
+// memory-mapped and the inputs are not read at all. Cost is measured per combination, so run with
+// --threads 1 for the steadiest timings. --preset writes the chosen settings in the format of the
+// plugin's getStateInformation() (or as XML when the name ends in .xml). Exits with 1 when no
+// combination reaches --target, after reporting the most accurate one.
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "OfflineTranscriber.h"
+#include "WorkStealingPool.h"
+
+namespace
+{
+    constexpr const char* cacheMagic = "MYKSWEEP";
+    constexpr int cacheVersion = 1;
+    // Sample data in the cache starts on this boundary, so mapped takes are read as aligned floats.
+    constexpr juce::int64 cacheAlignment = 64;
+
+    struct ReferenceNote
+    {
+        int note = 0;
+        juce::int64 onSample = 0;
+        juce::int64 offSample = 0;
+    };
+
+    struct Take
+    {
+        juce::File file;
+        juce::String name;
+        double sampleRate = 0.0;
+        juce::int64 numSamples = 0;
+        std::vector<ReferenceNote> notes;
+        // Mono samples: either decoded here or pointing into the mapped cache.
+        std::vector<float> decoded;
+        const float* mapped = nullptr;
+        juce::String error;
+
+        const float* getSamples() const { return mapped != nullptr ? mapped : decoded.data(); }
+    };
+
+    struct Corpus
+    {
+        std::vector<Take> takes;
+        std::unique_ptr<juce::MemoryMappedFile> cache;
+    };
+
+    struct Combination
+    {
+        float execFreq = 100.0f;
+        int maxBinsPerOctave = 16;
+        int medianSize = 7;
+        float peakThreshold = 0.5f;
+        int downSample = 1;
+    };
+
+    struct Score
+    {
+        int references = 0;
+        int detected = 0;
+        int matched = 0;
+        double onsetMs = 0.0;
+        juce::int64 elapsedTicks = 0;
+        juce::int64 samples = 0;
+
+        double precision() const { return detected > 0 ? static_cast<double>(matched) / detected : 0.0; }
+        double recall() const { return references > 0 ? static_cast<double>(matched) / references : 0.0; }
+        double f1() const
+        {
+            const double sum = precision() + recall();
+            return sum > 0.0 ? 2.0 * precision() * recall() / sum : 0.0;
+        }
+        double onsetMeanMs() const { return matched > 0 ? onsetMs / matched : 0.0; }
+        double nsPerSample() const
+        {
+            const double ticksPerNs = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) * 1.0e-9;
+            return samples > 0 ? static_cast<double>(elapsedTicks) / ticksPerNs / static_cast<double>(samples) : 0.0;
+        }
+    };
+
+    struct Run
+    {
+        Combination combination;
+        Score score;
+    };
+
+    struct Options
+    {
+        int threads = juce::SystemStats::getNumCpus();
+        double target = 0.9;
+        double onsetToleranceMs = 150.0;
+        int top = 10;
+        juce::File cacheFile;
+        juce::File presetFile;
+        std::vector<float> execFreqs { 60.0f, 100.0f, 200.0f, 400.0f };
+        std::vector<float> maxBins { 4.0f, 8.0f, 16.0f, 32.0f };
+        std::vector<float> medianSizes { 1.0f, 3.0f, 7.0f, 15.0f };
+        std::vector<float> peakThresholds { 0.3f, 0.5f, 0.7f };
+        std::vector<float> downSamples { 1.0f, 2.0f, 4.0f };
+        OfflineTranscriber::Settings settings = OfflineTranscriber::getDefaultSettings();
+        juce::StringArray inputs;
+    };
+
+    bool parseList(const juce::String& text, std::vector<float>& values)
+    {
+        values.clear();
+        for (const auto& token : juce::StringArray::fromTokens(text, ",", ""))
+            if (token.trim().isNotEmpty())
+                values.push_back(token.getFloatValue());
+        return !values.empty();
+    }
+
+    bool parseArguments(const juce::StringArray& args, Options& options)
+    {
+        auto& detector = options.settings.detector;
+        const auto cwd = juce::File::getCurrentWorkingDirectory();
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+            bool ok = true;
+            if (arg == "--threads" && hasValue)
+                options.threads = std::max(1, args[++i].getIntValue());
+            else if (arg == "--target" && hasValue)
+                options.target = args[++i].getDoubleValue();
+            else if (arg == "--onset-ms" && hasValue)
+                options.onsetToleranceMs = args[++i].getDoubleValue();
+            else if (arg == "--top" && hasValue)
+                options.top = std::max(1, args[++i].getIntValue());
+            else if (arg == "--cache" && hasValue)
+                options.cacheFile = cwd.getChildFile(args[++i]);
+            else if (arg == "--preset" && hasValue)
+                options.presetFile = cwd.getChildFile(args[++i]);
+            else if (arg == "--exec" && hasValue)
+                ok = parseList(args[++i], options.execFreqs);
+            else if (arg == "--bins" && hasValue)
+                ok = parseList(args[++i], options.maxBins);
+            else if (arg == "--median" && hasValue)
+                ok = parseList(args[++i], options.medianSizes);
+            else if (arg == "--peak" && hasValue)
+                ok = parseList(args[++i], options.peakThresholds);
+            else if (arg == "--downsample" && hasValue)
+                ok = parseList(args[++i], options.downSamples);
+            else if (arg == "--block" && hasValue)
+                options.settings.blockSize = std::max(1, args[++i].getIntValue());
+            else if (arg == "--gain" && hasValue)
+                options.settings.gain = args[++i].getFloatValue();
+            else if (arg == "--min-freq" && hasValue)
+                detector.minFreq = args[++i].getFloatValue();
+            else if (arg == "--max-freq" && hasValue)
+                detector.maxFreq = args[++i].getFloatValue();
+            else if (arg == "--min-note-ms" && hasValue)
+                options.settings.minNoteSeconds = args[++i].getFloatValue() * 0.001f;
+            else if (arg == "--min-velocity" && hasValue)
+                options.settings.minVelocity = juce::jlimit(0, 127, args[++i].getIntValue());
+            else if (!arg.startsWith("--"))
+                options.inputs.add(arg);
+            else
+                ok = false;
+
+            if (!ok)
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+                return false;
+            }
+        }
+        return !options.inputs.isEmpty() || options.cacheFile.existsAsFile();
+    }
+
+    std::vector<Combination> createGrid(const Options& options)
+    {
+        std::vector<Combination> grid;
+        for (auto execFreq : options.execFreqs)
+            for (auto bins : options.maxBins)
+                for (auto median : options.medianSizes)
+                    for (auto peak : options.peakThresholds)
+                        for (auto downSample : options.downSamples)
+                            grid.push_back({ execFreq, juce::roundToInt(bins), juce::roundToInt(median), peak, juce::roundToInt(downSample) });
+        return grid;
+    }
+
+    OfflineTranscriber::Settings applyCombination(OfflineTranscriber::Settings settings, const Combination& c)
+    {
+        settings.detector.execFreq = c.execFreq;
+        settings.detector.maxBinsPerOctave = c.maxBinsPerOctave;
+        settings.detector.medianSize = c.medianSize;
+        settings.detector.peakThreshold = c.peakThreshold;
+        settings.detector.downSample = c.downSample;
+        settings.detector.autoDownSample = false;
+        return settings;
+    }
+
+    // Every note of every track, paired with its note-off and sorted by onset.
+    bool readReferenceNotes(const juce::File& midiFile, double sampleRate, std::vector<ReferenceNote>& notes)
+    {
+        juce::FileInputStream stream(midiFile);
+        juce::MidiFile midi;
+        if (!stream.openedOk() || !midi.readFrom(stream))
+            return false;
+        midi.convertTimestampTicksToSeconds();
+
+        for (int track = 0; track < midi.getNumTracks(); ++track)
+        {
+            juce::MidiMessageSequence sequence(*midi.getTrack(track));
+            sequence.updateMatchedPairs();
+            for (int i = 0; i < sequence.getNumEvents(); ++i)
+            {
+                const auto& message = sequence.getEventPointer(i)->message;
+                if (!message.isNoteOn())
+                    continue;
+                const double on = message.getTimeStamp();
+                const double off = std::max(on, sequence.getTimeOfMatchingKeyUp(i));
+                notes.push_back({ message.getNoteNumber(), static_cast<juce::int64>(on * sampleRate), static_cast<juce::int64>(off * sampleRate) });
+            }
+        }
+        std::sort(notes.begin(), notes.end(), [](const ReferenceNote& a, const ReferenceNote& b) { return a.onSample < b.onSample; });
+        return true;
+    }
+
+    // Downmixes the way the plugin does, leaving the gain to the transcriber.
+    void decodeTake(Take& take, juce::AudioFormatManager& formats)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(take.file));
+        if (reader == nullptr || reader->sampleRate <= 0.0 || reader->numChannels == 0)
+        {
+            take.error = "could not read";
+            return;
+        }
+        if (reader->lengthInSamples > std::numeric_limits<int>::max())
+        {
+            take.error = "too long";
+            return;
+        }
+
+        const int numChannels = static_cast<int>(reader->numChannels);
+        const int numSamples = static_cast<int>(reader->lengthInSamples);
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        if (!reader->read(&buffer, 0, numSamples, 0, true, true))
+        {
+            take.error = "decode failed";
+            return;
+        }
+
+        take.sampleRate = reader->sampleRate;
+        take.numSamples = numSamples;
+        take.decoded.assign(static_cast<size_t>(numSamples), 0.0f);
+        for (int channel = 0; channel < numChannels; ++channel)
+            juce::FloatVectorOperations::add(take.decoded.data(), buffer.getReadPointer(channel), numSamples);
+        juce::FloatVectorOperations::multiply(take.decoded.data(), 1.0f / static_cast<float>(numChannels), numSamples);
+
+        if (!readReferenceNotes(take.file.withFileExtension("mid"), take.sampleRate, take.notes))
+            take.error = "no reference " + take.file.withFileExtension("mid").getFileName();
+    }
+
+    std::vector<Take> collectTakes(const Options& options, const juce::String& wildcard)
+    {
+        std::vector<Take> takes;
+        for (const auto& path : options.inputs)
+        {
+            const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+            juce::Array<juce::File> found;
+            if (file.isDirectory())
+                found = file.findChildFiles(juce::File::findFiles, true, wildcard);
+            else
+                found.add(file);
+            found.sort();
+
+            for (const auto& child : found)
+            {
+                Take take;
+                take.file = child;
+                take.name = file.isDirectory() ? child.getRelativePathFrom(file) : child.getFileName();
+                takes.push_back(std::move(take));
+            }
+        }
+        return takes;
+    }
+
+    bool decodeCorpus(const Options& options, WorkStealingPool& pool, Corpus& corpus)
+    {
+        juce::AudioFormatManager wildcardFormats;
+        wildcardFormats.registerBasicFormats();
+        corpus.takes = collectTakes(options, wildcardFormats.getWildcardForAllFormats());
+
+        // Format readers are not shared between threads, so each worker keeps its own manager.
+        std::vector<std::unique_ptr<juce::AudioFormatManager>> formats;
+        for (int i = 0; i < pool.getNumWorkers(); ++i)
+        {
+            formats.push_back(std::make_unique<juce::AudioFormatManager>());
+            formats.back()->registerBasicFormats();
+        }
+        for (auto& take : corpus.takes)
+            pool.submit([&take, &formats](int workerIndex) { decodeTake(take, *formats[static_cast<size_t>(workerIndex)]); });
+        pool.waitForAll();
+
+        bool ok = true;
+        for (const auto& take : corpus.takes)
+        {
+            if (take.error.isNotEmpty())
+            {
+                std::cerr << take.file.getFullPathName() << ": " << take.error << "\n";
+                ok = false;
+            }
+        }
+        return ok && !corpus.takes.empty();
+    }
+
+    juce::int64 alignUp(juce::int64 value)
+    {
+        return (value + cacheAlignment - 1) / cacheAlignment * cacheAlignment;
+    }
+
+    // Header: magic, version, take count, then per take its name, sample rate, sample count, data
+    // offset and reference notes. The mono samples follow, each take on an aligned offset.
+    void writeCacheHeader(juce::OutputStream& out, const std::vector<Take>& takes, const std::vector<juce::int64>& offsets)
+    {
+        out.write(cacheMagic, 8);
+        out.writeInt(cacheVersion);
+        out.writeInt(static_cast<int>(takes.size()));
+        for (size_t i = 0; i < takes.size(); ++i)
+        {
+            const auto& take = takes[i];
+            out.writeString(take.name);
+            out.writeDouble(take.sampleRate);
+            out.writeInt64(take.numSamples);
+            out.writeInt64(offsets[i]);
+            out.writeInt(static_cast<int>(take.notes.size()));
+            for (const auto& note : take.notes)
+            {
+                out.writeInt(note.note);
+                out.writeInt64(note.onSample);
+                out.writeInt64(note.offSample);
+            }
+        }
+    }
+
+    bool writeCache(const juce::File& file, const std::vector<Take>& takes)
+    {
+        // The header's size does not depend on the offsets it holds, so measure it first.
+        std::vector<juce::int64> offsets(takes.size(), 0);
+        juce::MemoryOutputStream header;
+        writeCacheHeader(header, takes, offsets);
+        juce::int64 offset = alignUp(static_cast<juce::int64>(header.getDataSize()));
+        for (size_t i = 0; i < takes.size(); ++i)
+        {
+            offsets[i] = offset;
+            offset = alignUp(offset + takes[i].numSamples * static_cast<juce::int64>(sizeof(float)));
+        }
+        header.reset();
+        writeCacheHeader(header, takes, offsets);
+
+        if (!file.getParentDirectory().createDirectory())
+            return false;
+        juce::FileOutputStream out(file);
+        if (!out.openedOk())
+            return false;
+        out.setPosition(0);
+        out.truncate();
+        out.write(header.getData(), header.getDataSize());
+        for (size_t i = 0; i < takes.size(); ++i)
+        {
+            out.writeRepeatedByte(0, static_cast<size_t>(offsets[i] - out.getPosition()));
+            out.write(takes[i].decoded.data(), static_cast<size_t>(takes[i].numSamples) * sizeof(float));
+        }
+        out.flush();
+        return out.getStatus().wasOk();
+    }
+
+    bool mapCache(const juce::File& file, Corpus& corpus)
+    {
+        corpus.cache = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+        const auto* data = static_cast<const char*>(corpus.cache->getData());
+        const auto size = static_cast<juce::int64>(corpus.cache->getSize());
+        if (data == nullptr || size < 16 || std::memcmp(data, cacheMagic, 8) != 0)
+            return false;
+
+        juce::MemoryInputStream in(data, static_cast<size_t>(size), false);
+        in.skipNextBytes(8);
+        const int version = in.readInt();
+        const int numTakes = in.readInt();
+        if (version != cacheVersion || numTakes <= 0)
+            return false;
+
+        for (int i = 0; i < numTakes; ++i)
+        {
+            Take take;
+            take.name = in.readString();
+            take.sampleRate = in.readDouble();
+            take.numSamples = in.readInt64();
+            const juce::int64 offset = in.readInt64();
+            const int numNotes = in.readInt();
+            if (take.sampleRate <= 0.0 || take.numSamples <= 0 || numNotes < 0 || offset % cacheAlignment != 0
+                || offset + take.numSamples * static_cast<juce::int64>(sizeof(float)) > size || in.isExhausted())
+                return false;
+
+            for (int n = 0; n < numNotes; ++n)
+            {
+                ReferenceNote note;
+                note.note = in.readInt();
+                note.onSample = in.readInt64();
+                note.offSample = in.readInt64();
+                take.notes.push_back(note);
+            }
+            take.mapped = reinterpret_cast<const float*>(data + offset);
+            corpus.takes.push_back(std::move(take));
+        }
+        return true;
+    }
+
+    // Matches each reference note to the first unused detected note of the same pitch starting
+    // between 50 ms before it and the onset tolerance after it.
+    void scoreNotes(const Take& take, const std::vector<OfflineTranscriber::Event>& events, double onsetToleranceMs, Score& score)
+    {
+        const auto before = static_cast<juce::int64>(0.05 * take.sampleRate);
+        const auto after = static_cast<juce::int64>(onsetToleranceMs * 0.001 * take.sampleRate);
+        std::vector<bool> used(events.size(), false);
+
+        score.references += static_cast<int>(take.notes.size());
+        score.detected += static_cast<int>(std::count_if(events.begin(), events.end(),
+                                                         [](const OfflineTranscriber::Event& e) { return e.noteOn; }));
+        for (const auto& reference : take.notes)
+        {
+            for (size_t i = 0; i < events.size(); ++i)
+            {
+                const auto& event = events[i];
+                if (used[i] || !event.noteOn || event.note != reference.note
+                    || event.samplePosition < reference.onSample - before || event.samplePosition > reference.onSample + after)
+                    continue;
+
+                used[i] = true;
+                score.matched++;
+                score.onsetMs += static_cast<double>(event.samplePosition - reference.onSample) * 1000.0 / take.sampleRate;
+                break;
+            }
+        }
+    }
+
+    void runCombination(const std::vector<Take>& takes, const OfflineTranscriber::Settings& settings, double onsetToleranceMs, Score& score)
+    {
+        OfflineTranscriber transcriber;
+        std::vector<OfflineTranscriber::Event> events;
+        for (const auto& take : takes)
+        {
+            transcriber.prepare(take.sampleRate, settings);
+            events.clear();
+
+            const auto* samples = take.getSamples();
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (juce::int64 position = 0; position < take.numSamples; position += settings.blockSize)
+            {
+                const float* block = samples + position;
+                const int count = static_cast<int>(std::min<juce::int64>(settings.blockSize, take.numSamples - position));
+                transcriber.processBlock(&block, 1, count, events);
+            }
+            score.elapsedTicks += juce::Time::getHighResolutionTicks() - start;
+            score.samples += take.numSamples;
+
+            scoreNotes(take, events, onsetToleranceMs, score);
+        }
+    }
+
+    // The subset of the plugin's parameter tree that the sweep decides; replaceState() leaves the
+    // other parameters at their defaults.
+    juce::ValueTree createPluginState(const OfflineTranscriber::Settings& settings)
+    {
+        const auto& detector = settings.detector;
+        juce::ValueTree state("PARAMS");
+        auto add = [&state](const char* id, float value)
+        {
+            juce::ValueTree parameter("PARAM");
+            parameter.setProperty("id", id, nullptr);
+            parameter.setProperty("value", value, nullptr);
+            state.appendChild(parameter, nullptr);
+        };
+        add("minFreq", detector.minFreq);
+        add("maxFreq", detector.maxFreq);
+        add("execFreq", detector.execFreq);
+        add("maxBins", static_cast<float>(detector.maxBinsPerOctave));
+        add("median", static_cast<float>(detector.medianSize));
+        add("peakThresh", detector.peakThreshold);
+        add("downSample", static_cast<float>(detector.downSample));
+        add("autoDownSample", detector.autoDownSample ? 1.0f : 0.0f);
+        add("antiAlias", detector.antiAliasDownSample ? 1.0f : 0.0f);
+        add("clarity", detector.clarity ? 1.0f : 0.0f);
+        add("ampScale", settings.gain);
+        add("minVelocity", static_cast<float>(settings.minVelocity));
+        add("delay", settings.minNoteSeconds);
+        return state;
+    }
+
+    bool writePreset(const juce::File& file, const OfflineTranscriber::Settings& settings)
+    {
+        const auto state = createPluginState(settings);
+        if (!file.getParentDirectory().createDirectory())
+            return false;
+        if (file.hasFileExtension("xml"))
+        {
+            const auto xml = state.createXml();
+            return xml != nullptr && xml->writeTo(file);
+        }
+        juce::MemoryOutputStream data;
+        state.writeToStream(data);
+        return file.replaceWithData(data.getData(), data.getDataSize());
+    }
+
+    juce::String describe(const Combination& c)
+    {
+        return juce::String(c.execFreq, 0).paddedLeft(' ', 6)
+             + juce::String(c.maxBinsPerOctave).paddedLeft(' ', 6)
+             + juce::String(c.medianSize).paddedLeft(' ', 8)
+             + juce::String(c.peakThreshold, 2).paddedLeft(' ', 6)
+             + juce::String(c.downSample).paddedLeft(' ', 6);
+    }
+
+    void printRun(const Run& run)
+    {
+        const auto& s = run.score;
+        std::cout << describe(run.combination)
+                  << juce::String(s.f1(), 3).paddedLeft(' ', 8)
+                  << juce::String(s.precision(), 3).paddedLeft(' ', 8)
+                  << juce::String(s.recall(), 3).paddedLeft(' ', 8)
+                  << juce::String(s.onsetMeanMs(), 1).paddedLeft(' ', 10)
+                  << juce::String(s.nsPerSample(), 2).paddedLeft(' ', 11) << "\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    Options options;
+    if (!parseArguments(args, options))
+    {
+        std::cerr << "Usage: myk-param-sweep [options] <file or directory> ...\n";
+        return 2;
+    }
+
+    WorkStealingPool pool(options.threads);
+    Corpus corpus;
+    const auto loadStart = juce::Time::getHighResolutionTicks();
+    if (options.cacheFile.existsAsFile())
+    {
+        if (!mapCache(options.cacheFile, corpus))
+        {
+            std::cerr << options.cacheFile.getFullPathName() << ": not a sweep cache\n";
+            return 1;
+        }
+    }
+    else
+    {
+        if (!decodeCorpus(options, pool, corpus))
+        {
+            std::cerr << "Could not load the corpus\n";
+            return 1;
+        }
+        if (options.cacheFile != juce::File() && !writeCache(options.cacheFile, corpus.takes))
+        {
+            std::cerr << "Could not write " << options.cacheFile.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+    const double loadSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - loadStart);
+
+    double audioSeconds = 0.0;
+    int references = 0;
+    for (const auto& take : corpus.takes)
+    {
+        audioSeconds += static_cast<double>(take.numSamples) / take.sampleRate;
+        references += static_cast<int>(take.notes.size());
+    }
+    std::cout << corpus.takes.size() << " take(s), " << juce::String(audioSeconds, 1) << " s of audio, "
+              << references << " reference note(s), " << (corpus.cache != nullptr ? "mapped" : "decoded")
+              << " in " << juce::String(loadSeconds, 2) << " s\n";
+
+    const auto grid = createGrid(options);
+    std::vector<Run> runs(grid.size());
+    const auto sweepStart = juce::Time::getHighResolutionTicks();
+    for (size_t i = 0; i < grid.size(); ++i)
+    {
+        runs[i].combination = grid[i];
+        pool.submit([&corpus, &options, &run = runs[i]](int)
+        {
+            runCombination(corpus.takes, applyCombination(options.settings, run.combination), options.onsetToleranceMs, run.score);
+        });
+    }
+    pool.waitForAll();
+    const double sweepSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - sweepStart);
+    std::cout << runs.size() << " combination(s) in " << juce::String(sweepSeconds, 2) << " s on "
+              << pool.getNumWorkers() << " worker(s)\n";
+
+    std::vector<const Run*> passing;
+    for (const auto& run : runs)
+        if (run.score.f1() >= options.target)
+            passing.push_back(&run);
+    std::sort(passing.begin(), passing.end(), [](const Run* a, const Run* b) { return a->score.nsPerSample() < b->score.nsPerSample(); });
+
+    std::cout << "  exec  bins  median  peak  down      F1    prec     rec  onset ms  ns/sample\n";
+    const Run* chosen = nullptr;
+    if (passing.empty())
+    {
+        chosen = &*std::max_element(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.score.f1() < b.score.f1(); });
+        printRun(*chosen);
+        std::cout << "No combination reaches F1 " << juce::String(options.target, 3) << "; the most accurate is shown\n";
+    }
+    else
+    {
+        for (size_t i = 0; i < std::min(passing.size(), static_cast<size_t>(options.top)); ++i)
+            printRun(*passing[i]);
+        chosen = passing.front();
+        std::cout << passing.size() << " combination(s) reach F1 " << juce::String(options.target, 3)
+                  << "; the cheapest is first\n";
+    }
+
+    if (options.presetFile != juce::File())
+    {
+        if (!writePreset(options.presetFile, applyCombination(options.settings, chosen->combination)))
+        {
+            std::cerr << "Could not write " << options.presetFile.getFullPathName() << "\n";
+            return 1;
+        }
+        std::cout << "Wrote " << options.presetFile.getFullPathName() << "\n";
+    }
+    return passing.empty() ? 1 : 0;
+}
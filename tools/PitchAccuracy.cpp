@@ -0,0 +1,688 @@
+// Accuracy-versus-cost regression suite for PitchDetector and NoteSegmenter, built without the plugin.
+//
+//   myk-pitch-accuracy [--rate 48000] [--block 256] [--seconds 2] [--min-note-ms 50] [--tolerance 1]
+//                      [--onset-tolerance 5] [--json results.json] [--csv results.csv] [--svg pareto.svg]
+//
+// Generates a deterministic corpus with known pitch and note boundaries (pure and harmonic tones,
+// vibrato, glides, a harmonic tone in noise at set SNRs, note sequences and noise alone), runs every
+// configuration over it and reports pitch and note accuracy next to the detector's cost per sample.
+// Configurations marked as features are performance options that must not cost accuracy: the run
+// exits with 1 if any of them is worse than the baseline by more than the tolerances. The others
+// are presets that trade accuracy for cost and only feed the Pareto chart.
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "NoteSegmenter.h"
+#include "PitchDetector.h"
+
+namespace
+{
+    // A detection more than this far from the reference counts as a gross error.
+    constexpr double grossErrorCents = 50.0;
+
+    struct ReferenceNote
+    {
+        int note = 0;
+        juce::int64 onSample = 0;
+        juce::int64 offSample = 0;
+    };
+
+    struct Signal
+    {
+        juce::String name;
+        std::vector<float> samples;
+        // Reference fundamental per sample, 0 where nothing is sounding.
+        std::vector<float> truth;
+        std::vector<ReferenceNote> notes;
+    };
+
+    struct Config
+    {
+        juce::String name;
+        // Performance options are gated against the baseline, presets are not.
+        bool feature = false;
+        std::function<void(PitchDetector::Settings&)> apply;
+    };
+
+    struct Options
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 256;
+        double seconds = 2.0;
+        // NoteSegmenter's minimum note length, which also bridges the gaps between hops.
+        double minNoteMs = 50.0;
+        double tolerancePercent = 1.0;
+        double onsetToleranceMs = 5.0;
+        juce::File jsonFile;
+        juce::File csvFile;
+        juce::File svgFile;
+    };
+
+    struct Score
+    {
+        juce::int64 voicedFrames = 0;
+        juce::int64 voicedDetections = 0;
+        juce::int64 correct = 0;
+        juce::int64 gross = 0;
+        juce::int64 octave = 0;
+        juce::int64 unvoicedDetections = 0;
+        double unvoicedSeconds = 0.0;
+        double fineCents = 0.0;
+
+        int notes = 0;
+        int notesMatched = 0;
+        int notesExtra = 0;
+        int offsetsMatched = 0;
+        double onsetMs = 0.0;
+        double onsetMaxMs = 0.0;
+        double offsetMs = 0.0;
+
+        juce::int64 elapsedTicks = 0;
+        juce::int64 samples = 0;
+
+        void add(const Score& other)
+        {
+            voicedFrames += other.voicedFrames;
+            voicedDetections += other.voicedDetections;
+            correct += other.correct;
+            gross += other.gross;
+            octave += other.octave;
+            unvoicedDetections += other.unvoicedDetections;
+            unvoicedSeconds += other.unvoicedSeconds;
+            fineCents += other.fineCents;
+            notes += other.notes;
+            notesMatched += other.notesMatched;
+            notesExtra += other.notesExtra;
+            offsetsMatched += other.offsetsMatched;
+            onsetMs += other.onsetMs;
+            onsetMaxMs = std::max(onsetMaxMs, other.onsetMaxMs);
+            offsetMs += other.offsetMs;
+            elapsedTicks += other.elapsedTicks;
+            samples += other.samples;
+        }
+
+        // Voiced frames that were either missed or more than grossErrorCents off.
+        double pitchErrorPercent() const { return voicedFrames > 0 ? juce::jlimit(0.0, 100.0, 100.0 * (1.0 - static_cast<double>(correct) / static_cast<double>(voicedFrames))) : 0.0; }
+        double grossErrorPercent() const { return voicedDetections > 0 ? 100.0 * static_cast<double>(gross) / static_cast<double>(voicedDetections) : 0.0; }
+        double octaveErrorPercent() const { return voicedDetections > 0 ? 100.0 * static_cast<double>(octave) / static_cast<double>(voicedDetections) : 0.0; }
+        double recallPercent() const { return voicedFrames > 0 ? std::min(100.0, 100.0 * static_cast<double>(voicedDetections) / static_cast<double>(voicedFrames)) : 0.0; }
+        double fineErrorCents() const { return correct > 0 ? fineCents / static_cast<double>(correct) : 0.0; }
+        double falseDetectionsPerSecond() const { return unvoicedSeconds > 0.0 ? static_cast<double>(unvoicedDetections) / unvoicedSeconds : 0.0; }
+        int notesMissed() const { return notes - notesMatched; }
+        double onsetMeanMs() const { return notesMatched > 0 ? onsetMs / notesMatched : 0.0; }
+        double offsetMeanMs() const { return offsetsMatched > 0 ? offsetMs / offsetsMatched : 0.0; }
+
+        double nsPerSample() const
+        {
+            const double ticksPerNs = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) * 1.0e-9;
+            return samples > 0 ? static_cast<double>(elapsedTicks) / ticksPerNs / static_cast<double>(samples) : 0.0;
+        }
+    };
+
+    struct Result
+    {
+        Config config;
+        Score total;
+        std::vector<Score> perSignal;
+        bool paretoOptimal = false;
+    };
+
+    float midiToFreq(int note)
+    {
+        return 440.0f * std::pow(2.0f, static_cast<float>(note - 69) / 12.0f);
+    }
+
+    // Sums the given partial amplitudes over the fundamental in truth, scaled by gain. Partials at or
+    // above Nyquist are skipped so the material never aliases.
+    void renderPartials(Signal& signal, const std::vector<float>& gain, const std::vector<double>& partials, double sampleRate)
+    {
+        const double twoPi = juce::MathConstants<double>::twoPi;
+        double phase = 0.0;
+        for (size_t i = 0; i < signal.samples.size(); ++i)
+        {
+            const double freq = signal.truth[i];
+            phase = std::fmod(phase + twoPi * freq / sampleRate, twoPi);
+            double value = 0.0;
+            for (size_t k = 0; k < partials.size(); ++k)
+            {
+                const double harmonic = static_cast<double>(k + 1);
+                if (freq * harmonic < 0.5 * sampleRate)
+                    value += partials[k] * std::sin(harmonic * phase);
+            }
+            signal.samples[i] += gain[i] * static_cast<float>(value);
+        }
+    }
+
+    // White noise at snrDb below the RMS of the sounding part of the signal.
+    void addNoise(Signal& signal, double snrDb, int seed)
+    {
+        double sum = 0.0;
+        juce::int64 count = 0;
+        for (size_t i = 0; i < signal.samples.size(); ++i)
+        {
+            if (signal.truth[i] > 0.0f)
+            {
+                sum += static_cast<double>(signal.samples[i]) * signal.samples[i];
+                count++;
+            }
+        }
+        const double signalRms = count > 0 ? std::sqrt(sum / static_cast<double>(count)) : 0.1;
+        // Uniform noise in [-a, a] has an RMS of a / sqrt(3).
+        const auto amplitude = static_cast<float>(signalRms / std::pow(10.0, snrDb / 20.0) * std::sqrt(3.0));
+        juce::Random random(seed);
+        for (auto& sample : signal.samples)
+            sample += amplitude * (random.nextFloat() * 2.0f - 1.0f);
+    }
+
+    Signal makeEmpty(const juce::String& name, size_t length)
+    {
+        return { name, std::vector<float>(length, 0.0f), std::vector<float>(length, 0.0f), {} };
+    }
+
+    Signal makeTone(const juce::String& name, size_t length, double sampleRate, const std::vector<double>& partials,
+                    const std::function<double(double)>& freqAt)
+    {
+        auto signal = makeEmpty(name, length);
+        for (size_t i = 0; i < length; ++i)
+            signal.truth[i] = static_cast<float>(freqAt(static_cast<double>(i) / sampleRate));
+        renderPartials(signal, std::vector<float>(length, 0.5f), partials, sampleRate);
+        return signal;
+    }
+
+    // Notes of noteSeconds with gapSeconds of silence after each, with short linear ramps so the
+    // onsets do not click. A gap of 0 gives a legato line of note changes.
+    Signal makeSequence(const juce::String& name, size_t length, double sampleRate, const std::vector<int>& notes,
+                        double noteSeconds, double gapSeconds)
+    {
+        auto signal = makeEmpty(name, length);
+        std::vector<float> gain(length, 0.0f);
+        const auto noteLength = static_cast<juce::int64>(noteSeconds * sampleRate);
+        const auto gapLength = static_cast<juce::int64>(gapSeconds * sampleRate);
+        const auto ramp = static_cast<juce::int64>(0.005 * sampleRate);
+        juce::int64 start = static_cast<juce::int64>(0.1 * sampleRate);
+        for (size_t n = 0; start + noteLength <= static_cast<juce::int64>(length); ++n)
+        {
+            const int note = notes[n % notes.size()];
+            signal.notes.push_back({ note, start, start + noteLength });
+            for (juce::int64 i = 0; i < noteLength; ++i)
+            {
+                const auto index = static_cast<size_t>(start + i);
+                signal.truth[index] = midiToFreq(note);
+                const auto edge = std::min(i, noteLength - 1 - i);
+                gain[index] = gapLength > 0 ? 0.4f * std::min(1.0f, static_cast<float>(edge) / static_cast<float>(ramp)) : 0.4f;
+            }
+            start += noteLength + gapLength;
+        }
+        renderPartials(signal, gain, { 1.0, 0.5, 0.33, 0.25, 0.2 }, sampleRate);
+        return signal;
+    }
+
+    std::vector<Signal> makeCorpus(double sampleRate, double seconds)
+    {
+        const auto length = static_cast<size_t>(sampleRate * seconds);
+        const std::vector<double> pure { 1.0 };
+        const std::vector<double> sawLike { 1.0, 0.5, 0.33, 0.25, 0.2, 0.17, 0.14, 0.12 };
+        const std::vector<double> weakFundamental { 0.15, 1.0, 0.7, 0.5, 0.3 };
+        const std::vector<int> melody { 40, 45, 52, 57, 62, 69, 76, 81 };
+        std::vector<Signal> corpus;
+
+        for (double freq : { 82.41, 220.0, 440.0, 1000.0 })
+            corpus.push_back(makeTone("pure " + juce::String(freq, 0), length, sampleRate, pure, [=](double) { return freq; }));
+
+        corpus.push_back(makeTone("harmonic 110", length, sampleRate, sawLike, [](double) { return 110.0; }));
+        corpus.push_back(makeTone("weak fundamental 330", length, sampleRate, weakFundamental, [](double) { return 330.0; }));
+
+        for (double freq : { 220.0, 660.0 })
+            corpus.push_back(makeTone("vibrato " + juce::String(freq, 0), length, sampleRate, sawLike, [=](double t)
+            {
+                return freq * std::pow(2.0, 0.5 / 12.0 * std::sin(juce::MathConstants<double>::twoPi * 5.5 * t));
+            }));
+
+        corpus.push_back(makeTone("glide up", length, sampleRate, sawLike, [=](double t) { return 100.0 * std::pow(8.0, t / seconds); }));
+        corpus.push_back(makeTone("glide down", length, sampleRate, sawLike, [=](double t) { return 1200.0 * std::pow(0.125, t / seconds); }));
+
+        int seed = 1000;
+        for (double snr : { 30.0, 20.0, 10.0, 0.0 })
+        {
+            auto noisy = makeTone("snr " + juce::String(snr, 0) + "dB", length, sampleRate, sawLike, [](double) { return 220.0; });
+            addNoise(noisy, snr, seed++);
+            corpus.push_back(std::move(noisy));
+        }
+
+        corpus.push_back(makeSequence("notes", length, sampleRate, melody, 0.3, 0.1));
+        corpus.push_back(makeSequence("notes legato", length, sampleRate, melody, 0.25, 0.0));
+        auto noisyNotes = makeSequence("notes snr 20dB", length, sampleRate, melody, 0.3, 0.1);
+        addNoise(noisyNotes, 20.0, seed++);
+        corpus.push_back(std::move(noisyNotes));
+
+        auto noise = makeEmpty("noise", length);
+        juce::Random random(seed);
+        for (auto& sample : noise.samples)
+            sample = 0.1f * (random.nextFloat() * 2.0f - 1.0f);
+        corpus.push_back(std::move(noise));
+
+        return corpus;
+    }
+
+    PitchDetector::Settings makeBaselineSettings()
+    {
+        // The plugin's defaults with a 10 ms hop (its default execFreq is clamped up to minFreq), and
+        // the scalar kernel as the reference sum order.
+        PitchDetector::Settings settings;
+        settings.execFreq = 100.0f;
+        settings.medianSize = 7;
+        settings.clarity = true;
+        settings.scalarKernel = true;
+        return settings;
+    }
+
+    std::vector<Config> makeConfigs()
+    {
+        return {
+            { "baseline", false, [](PitchDetector::Settings&) {} },
+            { "simd", true, [](PitchDetector::Settings& s) { s.scalarKernel = false; } },
+            { "fft", true, [](PitchDetector::Settings& s) { s.fftCorrelation = true; } },
+            { "incremental", true, [](PitchDetector::Settings& s) { s.incremental = true; } },
+            { "tracking", true, [](PitchDetector::Settings& s) { s.tracking = true; } },
+            { "coarse 2", true, [](PitchDetector::Settings& s) { s.coarseFactor = 2; } },
+            { "coarse 4", true, [](PitchDetector::Settings& s) { s.coarseFactor = 4; } },
+            { "simd+incremental+tracking", true, [](PitchDetector::Settings& s) { s.scalarKernel = false; s.incremental = true; s.tracking = true; } },
+            { "downsample 2", false, [](PitchDetector::Settings& s) { s.downSample = 2; } },
+            { "downsample 4", false, [](PitchDetector::Settings& s) { s.downSample = 4; } },
+            { "auto downsample", false, [](PitchDetector::Settings& s) { s.autoDownSample = true; } },
+            { "anti-alias 2", false, [](PitchDetector::Settings& s) { s.downSample = 2; s.antiAliasDownSample = true; } },
+            // execFreq is clamped to [minFreq, maxFreq], so 60 is the slowest hop rate here.
+            { "exec 60", false, [](PitchDetector::Settings& s) { s.execFreq = 60.0f; } },
+            // A 60 Hz hop spans three 256-sample callbacks, so it is the one that can be sliced.
+            { "exec 60 slices 3", false, [](PitchDetector::Settings& s) { s.execFreq = 60.0f; s.analysisSlices = 3; } },
+            { "exec 200", false, [](PitchDetector::Settings& s) { s.execFreq = 200.0f; } },
+            { "exec 400", false, [](PitchDetector::Settings& s) { s.execFreq = 400.0f; } },
+            { "bins 8", false, [](PitchDetector::Settings& s) { s.maxBinsPerOctave = 8; } },
+            { "bins 32", false, [](PitchDetector::Settings& s) { s.maxBinsPerOctave = 32; } },
+            { "median 1", false, [](PitchDetector::Settings& s) { s.medianSize = 1; } },
+            { "yin", false, [](PitchDetector::Settings& s) { s.engine = PitchDetector::Settings::Engine::yin; } },
+            { "yin downsample 2", false, [](PitchDetector::Settings& s) { s.engine = PitchDetector::Settings::Engine::yin; s.downSample = 2; } },
+        };
+    }
+
+    // Matches each reference note to the first note-on of the same pitch between 50 ms before its
+    // onset and its offset, then to the next note-off of that pitch. Times are in input samples with
+    // the detector's reported latency already removed.
+    void scoreNotes(const Signal& signal, const std::vector<std::pair<juce::int64, NoteSegmenter::Event>>& events,
+                    double sampleRate, Score& score)
+    {
+        std::vector<bool> used(events.size(), false);
+        const auto slack = static_cast<juce::int64>(0.05 * sampleRate);
+        const double msPerSample = 1000.0 / sampleRate;
+        score.notes = static_cast<int>(signal.notes.size());
+
+        for (const auto& reference : signal.notes)
+        {
+            for (size_t i = 0; i < events.size(); ++i)
+            {
+                const auto& [time, event] = events[i];
+                if (used[i] || !event.noteOn || event.note != reference.note
+                    || time < reference.onSample - slack || time > reference.offSample)
+                    continue;
+
+                used[i] = true;
+                score.notesMatched++;
+                const double onsetMs = static_cast<double>(time - reference.onSample) * msPerSample;
+                score.onsetMs += onsetMs;
+                score.onsetMaxMs = std::max(score.onsetMaxMs, std::abs(onsetMs));
+
+                for (size_t j = i + 1; j < events.size(); ++j)
+                {
+                    if (events[j].second.noteOn || events[j].second.note != reference.note)
+                        continue;
+                    used[j] = true;
+                    score.offsetsMatched++;
+                    score.offsetMs += static_cast<double>(events[j].first - reference.offSample) * msPerSample;
+                    break;
+                }
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < events.size(); ++i)
+            if (!used[i] && events[i].second.noteOn)
+                score.notesExtra++;
+    }
+
+    Score run(const Signal& signal, const PitchDetector::Settings& settings, const Options& options)
+    {
+        PitchDetector detector;
+        detector.prepare(options.sampleRate, options.blockSize, settings);
+        std::vector<PitchDetector::Detection> detections;
+        detections.reserve(128);
+
+        NoteSegmenter segmenter;
+        NoteSegmenter::Settings segmenterSettings;
+        segmenterSettings.minNoteLengthSamples = static_cast<juce::int64>(options.minNoteMs * 0.001 * options.sampleRate);
+        std::vector<NoteSegmenter::Event> blockEvents;
+        std::vector<std::pair<juce::int64, NoteSegmenter::Event>> events;
+
+        // A detection describes the analysis window ending at it: the reference is taken at the
+        // window centre, moved back by the median filter's delay of half its length in hops, and
+        // only windows that are wholly sounding or wholly silent are scored.
+        const auto total = static_cast<juce::int64>(signal.samples.size());
+        const auto windowLength = static_cast<juce::int64>(2.0 * options.sampleRate / std::max(1.0f, settings.minFreq));
+        const auto hop = static_cast<juce::int64>(options.sampleRate / std::max(1.0f, settings.execFreq));
+        const auto referenceDelay = windowLength / 2 + (settings.medianSize / 2) * hop;
+        const auto latency = static_cast<juce::int64>(detector.getLatencySamples());
+        std::vector<juce::int64> voicedPrefix(signal.samples.size() + 1, 0);
+        for (size_t i = 0; i < signal.samples.size(); ++i)
+            voicedPrefix[i + 1] = voicedPrefix[i] + (signal.truth[i] > 0.0f ? 1 : 0);
+        auto voicedIn = [&](juce::int64 end)
+        {
+            const auto first = std::max<juce::int64>(0, end - windowLength + 1);
+            return voicedPrefix[static_cast<size_t>(end + 1)] - voicedPrefix[static_cast<size_t>(first)];
+        };
+        auto isVoiced = [&](juce::int64 end) { return end >= windowLength - 1 && voicedIn(end) == windowLength; };
+        auto isUnvoiced = [&](juce::int64 end) { return voicedIn(end) == 0; };
+
+        Score score;
+        for (juce::int64 end = hop - 1; end < total; end += hop)
+            if (isVoiced(end))
+                score.voicedFrames++;
+        for (juce::int64 end = 0; end < total; ++end)
+            if (isUnvoiced(end))
+                score.unvoicedSeconds += 1.0;
+        score.unvoicedSeconds /= options.sampleRate;
+
+        for (juce::int64 start = 0; start < total; start += options.blockSize)
+        {
+            const int count = static_cast<int>(std::min<juce::int64>(options.blockSize, total - start));
+            const float* block = signal.samples.data() + start;
+            const auto callStart = juce::Time::getHighResolutionTicks();
+            detector.processBlock(block, count, detections);
+            score.elapsedTicks += juce::Time::getHighResolutionTicks() - callStart;
+
+            for (const auto& detection : detections)
+            {
+                const auto end = start + detection.sampleOffset - latency;
+                if (end < 0)
+                    continue;
+                if (isUnvoiced(end))
+                {
+                    score.unvoicedDetections++;
+                    continue;
+                }
+                if (!isVoiced(end) || end < referenceDelay)
+                    continue;
+
+                score.voicedDetections++;
+                const double reference = signal.truth[static_cast<size_t>(end - referenceDelay)];
+                const double cents = 1200.0 * std::log2(static_cast<double>(detection.freq) / reference);
+                if (std::abs(cents) <= grossErrorCents)
+                {
+                    score.correct++;
+                    score.fineCents += std::abs(cents);
+                    continue;
+                }
+                score.gross++;
+                const double octaves = std::round(cents / 1200.0);
+                if (octaves != 0.0 && std::abs(cents - 1200.0 * octaves) <= grossErrorCents)
+                    score.octave++;
+            }
+
+            float rmsSum = 0.0f;
+            for (int i = 0; i < count; ++i)
+                rmsSum += block[i] * block[i];
+            const float rms = std::sqrt(rmsSum / static_cast<float>(count));
+            segmenter.processBlock(detections, start, options.blockSize, rms, segmenterSettings, blockEvents);
+            for (const auto& event : blockEvents)
+                events.push_back({ start + event.sampleOffset - latency, event });
+        }
+        score.samples = total;
+
+        if (!signal.notes.empty())
+            scoreNotes(signal, events, options.sampleRate, score);
+        return score;
+    }
+
+    // A result is Pareto optimal when no other result is at least as cheap and at least as accurate
+    // while being strictly better on one of the two.
+    void markParetoFront(std::vector<Result>& results)
+    {
+        for (auto& result : results)
+        {
+            const double cost = result.total.nsPerSample();
+            const double error = result.total.pitchErrorPercent();
+            result.paretoOptimal = std::none_of(results.begin(), results.end(), [&](const Result& other)
+            {
+                const double otherCost = other.total.nsPerSample();
+                const double otherError = other.total.pitchErrorPercent();
+                return otherCost <= cost && otherError <= error && (otherCost < cost || otherError < error);
+            });
+        }
+    }
+
+    juce::var toJson(const Score& score)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("nsPerSample", score.nsPerSample());
+        object->setProperty("pitchErrorPercent", score.pitchErrorPercent());
+        object->setProperty("grossErrorPercent", score.grossErrorPercent());
+        object->setProperty("octaveErrorPercent", score.octaveErrorPercent());
+        object->setProperty("recallPercent", score.recallPercent());
+        object->setProperty("fineErrorCents", score.fineErrorCents());
+        object->setProperty("falseDetectionsPerSecond", score.falseDetectionsPerSecond());
+        object->setProperty("notes", score.notes);
+        object->setProperty("notesMissed", score.notesMissed());
+        object->setProperty("notesExtra", score.notesExtra);
+        object->setProperty("onsetMeanMs", score.onsetMeanMs());
+        object->setProperty("onsetMaxMs", score.onsetMaxMs);
+        object->setProperty("offsetMeanMs", score.offsetMeanMs());
+        return juce::var(object);
+    }
+
+    juce::var toJson(const Result& result, const std::vector<Signal>& corpus)
+    {
+        auto object = toJson(result.total);
+        object.getDynamicObject()->setProperty("config", result.config.name);
+        object.getDynamicObject()->setProperty("feature", result.config.feature);
+        object.getDynamicObject()->setProperty("paretoOptimal", result.paretoOptimal);
+        auto* signals = new juce::DynamicObject();
+        for (size_t i = 0; i < corpus.size(); ++i)
+            signals->setProperty(corpus[i].name, toJson(result.perSignal[i]));
+        object.getDynamicObject()->setProperty("signals", juce::var(signals));
+        return object;
+    }
+
+    juce::String toCsv(const std::vector<Result>& results)
+    {
+        juce::String csv = "config,feature,paretoOptimal,nsPerSample,pitchErrorPercent,grossErrorPercent,octaveErrorPercent,"
+                           "recallPercent,fineErrorCents,falseDetectionsPerSecond,notesMissed,notesExtra,onsetMeanMs,offsetMeanMs\n";
+        for (const auto& r : results)
+        {
+            const auto& s = r.total;
+            csv << "\"" << r.config.name << "\"," << (r.config.feature ? 1 : 0) << "," << (r.paretoOptimal ? 1 : 0) << ","
+                << s.nsPerSample() << "," << s.pitchErrorPercent() << "," << s.grossErrorPercent() << ","
+                << s.octaveErrorPercent() << "," << s.recallPercent() << "," << s.fineErrorCents() << ","
+                << s.falseDetectionsPerSecond() << "," << s.notesMissed() << "," << s.notesExtra << ","
+                << s.onsetMeanMs() << "," << s.offsetMeanMs() << "\n";
+        }
+        return csv;
+    }
+
+    // Cost on a log axis against pitch error, with the Pareto front joined up.
+    juce::String toSvg(const std::vector<Result>& results)
+    {
+        const double width = 720.0, height = 480.0, left = 70.0, right = 200.0, top = 30.0, bottom = 50.0;
+        double minCost = 1.0e9, maxCost = 0.0, maxError = 1.0;
+        for (const auto& r : results)
+        {
+            minCost = std::min(minCost, r.total.nsPerSample());
+            maxCost = std::max(maxCost, r.total.nsPerSample());
+            maxError = std::max(maxError, r.total.pitchErrorPercent());
+        }
+        const double logMin = std::log10(std::max(1.0e-3, minCost * 0.8));
+        const double logMax = std::log10(std::max(1.0e-3, maxCost * 1.25));
+        auto x = [&](double cost) { return left + (std::log10(std::max(1.0e-3, cost)) - logMin) / std::max(1.0e-9, logMax - logMin) * (width - left - right); };
+        auto y = [&](double error) { return height - bottom - error / (maxError * 1.1) * (height - top - bottom); };
+
+        juce::String svg;
+        svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height
+            << "\" font-family=\"sans-serif\" font-size=\"11\">\n"
+            << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n"
+            << "<line x1=\"" << left << "\" y1=\"" << height - bottom << "\" x2=\"" << width - right << "\" y2=\"" << height - bottom << "\" stroke=\"black\"/>\n"
+            << "<line x1=\"" << left << "\" y1=\"" << top << "\" x2=\"" << left << "\" y2=\"" << height - bottom << "\" stroke=\"black\"/>\n"
+            << "<text x=\"" << (left + width - right) / 2 << "\" y=\"" << height - 15 << "\" text-anchor=\"middle\">cost (ns/sample, log)</text>\n"
+            << "<text x=\"15\" y=\"" << (top + height - bottom) / 2 << "\" transform=\"rotate(-90 15 " << (top + height - bottom) / 2
+            << ")\" text-anchor=\"middle\">pitch error (%)</text>\n";
+
+        std::vector<const Result*> front;
+        for (const auto& r : results)
+            if (r.paretoOptimal)
+                front.push_back(&r);
+        std::sort(front.begin(), front.end(), [](const Result* a, const Result* b) { return a->total.nsPerSample() < b->total.nsPerSample(); });
+        svg << "<polyline fill=\"none\" stroke=\"#d33\" points=\"";
+        for (const auto* r : front)
+            svg << x(r->total.nsPerSample()) << "," << y(r->total.pitchErrorPercent()) << " ";
+        svg << "\"/>\n";
+
+        for (const auto& r : results)
+        {
+            const double px = x(r.total.nsPerSample()), py = y(r.total.pitchErrorPercent());
+            svg << "<circle cx=\"" << px << "\" cy=\"" << py << "\" r=\"4\" fill=\"" << (r.paretoOptimal ? "#d33" : (r.config.feature ? "#36c" : "#888")) << "\"/>\n"
+                << "<text x=\"" << px + 6 << "\" y=\"" << py + 4 << "\">" << r.config.name << "</text>\n";
+        }
+        svg << "</svg>\n";
+        return svg;
+    }
+
+    bool parseArguments(const juce::StringArray& args, Options& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+            if (arg == "--rate" && hasValue)
+                options.sampleRate = std::max(8000.0, args[++i].getDoubleValue());
+            else if (arg == "--block" && hasValue)
+                options.blockSize = std::max(1, args[++i].getIntValue());
+            else if (arg == "--seconds" && hasValue)
+                options.seconds = std::max(1.0, args[++i].getDoubleValue());
+            else if (arg == "--min-note-ms" && hasValue)
+                options.minNoteMs = std::max(0.0, args[++i].getDoubleValue());
+            else if (arg == "--tolerance" && hasValue)
+                options.tolerancePercent = args[++i].getDoubleValue();
+            else if (arg == "--onset-tolerance" && hasValue)
+                options.onsetToleranceMs = args[++i].getDoubleValue();
+            else if (arg == "--json" && hasValue)
+                options.jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--csv" && hasValue)
+                options.csvFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--svg" && hasValue)
+                options.svgFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool write(const juce::File& file, const juce::String& text)
+    {
+        if (file == juce::File() || file.replaceWithText(text))
+            return true;
+        std::cerr << "Could not write " << file.getFullPathName() << "\n";
+        return false;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    Options options;
+    if (!parseArguments(args, options))
+        return 2;
+
+    const auto corpus = makeCorpus(options.sampleRate, options.seconds);
+    std::cout << corpus.size() << " signals of " << juce::String(options.seconds, 1) << " s at "
+              << static_cast<int>(options.sampleRate) << " Hz, block " << options.blockSize << "\n";
+    std::cout << juce::String("config").paddedRight(' ', 28)
+              << " ns/sample  pitch err %  octave %  recall %  false/s  missed  extra  onset ms  offset ms\n";
+
+    std::vector<Result> results;
+    for (const auto& config : makeConfigs())
+    {
+        auto settings = makeBaselineSettings();
+        config.apply(settings);
+
+        Result result { config, {}, {}, false };
+        for (const auto& signal : corpus)
+        {
+            result.perSignal.push_back(run(signal, settings, options));
+            result.total.add(result.perSignal.back());
+        }
+        results.push_back(std::move(result));
+    }
+    markParetoFront(results);
+
+    for (const auto& r : results)
+    {
+        const auto& s = r.total;
+        std::cout << (r.config.name + (r.paretoOptimal ? " *" : "")).paddedRight(' ', 28)
+                  << juce::String(s.nsPerSample(), 2).paddedLeft(' ', 10)
+                  << juce::String(s.pitchErrorPercent(), 2).paddedLeft(' ', 13)
+                  << juce::String(s.octaveErrorPercent(), 2).paddedLeft(' ', 10)
+                  << juce::String(s.recallPercent(), 1).paddedLeft(' ', 10)
+                  << juce::String(s.falseDetectionsPerSecond(), 2).paddedLeft(' ', 9)
+                  << juce::String(s.notesMissed()).paddedLeft(' ', 8)
+                  << juce::String(s.notesExtra).paddedLeft(' ', 7)
+                  << juce::String(s.onsetMeanMs(), 1).paddedLeft(' ', 10)
+                  << juce::String(s.offsetMeanMs(), 1).paddedLeft(' ', 11) << "\n";
+    }
+    std::cout << "* on the cost / pitch error Pareto front\n";
+
+    juce::Array<juce::var> configs;
+    for (const auto& r : results)
+        configs.add(toJson(r, corpus));
+    auto* root = new juce::DynamicObject();
+    root->setProperty("sampleRate", options.sampleRate);
+    root->setProperty("blockSize", options.blockSize);
+    root->setProperty("seconds", options.seconds);
+    root->setProperty("grossErrorCents", grossErrorCents);
+    root->setProperty("configs", configs);
+
+    if (!write(options.jsonFile, juce::JSON::toString(juce::var(root))) || !write(options.csvFile, toCsv(results))
+        || !write(options.svgFile, toSvg(results)))
+        return 2;
+
+    const auto& baseline = results.front().total;
+    int regressions = 0;
+    auto check = [&](const Result& r, const char* metric, double before, double after, double tolerance)
+    {
+        if (after <= before + tolerance)
+            return;
+        std::cout << "WORSE " << r.config.name << ": " << metric << " " << juce::String(before, 2) << " -> "
+                  << juce::String(after, 2) << "\n";
+        regressions++;
+    };
+    for (const auto& r : results)
+    {
+        if (!r.config.feature)
+            continue;
+        const auto& s = r.total;
+        check(r, "pitch error %", baseline.pitchErrorPercent(), s.pitchErrorPercent(), options.tolerancePercent);
+        check(r, "octave error %", baseline.octaveErrorPercent(), s.octaveErrorPercent(), options.tolerancePercent);
+        check(r, "missed notes", baseline.notesMissed(), s.notesMissed(), 0.0);
+        check(r, "extra notes", baseline.notesExtra, s.notesExtra, 0.0);
+        check(r, "|onset| ms", std::abs(baseline.onsetMeanMs()), std::abs(s.onsetMeanMs()), options.onsetToleranceMs);
+    }
+
+    std::cout << regressions << " feature regression(s) against the baseline\n";
+    return regressions == 0 ? 0 : 1;
+}
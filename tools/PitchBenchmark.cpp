@@ -0,0 +1,506 @@
+// Throughput benchmark for PitchDetector::processBlock, built without the plugin.
+//
+//   myk-pitch-benchmark [--full] [--seconds 10] [--input take.wav ...] [--scalar] [--fft]
+//                       [--yin] [--batch channels] [--json results.json] [--compare baseline.json]
+//                       [--tolerance 10]
+//
+// By default each axis of the matrix (sample rate, frequency range, execFreq, bins per octave,
+// downSample, block size) is varied on its own around a baseline case; --full runs every
+// combination. Recorded inputs are resampled to each case's rate. With --compare the run exits
+// with 1 if any case present in the baseline got slower per sample by more than --tolerance percent.
+//
+// --batch runs a PitchDetectorBatch over that many channels, each reading the signal from a
+// different point, and reports the time per channel sample. --yin runs the YIN engine instead of
+// the autocorrelation; the batch has no YIN, so the two do not mix.
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "CorrelationKernels.h"
+#include "PitchDetector.h"
+#include "PitchDetectorBatch.h"
+
+namespace
+{
+    struct Signal
+    {
+        juce::String name;
+        // Generated at the case's sample rate, or resampled from a recording.
+        std::vector<float> samples;
+    };
+
+    struct Case
+    {
+        double sampleRate = 48000.0;
+        float minFreq = 60.0f;
+        float maxFreq = 2000.0f;
+        float execFreq = 100.0f;
+        int maxBinsPerOctave = 16;
+        int downSample = 1;
+        int blockSize = 256;
+    };
+
+    struct Options
+    {
+        bool full = false;
+        bool scalar = false;
+        bool fft = false;
+        bool yin = false;
+        int batchChannels = 0;
+        double seconds = 10.0;
+        double tolerancePercent = 10.0;
+        juce::StringArray inputs;
+        juce::File jsonFile;
+        juce::File compareFile;
+    };
+
+    struct Measurement
+    {
+        double nsPerSample = 0.0;
+        double realtimeFactor = 0.0;
+        double hopsPerSecond = 0.0;
+        double worstCallNs = 0.0;
+        double worstCallBudgetPercent = 0.0;
+        juce::int64 hops = 0;
+        juce::int64 detections = 0;
+    };
+
+    const double sampleRates[] = { 44100.0, 48000.0, 96000.0 };
+    const std::pair<float, float> frequencyRanges[] = { { 60.0f, 2000.0f }, { 40.0f, 1000.0f }, { 80.0f, 4000.0f } };
+    const float execFreqs[] = { 10.0f, 100.0f, 400.0f };
+    const int binsPerOctave[] = { 4, 16, 32 };
+    const int downSamples[] = { 1, 2, 4 };
+    const int blockSizes[] = { 64, 256, 1024 };
+
+    bool isSameCase(const Case& a, const Case& b)
+    {
+        return a.sampleRate == b.sampleRate && a.minFreq == b.minFreq && a.maxFreq == b.maxFreq
+            && a.execFreq == b.execFreq && a.maxBinsPerOctave == b.maxBinsPerOctave
+            && a.downSample == b.downSample && a.blockSize == b.blockSize;
+    }
+
+    std::vector<Case> buildMatrix(bool full)
+    {
+        std::vector<Case> cases;
+        const Case baseline;
+        if (full)
+        {
+            for (auto sampleRate : sampleRates)
+                for (auto range : frequencyRanges)
+                    for (auto execFreq : execFreqs)
+                        for (auto bins : binsPerOctave)
+                            for (auto downSample : downSamples)
+                                for (auto blockSize : blockSizes)
+                                    cases.push_back({ sampleRate, range.first, range.second, execFreq, bins, downSample, blockSize });
+            return cases;
+        }
+
+        cases.push_back(baseline);
+        auto vary = [&](const auto& values, auto apply)
+        {
+            for (auto value : values)
+            {
+                auto c = baseline;
+                apply(c, value);
+                if (std::none_of(cases.begin(), cases.end(), [&](const Case& other) { return isSameCase(other, c); }))
+                    cases.push_back(c);
+            }
+        };
+        vary(sampleRates, [](Case& c, double v) { c.sampleRate = v; });
+        vary(frequencyRanges, [](Case& c, std::pair<float, float> v) { c.minFreq = v.first; c.maxFreq = v.second; });
+        vary(execFreqs, [](Case& c, float v) { c.execFreq = v; });
+        vary(binsPerOctave, [](Case& c, int v) { c.maxBinsPerOctave = v; });
+        vary(downSamples, [](Case& c, int v) { c.downSample = v; });
+        vary(blockSizes, [](Case& c, int v) { c.blockSize = v; });
+        return cases;
+    }
+
+    juce::String getCaseId(const Signal& signal, const Case& c, const Options& options)
+    {
+        auto id = signal.name + " sr=" + juce::String(static_cast<int>(c.sampleRate))
+                + " f=" + juce::String(c.minFreq, 0) + "-" + juce::String(c.maxFreq, 0)
+                + " exec=" + juce::String(c.execFreq, 0) + " bins=" + juce::String(c.maxBinsPerOctave)
+                + " ds=" + juce::String(c.downSample) + " block=" + juce::String(c.blockSize);
+        if (options.batchChannels > 0)
+            id += " batch=" + juce::String(options.batchChannels);
+        if (options.yin)
+            id += " yin";
+        return id;
+    }
+
+    // Synthetic signals: a glide across the default range, a vibrato voice with harmonics and
+    // pauses, and noise, which never yields a confident peak and so runs the full search.
+    std::vector<Signal> makeSyntheticSignals(double sampleRate, double seconds)
+    {
+        const auto length = static_cast<size_t>(sampleRate * seconds);
+        const double twoPi = juce::MathConstants<double>::twoPi;
+        std::vector<Signal> signals;
+
+        Signal glide { "glide", std::vector<float>(length) };
+        double phase = 0.0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            const double t = static_cast<double>(i) / static_cast<double>(length);
+            phase += twoPi * 80.0 * std::pow(20.0, t) / sampleRate;
+            glide.samples[i] = 0.5f * static_cast<float>(std::sin(phase));
+        }
+        signals.push_back(std::move(glide));
+
+        Signal voice { "voice", std::vector<float>(length) };
+        phase = 0.0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            const double t = static_cast<double>(i) / sampleRate;
+            const int note = static_cast<int>(t / 0.4) % 8;
+            const bool sounding = std::fmod(t, 0.4) < 0.32;
+            const double freq = 196.0 * std::pow(2.0, (note * 2 + 0.15 * std::sin(twoPi * 5.5 * t)) / 12.0);
+            phase += twoPi * freq / sampleRate;
+            const double value = std::sin(phase) + 0.5 * std::sin(2.0 * phase) + 0.25 * std::sin(3.0 * phase);
+            voice.samples[i] = sounding ? 0.3f * static_cast<float>(value) : 0.0f;
+        }
+        signals.push_back(std::move(voice));
+
+        Signal noise { "noise", std::vector<float>(length) };
+        juce::Random random(1234);
+        for (auto& sample : noise.samples)
+            sample = 0.2f * (random.nextFloat() * 2.0f - 1.0f);
+        signals.push_back(std::move(noise));
+
+        return signals;
+    }
+
+    struct Recording
+    {
+        juce::String name;
+        double sampleRate = 0.0;
+        std::vector<float> samples;
+    };
+
+    bool loadRecording(const juce::File& file, Recording& recording)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return false;
+
+        const auto length = static_cast<int>(reader->lengthInSamples);
+        juce::AudioBuffer<float> buffer(static_cast<int>(reader->numChannels), length);
+        reader->read(&buffer, 0, length, 0, true, true);
+
+        recording.name = file.getFileNameWithoutExtension();
+        recording.sampleRate = reader->sampleRate;
+        recording.samples.assign(static_cast<size_t>(length), 0.0f);
+        const float scale = 1.0f / static_cast<float>(buffer.getNumChannels());
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::addWithMultiply(recording.samples.data(), buffer.getReadPointer(channel), scale, length);
+        return true;
+    }
+
+    // Resamples and loops the recording to fill the requested duration at the case's rate.
+    Signal resample(const Recording& recording, double sampleRate, double seconds)
+    {
+        const double ratio = recording.sampleRate / sampleRate;
+        std::vector<float> converted(static_cast<size_t>(static_cast<double>(recording.samples.size()) / ratio));
+        juce::LagrangeInterpolator interpolator;
+        interpolator.process(ratio, recording.samples.data(), converted.data(), static_cast<int>(converted.size()));
+
+        Signal signal { recording.name, std::vector<float>(static_cast<size_t>(sampleRate * seconds)) };
+        for (size_t i = 0; i < signal.samples.size() && !converted.empty(); ++i)
+            signal.samples[i] = converted[i % converted.size()];
+        return signal;
+    }
+
+    PitchDetector::Settings makeSettings(const Case& c, const Options& options)
+    {
+        PitchDetector::Settings settings;
+        settings.minFreq = c.minFreq;
+        settings.maxFreq = c.maxFreq;
+        settings.execFreq = c.execFreq;
+        settings.maxBinsPerOctave = c.maxBinsPerOctave;
+        settings.downSample = c.downSample;
+        settings.scalarKernel = options.scalar;
+        settings.fftCorrelation = options.fft;
+        settings.engine = options.yin ? PitchDetector::Settings::Engine::yin : PitchDetector::Settings::Engine::autocorrelation;
+        return settings;
+    }
+
+    void finishMeasurement(Measurement& measurement, const Case& c, int measured, juce::int64 elapsedTicks, juce::int64 worstTicks)
+    {
+        const double ticksPerNs = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) * 1.0e-9;
+        const double elapsedNs = static_cast<double>(elapsedTicks) / ticksPerNs;
+        const double elapsedSeconds = elapsedNs * 1.0e-9;
+        measurement.nsPerSample = measured > 0 ? elapsedNs / measured : 0.0;
+        measurement.realtimeFactor = elapsedSeconds > 0.0 ? (measured / c.sampleRate) / elapsedSeconds : 0.0;
+        measurement.hopsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(measurement.hops) / elapsedSeconds : 0.0;
+        measurement.worstCallNs = static_cast<double>(worstTicks) / ticksPerNs;
+        measurement.worstCallBudgetPercent = 100.0 * measurement.worstCallNs * 1.0e-9 / (c.blockSize / c.sampleRate);
+    }
+
+    Measurement run(const Signal& signal, const Case& c, const Options& options)
+    {
+        const auto settings = makeSettings(c, options);
+        PitchDetector detector;
+        detector.prepare(c.sampleRate, c.blockSize, settings);
+        std::vector<PitchDetector::Detection> detections;
+        detections.reserve(128);
+
+        const auto total = static_cast<int>(signal.samples.size());
+
+        // The first second warms caches and the lag tables and is not measured.
+        const int warmup = std::min(total, static_cast<int>(c.sampleRate));
+        for (int start = 0; start < warmup; start += c.blockSize)
+            detector.processBlock(signal.samples.data() + start, std::min(c.blockSize, warmup - start), detections);
+        const auto hopsBefore = detector.getStats().hops;
+
+        Measurement measurement;
+        juce::int64 elapsedTicks = 0;
+        juce::int64 worstTicks = 0;
+        for (int start = warmup; start < total; start += c.blockSize)
+        {
+            const int count = std::min(c.blockSize, total - start);
+            const auto callStart = juce::Time::getHighResolutionTicks();
+            detector.processBlock(signal.samples.data() + start, count, detections);
+            const auto callTicks = juce::Time::getHighResolutionTicks() - callStart;
+            elapsedTicks += callTicks;
+            worstTicks = std::max(worstTicks, callTicks);
+            measurement.detections += static_cast<juce::int64>(detections.size());
+        }
+
+        measurement.hops = detector.getStats().hops - hopsBefore;
+        finishMeasurement(measurement, c, total - warmup, elapsedTicks, worstTicks);
+        return measurement;
+    }
+
+    // Channel k reads the signal rotated by k / channels of its length, so the channels hold
+    // different pitches at any moment. ns/sample, realtime factor and hops/s count every channel.
+    Measurement runBatch(const Signal& signal, const Case& c, const Options& options)
+    {
+        const int numChannels = options.batchChannels;
+        const auto total = static_cast<int>(signal.samples.size());
+        std::vector<std::vector<float>> channels(static_cast<size_t>(numChannels));
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto shift = static_cast<size_t>(total / numChannels * channel);
+            auto& samples = channels[static_cast<size_t>(channel)];
+            samples.assign(signal.samples.begin() + static_cast<std::ptrdiff_t>(shift), signal.samples.end());
+            samples.insert(samples.end(), signal.samples.begin(), signal.samples.begin() + static_cast<std::ptrdiff_t>(shift));
+        }
+
+        PitchDetectorBatch batch;
+        batch.prepare(c.sampleRate, c.blockSize, numChannels, makeSettings(c, options));
+        std::vector<const float*> inputs(static_cast<size_t>(numChannels));
+        auto process = [&](int start, int count)
+        {
+            for (size_t channel = 0; channel < inputs.size(); ++channel)
+                inputs[channel] = channels[channel].data() + start;
+            batch.processBlock(inputs.data(), count);
+        };
+        auto countHops = [&]
+        {
+            juce::int64 hops = 0;
+            for (int channel = 0; channel < numChannels; ++channel)
+                hops += batch.getStats(channel).hops;
+            return hops;
+        };
+
+        const int warmup = std::min(total, static_cast<int>(c.sampleRate));
+        for (int start = 0; start < warmup; start += c.blockSize)
+            process(start, std::min(c.blockSize, warmup - start));
+        const auto hopsBefore = countHops();
+
+        Measurement measurement;
+        juce::int64 elapsedTicks = 0;
+        juce::int64 worstTicks = 0;
+        for (int start = warmup; start < total; start += c.blockSize)
+        {
+            const int count = std::min(c.blockSize, total - start);
+            const auto callStart = juce::Time::getHighResolutionTicks();
+            process(start, count);
+            const auto callTicks = juce::Time::getHighResolutionTicks() - callStart;
+            elapsedTicks += callTicks;
+            worstTicks = std::max(worstTicks, callTicks);
+            for (int channel = 0; channel < numChannels; ++channel)
+                measurement.detections += static_cast<juce::int64>(batch.getDetections(channel).size());
+        }
+
+        measurement.hops = countHops() - hopsBefore;
+        finishMeasurement(measurement, c, (total - warmup) * numChannels, elapsedTicks, worstTicks);
+        return measurement;
+    }
+
+    juce::var toJson(const juce::String& id, const Signal& signal, const Case& c, const Measurement& m)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("id", id);
+        object->setProperty("signal", signal.name);
+        object->setProperty("sampleRate", c.sampleRate);
+        object->setProperty("minFreq", c.minFreq);
+        object->setProperty("maxFreq", c.maxFreq);
+        object->setProperty("execFreq", c.execFreq);
+        object->setProperty("maxBinsPerOctave", c.maxBinsPerOctave);
+        object->setProperty("downSample", c.downSample);
+        object->setProperty("blockSize", c.blockSize);
+        object->setProperty("nsPerSample", m.nsPerSample);
+        object->setProperty("realtimeFactor", m.realtimeFactor);
+        object->setProperty("hopsPerSecond", m.hopsPerSecond);
+        object->setProperty("worstCallNs", m.worstCallNs);
+        object->setProperty("worstCallBudgetPercent", m.worstCallBudgetPercent);
+        object->setProperty("hops", m.hops);
+        object->setProperty("detections", m.detections);
+        return juce::var(object);
+    }
+
+    bool parseArguments(const juce::StringArray& args, Options& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+            if (arg == "--full")
+                options.full = true;
+            else if (arg == "--scalar")
+                options.scalar = true;
+            else if (arg == "--fft")
+                options.fft = true;
+            else if (arg == "--yin")
+                options.yin = true;
+            else if (arg == "--batch" && hasValue)
+                options.batchChannels = juce::jlimit(1, PitchDetectorBatch::kMaxChannels, args[++i].getIntValue());
+            else if (arg == "--seconds" && hasValue)
+                options.seconds = std::max(2.0, args[++i].getDoubleValue());
+            else if (arg == "--tolerance" && hasValue)
+                options.tolerancePercent = args[++i].getDoubleValue();
+            else if (arg == "--input" && hasValue)
+                options.inputs.add(args[++i]);
+            else if (arg == "--json" && hasValue)
+                options.jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--compare" && hasValue)
+                options.compareFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+                return false;
+            }
+        }
+        if (options.yin && options.batchChannels > 0)
+        {
+            std::cerr << "--yin and --batch cannot be combined\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    Options options;
+    if (!parseArguments(args, options))
+        return 2;
+
+    std::vector<Recording> recordings;
+    for (const auto& path : options.inputs)
+    {
+        Recording recording;
+        if (!loadRecording(juce::File::getCurrentWorkingDirectory().getChildFile(path), recording))
+        {
+            std::cerr << "Could not read " << path << "\n";
+            return 2;
+        }
+        recordings.push_back(std::move(recording));
+    }
+
+    const auto isa = options.scalar ? CorrelationKernels::Isa::scalar : CorrelationKernels::detectIsa();
+    std::cout << "Kernels: " << CorrelationKernels::getIsaName(isa) << (options.fft ? ", FFT correlation" : "")
+              << (options.yin ? ", YIN engine" : "");
+    if (options.batchChannels > 0)
+        std::cout << ", " << options.batchChannels << " batched channels, " << CorrelationKernels::getLaneCount(isa) << " lanes";
+    std::cout << "\n";
+    std::cout << juce::String("case").paddedRight(' ', 62) << "  ns/sample  realtime x   hops/s   worst us  worst %\n";
+
+    const auto cases = buildMatrix(options.full);
+    juce::Array<juce::var> results;
+    double signalRate = 0.0;
+    std::vector<Signal> signals;
+    for (const auto& c : cases)
+    {
+        // Signals depend only on the sample rate, so they are rebuilt when it changes.
+        if (c.sampleRate != signalRate)
+        {
+            signals = makeSyntheticSignals(c.sampleRate, options.seconds);
+            for (const auto& recording : recordings)
+                signals.push_back(resample(recording, c.sampleRate, options.seconds));
+            signalRate = c.sampleRate;
+        }
+
+        for (const auto& signal : signals)
+        {
+            const auto id = getCaseId(signal, c, options);
+            const auto m = options.batchChannels > 0 ? runBatch(signal, c, options) : run(signal, c, options);
+            std::cout << id.paddedRight(' ', 62)
+                      << juce::String(m.nsPerSample, 2).paddedLeft(' ', 11)
+                      << juce::String(m.realtimeFactor, 1).paddedLeft(' ', 12)
+                      << juce::String(m.hopsPerSecond, 0).paddedLeft(' ', 9)
+                      << juce::String(m.worstCallNs * 1.0e-3, 1).paddedLeft(' ', 11)
+                      << juce::String(m.worstCallBudgetPercent, 1).paddedLeft(' ', 9) << "\n";
+            results.add(toJson(id, signal, c, m));
+        }
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("kernels", CorrelationKernels::getIsaName(isa));
+    root->setProperty("fftCorrelation", options.fft);
+    root->setProperty("engine", options.yin ? "yin" : "autocorrelation");
+    root->setProperty("batchChannels", options.batchChannels);
+    root->setProperty("seconds", options.seconds);
+    root->setProperty("cases", results);
+    const juce::var report(root);
+
+    if (options.jsonFile != juce::File() && !options.jsonFile.replaceWithText(juce::JSON::toString(report)))
+    {
+        std::cerr << "Could not write " << options.jsonFile.getFullPathName() << "\n";
+        return 2;
+    }
+
+    if (options.compareFile == juce::File())
+        return 0;
+
+    const auto baseline = juce::JSON::parse(options.compareFile);
+    const auto* baselineCases = baseline["cases"].getArray();
+    if (baselineCases == nullptr)
+    {
+        std::cerr << "No cases in " << options.compareFile.getFullPathName() << "\n";
+        return 2;
+    }
+
+    int regressions = 0;
+    for (const auto& result : results)
+    {
+        for (const auto& previous : *baselineCases)
+        {
+            if (previous["id"].toString() != result["id"].toString())
+                continue;
+
+            const double before = previous["nsPerSample"];
+            const double after = result["nsPerSample"];
+            const double changePercent = before > 0.0 ? 100.0 * (after - before) / before : 0.0;
+            if (changePercent > options.tolerancePercent)
+            {
+                std::cout << "SLOWER " << result["id"].toString() << ": " << juce::String(before, 2) << " -> "
+                          << juce::String(after, 2) << " ns/sample (+" << juce::String(changePercent, 1) << "%)\n";
+                regressions++;
+            }
+        }
+    }
+
+    std::cout << regressions << " case(s) slower than the baseline by more than "
+              << juce::String(options.tolerancePercent, 1) << "%\n";
+    return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// Drives the plugin processor through a synthetic note sequence and a series of parameter changes with
+// MYK_RT_AUDIT enabled, then prints every allocation, lock or blocking call made inside
+// processBlock. Exits with 1 when there was any, so it can gate a build. The processor gets one
+// input channel per multi-channel voice, which the other modes downmix.
+//
+//   cmake -B build -DMYK_RT_AUDIT=ON . && cmake --build build --target myk-rt-audit
+//   MYK_RT_AUDIT_TRAP=1 gdb ./build/myk-rt-audit_artefacts/myk-rt-audit   # stop at the first one
+
+#include <JuceHeader.h>
+#include <cmath>
+#include <iostream>
+
+#include "PluginProcessor.h"
+#include "RealtimeAudit.h"
+
+namespace
+{
+    constexpr double kSampleRate = 48000.0;
+    constexpr int kBlockSize = 256;
+    constexpr int kBlocksPerStep = 96;
+    constexpr int kNumInputChannels = MultiChannelTracker::kMaxVoices;
+
+    struct ParameterChange
+    {
+        const char* id;
+        float value;
+    };
+
+    // Each step exercises a different analysis path; the async steps also cover the worker handoff.
+    const ParameterChange parameterChanges[] = {
+        { "execFreq", 100.0f },
+        { "fftCorr", 1.0f },
+        { "fftCorr", 0.0f },
+        { "incremental", 1.0f },
+        { "tracking", 1.0f },
+        { "maxBins", 4.0f },
+        { "median", 15.0f },
+        { "coarseSearch", 2.0f },
+        { "downSample", 3.0f },
+        { "antiAlias", 1.0f },
+        { "autoDownSample", 1.0f },
+        { "analysisSlices", 8.0f },
+        { "clarity", 0.0f },
+        { "asyncAnalysis", 1.0f },
+        { "asyncLatency", 120.0f },
+        { "coarseSearch", 0.0f },
+        { "asyncAnalysis", 0.0f },
+        { "analysisSlices", 1.0f },
+        { "downSample", 1.0f },
+        { "midiThru", 1.0f },
+        { "dcBlock", 1.0f },
+        // The YIN engine, index 1 of the engine choice.
+        { "engine", 1.0f },
+        { "yinThreshold", 0.3f },
+        { "engine", 0.0f },
+        // Every input channel becomes a voice; the denser search makes the voices costly enough
+        // to be shared out with the worker threads.
+        { "multiChannel", 1.0f },
+        { "dcBlock", 0.0f },
+        { "autoDownSample", 0.0f },
+        { "execFreq", 500.0f },
+        { "maxBins", 32.0f },
+    };
+
+    void setParameter(juce::AudioProcessorValueTreeState& state, const ParameterChange& change)
+    {
+        auto* parameter = state.getParameter(change.id);
+        jassert(parameter != nullptr);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(change.value));
+    }
+
+    // Half-second notes a fifth apart with a short gap, so note-ons and note-offs are both produced.
+    void fillBlock(juce::AudioBuffer<float>& buffer, juce::int64 startSample, double& phase)
+    {
+        const int noteLength = static_cast<int>(kSampleRate * 0.5);
+        const int gapLength = static_cast<int>(kSampleRate * 0.1);
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            const auto position = startSample + i;
+            const auto note = position / noteLength;
+            const bool sounding = position % noteLength < noteLength - gapLength;
+            const double freq = 220.0 * std::pow(2.0, static_cast<double>((note % 4) * 7) / 12.0);
+            phase += juce::MathConstants<double>::twoPi * freq / kSampleRate;
+            const float sample = sounding ? 0.3f * static_cast<float>(std::sin(phase)) : 0.0f;
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.setSample(channel, i, sample);
+        }
+    }
+}
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    TestPluginAudioProcessor processor;
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add(juce::AudioChannelSet::discreteChannels(kNumInputChannels));
+    layout.outputBuses.add(juce::AudioChannelSet::stereo());
+    const bool layoutApplied = processor.setBusesLayout(layout);
+    jassert(layoutApplied);
+    juce::ignoreUnused(layoutApplied);
+    processor.setRateAndBufferSizeDetails(kSampleRate, kBlockSize);
+    processor.prepareToPlay(kSampleRate, kBlockSize);
+
+    juce::AudioBuffer<float> buffer(kNumInputChannels, kBlockSize);
+    juce::MidiBuffer midi;
+    // Hosts hand over a preallocated MIDI buffer; growing it would be reported as an allocation.
+    midi.ensureSize(4096);
+
+    juce::int64 sampleCounter = 0;
+    double phase = 0.0;
+    auto processBlocks = [&]
+    {
+        for (int block = 0; block < kBlocksPerStep; ++block)
+        {
+            fillBlock(buffer, sampleCounter, phase);
+            midi.clear();
+            processor.processBlock(buffer, midi);
+            sampleCounter += kBlockSize;
+        }
+    };
+
+    processBlocks();
+    for (const auto& change : parameterChanges)
+    {
+        setParameter(processor.getValueTreeState(), change);
+        // Lets the processor's timer publish the new settings and report latency.
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(50);
+        processBlocks();
+    }
+
+    processor.releaseResources();
+
+    const int violations = RealtimeAudit::getNumViolations();
+    std::cout << RealtimeAudit::createReport() << std::flush;
+    return violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,460 @@
+// Headless pitch tracking on a pipe: interleaved PCM on stdin, note events on stdout.
+//
+//   myk-pitch-stream [--rate 48000] [--channels 1] [--input f32|s16] [--output json|midi]
+//                    [--detections] [--block 256] [--queue 64] [--gain 1] [--min-freq 60]
+//                    [--max-freq 2000] [--exec 100] [--median 7] [--min-note-ms 50]
+//                    [--min-velocity 0]
+//
+//   arecord -f S16_LE -r 48000 -c 1 -t raw | myk-pitch-stream --input s16 > notes.jsonl
+//
+// Reading, downmix, detection, note segmentation and serialisation each run on their own thread,
+// connected by bounded SPSC queues of --queue blocks. A stage whose output queue is full waits,
+// so a slow consumer throttles reading from stdin instead of growing memory. JSON output is one
+// object per line: noteOn / noteOff with the absolute sample position and time, plus pitch for
+// every detection with --detections. MIDI output is raw channel 1 note messages as they happen.
+// Notes still sounding at the end of the input are closed. Stage load and queue depths go to
+// stderr at the end, with any detections dropped for a full frame.
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#if JUCE_WINDOWS
+ #include <fcntl.h>
+ #include <io.h>
+#endif
+
+#include "NoteSegmenter.h"
+#include "OfflineTranscriber.h"
+#include "PitchDetector.h"
+#include "SpscQueue.h"
+
+namespace
+{
+    enum class InputFormat { float32, int16 };
+    enum class OutputFormat { json, midi };
+
+    struct Options
+    {
+        double sampleRate = 48000.0;
+        int channels = 1;
+        InputFormat input = InputFormat::float32;
+        OutputFormat output = OutputFormat::json;
+        bool detections = false;
+        int queueBlocks = 64;
+        // Block size, gain, detector and note settings, with the offline tools' defaults.
+        OfflineTranscriber::Settings settings = OfflineTranscriber::getDefaultSettings();
+    };
+
+    // Every frame carries one block; the last one (possibly empty) has endOfStream set.
+    struct RawFrame
+    {
+        juce::int64 startSample = 0;
+        int numSamples = 0;
+        bool endOfStream = false;
+        std::vector<char> bytes;
+    };
+
+    struct MonoFrame
+    {
+        juce::int64 startSample = 0;
+        int numSamples = 0;
+        bool endOfStream = false;
+        float rms = 0.0f;
+        std::vector<float> samples;
+    };
+
+    struct DetectionFrame
+    {
+        juce::int64 startSample = 0;
+        int numSamples = 0;
+        bool endOfStream = false;
+        float rms = 0.0f;
+        std::vector<PitchDetector::Detection> detections;
+    };
+
+    struct EventFrame
+    {
+        juce::int64 startSample = 0;
+        bool endOfStream = false;
+        std::vector<NoteSegmenter::Event> events;
+        // Only filled with --detections.
+        std::vector<PitchDetector::Detection> detections;
+    };
+
+    // Placeholder for the missing input of the first stage and output of the last.
+    struct None
+    {
+    };
+
+    struct StageStats
+    {
+        juce::int64 frames = 0;
+        double busySeconds = 0.0;
+        // Waiting for the previous stage, and for room in the next one (backpressure).
+        double starvedSeconds = 0.0;
+        double blockedSeconds = 0.0;
+        // Depth of the input queue each time a frame is taken from it, including that frame.
+        double inputDepthTotal = 0.0;
+        int inputDepthMax = 0;
+    };
+
+    double secondsSince(juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    // One pipeline stage on its own thread: takes a frame from input, fills a slot of output and
+    // passes both on. process returns true after the end-of-stream frame.
+    template <typename In, typename Out>
+    class Stage : public juce::Thread
+    {
+    public:
+        using Process = std::function<bool(const In*, Out*)>;
+
+        Stage(const juce::String& stageName, SpscQueue<In>* inputQueue, SpscQueue<Out>* outputQueue, Process processFrame)
+            : juce::Thread(stageName), input(inputQueue), output(outputQueue), process(std::move(processFrame))
+        {
+        }
+
+        ~Stage() override
+        {
+            stopThread(1000);
+        }
+
+        bool isFinished() const { return finished.load(); }
+        // Only meaningful once the thread has stopped.
+        const StageStats& getStats() const { return stats; }
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                const In* in = nullptr;
+                if (input != nullptr)
+                {
+                    if ((in = waitFor([this] { return input->peek(); }, stats.starvedSeconds)) == nullptr)
+                        break;
+                    const int depth = input->getNumReady();
+                    stats.inputDepthTotal += depth;
+                    stats.inputDepthMax = std::max(stats.inputDepthMax, depth);
+                }
+                Out* out = nullptr;
+                if (output != nullptr && (out = waitFor([this] { return output->acquireWrite(); }, stats.blockedSeconds)) == nullptr)
+                    break;
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                const bool endOfStream = process(in, out);
+                stats.busySeconds += secondsSince(start);
+                stats.frames++;
+
+                if (output != nullptr)
+                    output->commitWrite();
+                if (input != nullptr)
+                    input->commitRead();
+                if (endOfStream)
+                    break;
+            }
+            finished.store(true);
+        }
+
+    private:
+        // Spins briefly, then sleeps, so an idle stage does not hold a core.
+        template <typename Fetch>
+        auto waitFor(Fetch fetch, double& waitedSeconds)
+        {
+            auto item = fetch();
+            if (item != nullptr)
+                return item;
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (int attempt = 0; item == nullptr && !threadShouldExit(); ++attempt)
+            {
+                if (attempt < 64)
+                    juce::Thread::yield();
+                else
+                    juce::Thread::sleep(1);
+                item = fetch();
+            }
+            waitedSeconds += secondsSince(start);
+            return item;
+        }
+
+        SpscQueue<In>* input;
+        SpscQueue<Out>* output;
+        Process process;
+        StageStats stats;
+        std::atomic<bool> finished { false };
+    };
+
+    bool parseArguments(const juce::StringArray& args, Options& options)
+    {
+        auto& detector = options.settings.detector;
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+            if (arg == "--rate" && hasValue)
+                options.sampleRate = args[++i].getDoubleValue();
+            else if (arg == "--channels" && hasValue)
+                options.channels = std::max(1, args[++i].getIntValue());
+            else if (arg == "--input" && hasValue)
+                options.input = args[++i] == "s16" ? InputFormat::int16 : InputFormat::float32;
+            else if (arg == "--output" && hasValue)
+                options.output = args[++i] == "midi" ? OutputFormat::midi : OutputFormat::json;
+            else if (arg == "--detections")
+                options.detections = true;
+            else if (arg == "--block" && hasValue)
+                options.settings.blockSize = std::max(1, args[++i].getIntValue());
+            else if (arg == "--queue" && hasValue)
+                options.queueBlocks = std::max(1, args[++i].getIntValue());
+            else if (arg == "--gain" && hasValue)
+                options.settings.gain = args[++i].getFloatValue();
+            else if (arg == "--min-freq" && hasValue)
+                detector.minFreq = args[++i].getFloatValue();
+            else if (arg == "--max-freq" && hasValue)
+                detector.maxFreq = args[++i].getFloatValue();
+            else if (arg == "--exec" && hasValue)
+                detector.execFreq = args[++i].getFloatValue();
+            else if (arg == "--median" && hasValue)
+                detector.medianSize = args[++i].getIntValue();
+            else if (arg == "--min-note-ms" && hasValue)
+                options.settings.minNoteSeconds = args[++i].getFloatValue() * 0.001f;
+            else if (arg == "--min-velocity" && hasValue)
+                options.settings.minVelocity = juce::jlimit(0, 127, args[++i].getIntValue());
+            else
+            {
+                std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+                return false;
+            }
+        }
+        return options.sampleRate > 0.0;
+    }
+
+    bool readFrame(const Options& options, juce::int64 position, RawFrame& frame)
+    {
+        const size_t bytesPerFrame = static_cast<size_t>(options.channels) * (options.input == InputFormat::int16 ? 2 : 4);
+        frame.bytes.resize(bytesPerFrame * static_cast<size_t>(options.settings.blockSize));
+
+        // A trailing partial sample frame at the end of the input is dropped.
+        const size_t bytesRead = std::fread(frame.bytes.data(), 1, frame.bytes.size(), stdin);
+        frame.startSample = position;
+        frame.numSamples = static_cast<int>(bytesRead / bytesPerFrame);
+        frame.endOfStream = bytesRead < frame.bytes.size();
+        return frame.endOfStream;
+    }
+
+    // Same downmix and level as TestPluginAudioProcessor::processBlock.
+    void condition(const Options& options, const RawFrame& in, MonoFrame& out)
+    {
+        out.startSample = in.startSample;
+        out.numSamples = in.numSamples;
+        out.endOfStream = in.endOfStream;
+        out.samples.resize(static_cast<size_t>(options.settings.blockSize));
+
+        const int channels = options.channels;
+        const float channelScale = options.settings.gain / static_cast<float>(channels);
+        float rmsSum = 0.0f;
+        for (int sample = 0; sample < in.numSamples; ++sample)
+        {
+            float mixed = 0.0f;
+            for (int channel = 0; channel < channels; ++channel)
+            {
+                const size_t index = static_cast<size_t>(sample * channels + channel);
+                if (options.input == InputFormat::int16)
+                {
+                    std::int16_t value = 0;
+                    std::memcpy(&value, in.bytes.data() + index * 2, 2);
+                    mixed += static_cast<float>(value) * (1.0f / 32768.0f);
+                }
+                else
+                {
+                    float value = 0.0f;
+                    std::memcpy(&value, in.bytes.data() + index * 4, 4);
+                    mixed += value;
+                }
+            }
+
+            mixed *= channelScale;
+            out.samples[static_cast<size_t>(sample)] = mixed;
+            rmsSum += mixed * mixed;
+        }
+        out.rms = in.numSamples > 0 ? std::sqrt(rmsSum / static_cast<float>(in.numSamples)) : 0.0f;
+    }
+
+    void writeJson(const Options& options, const EventFrame& frame)
+    {
+        juce::String text;
+        auto timeOf = [&options](juce::int64 sample) { return juce::String(static_cast<double>(sample) / options.sampleRate, 4); };
+
+        for (const auto& detection : frame.detections)
+        {
+            const auto sample = frame.startSample + detection.sampleOffset;
+            text << "{\"type\":\"pitch\",\"sample\":" << juce::String(sample) << ",\"time\":" << timeOf(sample)
+                 << ",\"freq\":" << juce::String(detection.freq, 2) << ",\"clarity\":" << juce::String(detection.clarity, 3) << "}\n";
+        }
+        for (const auto& event : frame.events)
+        {
+            const auto sample = frame.startSample + event.sampleOffset;
+            text << "{\"type\":\"" << (event.noteOn ? "noteOn" : "noteOff") << "\",\"sample\":" << juce::String(sample)
+                 << ",\"time\":" << timeOf(sample) << ",\"note\":" << event.note << ",\"velocity\":" << event.velocity << "}\n";
+        }
+
+        if (text.isNotEmpty())
+        {
+            std::fwrite(text.toRawUTF8(), 1, text.getNumBytesAsUTF8(), stdout);
+            std::fflush(stdout);
+        }
+    }
+
+    void writeMidi(const EventFrame& frame)
+    {
+        if (frame.events.empty())
+            return;
+
+        for (const auto& event : frame.events)
+        {
+            const auto message = event.noteOn ? juce::MidiMessage::noteOn(1, event.note, static_cast<juce::uint8>(event.velocity))
+                                              : juce::MidiMessage::noteOff(1, event.note);
+            std::fwrite(message.getRawData(), 1, static_cast<size_t>(message.getRawDataSize()), stdout);
+        }
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    Options options;
+    if (!parseArguments(args, options))
+    {
+        std::cerr << "Usage: myk-pitch-stream [options] < input.raw > output\n";
+        return 2;
+    }
+
+#if JUCE_WINDOWS
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    const auto& settings = options.settings;
+    PitchDetector detector;
+    detector.prepare(options.sampleRate, settings.blockSize, settings.detector);
+    NoteSegmenter segmenter;
+    NoteSegmenter::Settings segmenterSettings;
+    segmenterSettings.minNoteLengthSamples = static_cast<juce::int64>(settings.minNoteSeconds * options.sampleRate);
+    segmenterSettings.minVelocity = settings.minVelocity;
+
+    SpscQueue<RawFrame> rawQueue(options.queueBlocks);
+    SpscQueue<MonoFrame> monoQueue(options.queueBlocks);
+    SpscQueue<DetectionFrame> detectionQueue(options.queueBlocks);
+    SpscQueue<EventFrame> eventQueue(options.queueBlocks);
+    // The detector fills a reserved vector up to its capacity and counts the rest as dropped.
+    detectionQueue.forEachSlot([](DetectionFrame& frame) { frame.detections.reserve(128); });
+
+    juce::int64 samplesRead = 0;
+    Stage<None, RawFrame> reader("Read", nullptr, &rawQueue, [&](const None*, RawFrame* out)
+    {
+        const bool endOfStream = readFrame(options, samplesRead, *out);
+        samplesRead += out->numSamples;
+        return endOfStream;
+    });
+
+    Stage<RawFrame, MonoFrame> conditioner("Condition", &rawQueue, &monoQueue, [&](const RawFrame* in, MonoFrame* out)
+    {
+        condition(options, *in, *out);
+        return in->endOfStream;
+    });
+
+    Stage<MonoFrame, DetectionFrame> analyser("Detect", &monoQueue, &detectionQueue, [&](const MonoFrame* in, DetectionFrame* out)
+    {
+        out->startSample = in->startSample;
+        out->numSamples = in->numSamples;
+        out->endOfStream = in->endOfStream;
+        out->rms = in->rms;
+        detector.processBlock(in->samples.data(), in->numSamples, out->detections);
+        return in->endOfStream;
+    });
+
+    Stage<DetectionFrame, EventFrame> noteStage("Segment", &detectionQueue, &eventQueue, [&](const DetectionFrame* in, EventFrame* out)
+    {
+        out->startSample = in->startSample;
+        out->endOfStream = in->endOfStream;
+        out->events.clear();
+        if (in->numSamples > 0)
+            segmenter.processBlock(in->detections, in->startSample, settings.blockSize, in->rms, segmenterSettings, out->events);
+
+        if (in->endOfStream)
+        {
+            const auto state = segmenter.getState();
+            for (int note = 0; note < static_cast<int>(state.noteOffNeeded.size()); ++note)
+                if (state.noteOffNeeded[static_cast<size_t>(note)])
+                    out->events.push_back({ note, false, 0, in->numSamples });
+        }
+
+        out->detections.clear();
+        if (options.detections)
+            out->detections.insert(out->detections.end(), in->detections.begin(), in->detections.end());
+        return in->endOfStream;
+    });
+
+    Stage<EventFrame, None> writer("Write", &eventQueue, nullptr, [&](const EventFrame* in, None*)
+    {
+        if (options.output == OutputFormat::midi)
+            writeMidi(*in);
+        else
+            writeJson(options, *in);
+        return in->endOfStream;
+    });
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    for (juce::Thread* stage : std::initializer_list<juce::Thread*> { &writer, &noteStage, &analyser, &conditioner, &reader })
+        stage->startThread();
+
+    while (!writer.isFinished())
+        juce::Thread::sleep(1);
+    const double wallSeconds = secondsSince(start);
+
+    for (juce::Thread* stage : std::initializer_list<juce::Thread*> { &reader, &conditioner, &analyser, &noteStage, &writer })
+        stage->stopThread(1000);
+
+    const double audioSeconds = static_cast<double>(samplesRead) / options.sampleRate;
+    std::cerr << juce::String(audioSeconds, 2) << " s of audio in " << juce::String(wallSeconds, 2) << " s: "
+              << juce::String(audioSeconds / std::max(wallSeconds, 1.0e-9), 1) << "x realtime, "
+              << detector.getStats().droppedDetections << " detection(s) dropped\n";
+
+    auto percent = [wallSeconds](double seconds) { return juce::String(100.0 * seconds / std::max(wallSeconds, 1.0e-9), 1); };
+    const std::pair<const char*, StageStats> stages[] = { { "read", reader.getStats() },
+                                                          { "condition", conditioner.getStats() },
+                                                          { "detect", analyser.getStats() },
+                                                          { "segment", noteStage.getStats() },
+                                                          { "write", writer.getStats() } };
+
+    // The read stage's busy time includes waiting for stdin. Queue depths are those of the
+    // stage's input queue (capacity --queue) as seen when it takes each frame.
+    std::cerr << "stage       frames   busy %   starved %   blocked %   mean depth   max depth\n";
+    for (const auto& [name, stats] : stages)
+    {
+        const bool hasInput = stats.inputDepthMax > 0;
+        const double meanDepth = stats.frames > 0 ? stats.inputDepthTotal / static_cast<double>(stats.frames) : 0.0;
+        std::cerr << juce::String(name).paddedRight(' ', 10)
+                  << juce::String(stats.frames).paddedLeft(' ', 8)
+                  << percent(stats.busySeconds).paddedLeft(' ', 9)
+                  << percent(stats.starvedSeconds).paddedLeft(' ', 12)
+                  << percent(stats.blockedSeconds).paddedLeft(' ', 12)
+                  << (hasInput ? juce::String(meanDepth, 1) : juce::String("-")).paddedLeft(' ', 13)
+                  << (hasInput ? juce::String(stats.inputDepthMax) : juce::String("-")).paddedLeft(' ', 12) << "\n";
+    }
+    return 0;
+}